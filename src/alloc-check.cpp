@@ -0,0 +1,101 @@
+#include "alloc-check.hpp"
+
+#ifdef GLASSLINE_ALLOC_CHECK
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+// Scope entries per thread before an allocation counts as a failure. Covers
+// first-use setup such as the first callbacks after a source is created.
+#define WARMUP_SCOPES 500
+
+static thread_local const char *active_scope = nullptr;
+static thread_local uint32_t scope_entries = 0;
+static std::atomic<uint64_t> scoped_allocations{0};
+
+AllocCheckScope::AllocCheckScope(const char *name) : previous(active_scope)
+{
+	active_scope = name;
+	if (scope_entries < WARMUP_SCOPES)
+		scope_entries++;
+}
+
+AllocCheckScope::~AllocCheckScope()
+{
+	active_scope = previous;
+}
+
+uint64_t AllocCheckScope::Count()
+{
+	return scoped_allocations.load(std::memory_order_relaxed);
+}
+
+static void note_allocation(size_t size)
+{
+	const char *scope = active_scope;
+	if (!scope)
+		return;
+
+	scoped_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (scope_entries < WARMUP_SCOPES)
+		return;
+
+	active_scope = nullptr; // Reporting must not recurse into the check
+	fprintf(stderr, "Steady-state allocation of %zu bytes in %s\n", size, scope);
+	abort();
+}
+
+static void *checked_alloc(size_t size)
+{
+	note_allocation(size);
+	void *ptr = malloc(size ? size : 1);
+	if (!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void *operator new(size_t size)
+{
+	return checked_alloc(size);
+}
+
+void *operator new[](size_t size)
+{
+	return checked_alloc(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+	note_allocation(size);
+	return malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+	note_allocation(size);
+	return malloc(size ? size : 1);
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+#endif
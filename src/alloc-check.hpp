@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+// Steady-state allocation check for the audio and render threads
+// Tools configured with -D GLASSLINE_ALLOC_CHECK=ON (glassline-replay and
+// glassline-stress) replace the global operator new with a counting version.
+// Code running inside an AllocCheckScope must not allocate once its thread
+// has warmed up; if it does, the allocation is reported and the process
+// aborts so the check run fails loudly. Everything else compiles the scope
+// away to nothing, the plugin included: OBS loads it with dlopen, so its
+// operator new would never replace the one OBS and its libraries call.
+
+#ifdef GLASSLINE_ALLOC_CHECK
+
+class AllocCheckScope {
+public:
+	explicit AllocCheckScope(const char *name);
+	~AllocCheckScope();
+
+	AllocCheckScope(const AllocCheckScope &) = delete;
+	AllocCheckScope &operator=(const AllocCheckScope &) = delete;
+
+	// Allocations seen inside any scope so far (all of them during warm-up,
+	// otherwise we would have aborted)
+	static uint64_t Count();
+
+private:
+	const char *previous;
+};
+
+#else
+
+class AllocCheckScope {
+public:
+	explicit AllocCheckScope(const char *name) { (void)name; }
+};
+
+#endif
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// Fixed-size bump allocator for per-instance working storage
+// Everything an analysis pass touches is carved out of one aligned block when
+// the configuration changes, so the audio and render threads never hit the
+// system allocator (or its locks) in steady state.
+
+#define ARENA_ALIGN 64
+
+class Arena {
+public:
+	Arena() = default;
+	Arena(const Arena &) = delete;
+	Arena &operator=(const Arena &) = delete;
+	~Arena() { free(raw); }
+
+	// Moving hands the block over, so what was carved from it stays valid
+	Arena(Arena &&other) noexcept { Take(other); }
+	Arena &operator=(Arena &&other) noexcept
+	{
+		if (this != &other) {
+			free(raw);
+			Take(other);
+		}
+		return *this;
+	}
+
+	// Bytes one allocation of count Ts occupies, including alignment padding
+	template<typename T> static size_t Footprint(size_t count)
+	{
+		return (count * sizeof(T) + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+	}
+
+	// Drops all previous allocations and makes room for `bytes`
+	bool Reset(size_t bytes)
+	{
+		used = 0;
+		if (bytes <= capacity) {
+			if (base)
+				memset(base, 0, capacity);
+			return true;
+		}
+
+		free(raw);
+		raw = malloc(bytes + ARENA_ALIGN);
+		if (!raw) {
+			base = nullptr;
+			capacity = 0;
+			return false;
+		}
+		base = (uint8_t *)(((uintptr_t)raw + ARENA_ALIGN - 1) & ~(uintptr_t)(ARENA_ALIGN - 1));
+		capacity = bytes;
+		memset(base, 0, capacity);
+		return true;
+	}
+
+	// Zero-initialised, ARENA_ALIGN aligned; nullptr when the arena is full
+	template<typename T> T *Allocate(size_t count)
+	{
+		size_t bytes = Footprint<T>(count);
+		if (!base || used + bytes > capacity)
+			return nullptr;
+		T *ptr = (T *)(base + used);
+		used += bytes;
+		return ptr;
+	}
+
+	size_t Used() const { return used; }
+	size_t Capacity() const { return capacity; }
+
+private:
+	void Take(Arena &other)
+	{
+		raw = other.raw;
+		base = other.base;
+		capacity = other.capacity;
+		used = other.used;
+		other.raw = nullptr;
+		other.base = nullptr;
+		other.capacity = 0;
+		other.used = 0;
+	}
+
+	void *raw = nullptr;
+	uint8_t *base = nullptr;
+	size_t capacity = 0;
+	size_t used = 0;
+};
+
+// Non-owning view of an arena allocation with just enough of the vector
+// interface for the render code
+template<typename T> struct ArenaSpan {
+	T *ptr = nullptr;
+	size_t count = 0;
+
+	T &operator[](size_t i) const { return ptr[i]; }
+	T *data() const { return ptr; }
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	T *begin() const { return ptr; }
+	T *end() const { return ptr + count; }
+};
@@ -0,0 +1,188 @@
+#include "audio-features.hpp"
+#include <cmath>
+#include <cstring>
+
+#define TEMPO_HISTORY_SECONDS 6.0f // Onset strength kept for the tempo estimate
+#define TEMPO_INTERVAL_SECONDS 0.25f
+#define MIN_BPM 60.0f
+#define MAX_BPM 180.0f
+#define PREFERRED_BPM 120.0f
+#define ONSET_THRESHOLD 1.5f       // Deviations above the mean flux
+#define ONSET_MIN_FLUX 0.05f       // ...and above this, so steady tones stay quiet
+#define ONSET_STATS_SECONDS 1.0f   // Time constant of the flux mean/deviation
+#define ONSET_REFRACTORY_SECONDS 0.1f
+#define ONSET_WARMUP_SECONDS 0.5f  // Statistics settle before the first onset
+#define BEAT_EARLIEST 0.6f         // Onsets sooner than this many periods aren't beats
+#define BEAT_LATEST 1.15f          // Without an onset by then, the expected beat is used
+#define BEAT_MIN_CONFIDENCE 0.25f
+
+static size_t history_frames(float frames_per_second)
+{
+	size_t frames = (size_t)(frames_per_second * TEMPO_HISTORY_SECONDS) + 1;
+	return frames < 16 ? 16 : frames;
+}
+
+size_t BeatTracker::StorageCount(float frames_per_second)
+{
+	// Ring plus an unrolled copy for the autocorrelation
+	return history_frames(frames_per_second) * 2;
+}
+
+void BeatTracker::Init(float frames_per_second, float *storage)
+{
+	frame_rate = frames_per_second > 1.0f ? frames_per_second : 1.0f;
+	length = history_frames(frame_rate);
+	strength = storage;
+
+	min_lag = (size_t)(frame_rate * 60.0f / MAX_BPM);
+	max_lag = (size_t)ceilf(frame_rate * 60.0f / MIN_BPM);
+	if (min_lag < 1)
+		min_lag = 1;
+	if (max_lag > length / 2)
+		max_lag = length / 2;
+	if (max_lag <= min_lag + 1)
+		max_lag = min_lag + 2;
+
+	tempo_interval = (size_t)(frame_rate * TEMPO_INTERVAL_SECONDS);
+	if (tempo_interval < 1)
+		tempo_interval = 1;
+	stats_coeff = expf(-1.0f / (frame_rate * ONSET_STATS_SECONDS));
+	Reset();
+}
+
+void BeatTracker::Reset()
+{
+	if (strength)
+		memset(strength, 0, length * 2 * sizeof(float));
+	frame = 0;
+	mean = 0.0f;
+	deviation = 0.0f;
+	above = false;
+	last_onset = 0;
+	period = 0.0f;
+	confidence = 0.0f;
+	last_beat = 0;
+	has_beat = false;
+}
+
+void BeatTracker::Process(float flux, AudioFeatures &out)
+{
+	const uint64_t now = frame++;
+	if (!strength) {
+		out.onset = 0.0f;
+		out.beat = false;
+		out.tempo_bpm = 0.0f;
+		out.beat_phase = 0.0f;
+		return;
+	}
+
+	// Onset: rising through the adaptive threshold, once per crossing
+	float threshold = mean + ONSET_THRESHOLD * deviation;
+	if (threshold < ONSET_MIN_FLUX)
+		threshold = ONSET_MIN_FLUX;
+	float excess = flux - threshold;
+	bool onset = excess > 0.0f && !above && now >= (uint64_t)(ONSET_WARMUP_SECONDS * frame_rate) &&
+		     (last_onset == 0 || (float)(now - last_onset) >= ONSET_REFRACTORY_SECONDS * frame_rate);
+	above = excess > 0.0f;
+	if (onset)
+		last_onset = now;
+	out.onset = onset ? excess : 0.0f;
+
+	float rise = flux - mean;
+	strength[now % length] = rise > 0.0f ? rise : 0.0f;
+	mean += (flux - mean) * (1.0f - stats_coeff);
+	deviation += (fabsf(flux - mean) - deviation) * (1.0f - stats_coeff);
+
+	// No tempo without onsets to carry it
+	if (last_onset == 0 || now - last_onset > length) {
+		period = 0.0f;
+		confidence = 0.0f;
+	} else if (now % tempo_interval == 0 && now >= max_lag * 2) {
+		EstimateTempo();
+	}
+
+	// Beats: onsets near the expected time reset the phase; while the tempo
+	// is trusted, a missing onset is filled in at the expected time
+	bool beat = false;
+	float since = has_beat ? (float)(now - last_beat) : 0.0f;
+	if (onset && (!has_beat || period <= 0.0f || since >= BEAT_EARLIEST * period)) {
+		beat = true;
+		last_beat = now;
+		has_beat = true;
+	} else if (has_beat && period > 0.0f && confidence >= BEAT_MIN_CONFIDENCE && since >= BEAT_LATEST * period) {
+		beat = true;
+		last_beat += (uint64_t)(period + 0.5f); // Keep the phase, not the late frame
+	}
+
+	out.beat = beat;
+	out.tempo_bpm = period > 0.0f ? 60.0f * frame_rate / period : 0.0f;
+	if (has_beat && period > 0.0f) {
+		float phase = (float)(now - last_beat) / period;
+		out.beat_phase = phase < 1.0f ? phase : 1.0f;
+	} else {
+		out.beat_phase = 0.0f;
+	}
+}
+
+void BeatTracker::EstimateTempo()
+{
+	// Unroll the ring, oldest first
+	size_t count = frame < length ? (size_t)frame : length;
+	size_t start = (size_t)(frame % length);
+	float *linear = strength + length;
+	for (size_t i = 0; i < count; i++)
+		linear[i] = strength[(start + length - count + i) % length];
+
+	float energy = 0.0f;
+	for (size_t i = 0; i < count; i++)
+		energy += linear[i] * linear[i];
+	if (energy <= 1e-12f) {
+		period = 0.0f;
+		confidence = 0.0f;
+		return;
+	}
+
+	// Normalised autocorrelation per lag, weighted by a log-normal around the
+	// preferred tempo so half and double tempo don't win on small margins
+	size_t best_lag = 0;
+	float best_score = 0.0f;
+	float best_value = 0.0f;
+	float values[3] = {0.0f, 0.0f, 0.0f}; // Around the best lag, for interpolation
+	float prev = 0.0f;
+	for (size_t lag = min_lag - 1; lag <= max_lag + 1 && lag < count; lag++) {
+		float sum = 0.0f;
+		for (size_t i = lag; i < count; i++)
+			sum += linear[i] * linear[i - lag];
+		float value = sum / (float)(count - lag) / (energy / (float)count);
+
+		if (lag >= min_lag && lag <= max_lag) {
+			float octaves = log2f(60.0f * frame_rate / (float)lag / PREFERRED_BPM);
+			float score = value * expf(-0.5f * octaves * octaves);
+			if (score > best_score) {
+				best_score = score;
+				best_value = value;
+				best_lag = lag;
+				values[0] = prev;
+				values[1] = value;
+				values[2] = 0.0f;
+			}
+		}
+		if (best_lag && lag == best_lag + 1)
+			values[2] = value;
+		prev = value;
+	}
+
+	if (!best_lag || best_value < BEAT_MIN_CONFIDENCE) {
+		period = 0.0f;
+		confidence = 0.0f;
+		return;
+	}
+
+	// Parabolic peak between neighbouring lags
+	float denom = values[0] - 2.0f * values[1] + values[2];
+	float offset = denom < 0.0f ? 0.5f * (values[0] - values[2]) / denom : 0.0f;
+	if (offset > 0.5f || offset < -0.5f)
+		offset = 0.0f;
+	period = (float)best_lag + offset;
+	confidence = best_value;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Scalar audio features published alongside each spectrum
+// Levels come from the time-domain samples the spectrum covers, centroid and
+// flux from the same pass over the FFT output that computes the magnitudes,
+// and onsets, beats and tempo from the flux sequence. No OBS dependencies.
+
+#define FEATURE_MAX_CHANNELS 8
+
+struct AudioFeatures {
+	uint32_t channels;                // Channels with valid levels
+	float rms[FEATURE_MAX_CHANNELS];  // Since the previous spectrum
+	float peak[FEATURE_MAX_CHANNELS]; // Absolute sample peak, same span
+	float centroid_hz;                // Magnitude-weighted mean frequency
+	float flux;                       // Magnitude rise since the previous spectrum, over the total
+	float onset;                      // Flux above the adaptive threshold, 0 when none
+	bool beat;                        // A beat falls on this spectrum
+	float tempo_bpm;                  // 0 until a tempo has been found
+	float beat_phase;                 // 0 on a beat, rising to 1 at the next expected one
+	float pitch_hz;                   // Fundamental of the analysed channel, 0 when none found
+	float pitch_confidence;           // How periodic the samples are at that pitch, 0 to 1
+};
+
+// Onset detection and tempo tracking on the spectral flux
+// An onset is flux crossing mean + k * deviation of its recent history.
+// Tempo is the strongest autocorrelation lag of the onset strength over the
+// last few seconds, weighted towards 120 BPM; beats are onsets that land
+// near the expected beat time, or the expected time itself while the
+// tempo is confident and the music goes quiet for a moment.
+class BeatTracker {
+public:
+	// Floats of working storage for Init() at the given spectrum rate
+	static size_t StorageCount(float frames_per_second);
+
+	// `storage` must hold StorageCount() floats and outlive the tracker
+	void Init(float frames_per_second, float *storage);
+	void Reset();
+
+	// One spectrum's flux in, onset/beat/tempo fields of `out` filled in
+	void Process(float flux, AudioFeatures &out);
+
+private:
+	void EstimateTempo();
+
+	float frame_rate = 100.0f;
+	float *strength = nullptr; // Onset strength ring, `length` frames
+	size_t length = 0;
+	uint64_t frame = 0; // Spectra seen since Reset()
+
+	float mean = 0.0f; // Running flux statistics for the threshold
+	float deviation = 0.0f;
+	float stats_coeff = 0.0f;
+	bool above = false; // Still above the threshold from the last onset
+	uint64_t last_onset = 0;
+
+	size_t min_lag = 1; // Autocorrelation lag range (frames)
+	size_t max_lag = 2;
+	size_t tempo_interval = 1; // Frames between tempo estimates
+	float period = 0.0f;       // Frames per beat, 0 while unknown
+	float confidence = 0.0f;
+	uint64_t last_beat = 0;
+	bool has_beat = false;
+};
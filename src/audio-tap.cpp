@@ -0,0 +1,95 @@
+#include <obs-module.h>
+#include "audio-tap.hpp"
+#include "plugin-support.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+struct AudioTapListener {
+	audio_tap_callback_t callback;
+	void *param;
+
+	bool operator==(const AudioTapListener &other) const
+	{
+		return callback == other.callback && param == other.param;
+	}
+};
+
+struct AudioTap {
+	std::mutex mutex; // Guards listeners, held while a block is handed out
+	std::vector<AudioTapListener> listeners;
+};
+
+static AudioTap *get_tap(obs_source_t *filter)
+{
+	if (!filter || strcmp(obs_source_get_id(filter), AUDIO_TAP_ID) != 0)
+		return nullptr;
+	return (AudioTap *)obs_obj_get_data(filter);
+}
+
+bool audio_tap_add_listener(obs_source_t *filter, audio_tap_callback_t callback, void *param)
+{
+	AudioTap *tap = get_tap(filter);
+	if (!tap)
+		return false;
+	std::lock_guard<std::mutex> lock(tap->mutex);
+	tap->listeners.push_back({callback, param});
+	return true;
+}
+
+void audio_tap_remove_listener(obs_source_t *filter, audio_tap_callback_t callback, void *param)
+{
+	AudioTap *tap = get_tap(filter);
+	if (!tap)
+		return;
+	std::lock_guard<std::mutex> lock(tap->mutex);
+	auto &listeners = tap->listeners;
+	listeners.erase(std::remove(listeners.begin(), listeners.end(), AudioTapListener{callback, param}),
+			listeners.end());
+}
+
+static const char *audio_tap_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "GlassLine Audio Tap";
+}
+
+static void *audio_tap_create(obs_data_t *settings, obs_source_t *filter)
+{
+	UNUSED_PARAMETER(settings);
+	UNUSED_PARAMETER(filter);
+	return new AudioTap();
+}
+
+static void audio_tap_destroy(void *data)
+{
+	// Visualizers only hold a weak reference, and drop their listener when
+	// the tap leaves its source's filters; any left are never called again
+	delete (AudioTap *)data;
+}
+
+static struct obs_audio_data *audio_tap_filter_audio(void *data, struct obs_audio_data *audio)
+{
+	AudioTap *tap = (AudioTap *)data;
+
+	struct audio_data block = {};
+	memcpy(block.data, audio->data, sizeof(block.data));
+	block.frames = audio->frames;
+	block.timestamp = audio->timestamp;
+
+	std::lock_guard<std::mutex> lock(tap->mutex);
+	for (const AudioTapListener &listener : tap->listeners)
+		listener.callback(listener.param, &block);
+	return audio;
+}
+
+struct obs_source_info glass_line_audio_tap = {
+	.id = AUDIO_TAP_ID,
+	.type = OBS_SOURCE_TYPE_FILTER,
+	.output_flags = OBS_SOURCE_AUDIO,
+	.get_name = audio_tap_get_name,
+	.create = audio_tap_create,
+	.destroy = audio_tap_destroy,
+	.filter_audio = audio_tap_filter_audio,
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <obs.h>
+
+// GlassLine Audio Tap: an audio filter that passes a source's audio through
+// unchanged and hands each block, as it is at the filter's place in the
+// chain, to the visualizers bound to it. Placed first it sees the input
+// before any other filter; one tap serves any number of visualizers.
+
+#define AUDIO_TAP_ID "glass_line_audio_tap"
+
+typedef void (*audio_tap_callback_t)(void *param, const struct audio_data *data);
+
+// False if `filter` isn't an audio tap. The callback runs on the audio thread.
+bool audio_tap_add_listener(obs_source_t *filter, audio_tap_callback_t callback, void *param);
+void audio_tap_remove_listener(obs_source_t *filter, audio_tap_callback_t callback, void *param);
+
+extern struct obs_source_info glass_line_audio_tap;
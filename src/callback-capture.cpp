@@ -0,0 +1,165 @@
+#include "callback-capture.hpp"
+#include <chrono>
+#include <cstring>
+
+static_assert(sizeof(CaptureFileHeader) <= MAPPED_SEGMENT_ALIGN, "file header must fit its segment");
+static_assert(sizeof(CaptureBlockHeader) % 8 == 0, "block data must stay 8-byte aligned");
+
+// Plenty for several seconds of 1024-frame stereo blocks per mapping
+#define CAPTURE_SEGMENT_SIZE (4 << 20)
+
+static size_t block_size(uint32_t frames, uint32_t channels)
+{
+	return mapped_align_up(sizeof(CaptureBlockHeader) + (size_t)frames * channels * sizeof(float), 8);
+}
+
+// CaptureWriter
+
+bool CaptureWriter::Start(const char *path, uint32_t sample_rate, uint32_t new_channels, uint32_t fft_size,
+			  uint32_t decimation, uint32_t hop, float attack_ms, float release_ms)
+{
+	Stop();
+
+	if (new_channels == 0 || new_channels > CAPTURE_MAX_CHANNELS)
+		return false;
+	if (!writer.Open(path, CAPTURE_SEGMENT_SIZE))
+		return false;
+
+	CaptureFileHeader *header = (CaptureFileHeader *)writer.Header();
+	header->magic = CAPTURE_MAGIC;
+	header->version = CAPTURE_VERSION;
+	header->sample_rate = sample_rate;
+	header->channels = new_channels;
+	header->segment_size = (uint32_t)writer.SegmentSize();
+	header->fft_size = fft_size;
+	header->decimation = decimation;
+	header->hop = hop;
+	header->attack_ms = attack_ms;
+	header->release_ms = release_ms;
+	header->reserved = 0;
+	header->created_ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+				     std::chrono::system_clock::now().time_since_epoch())
+				     .count();
+
+	channels = new_channels;
+	position = 0;
+	blocks_written = 0;
+	blocks_dropped = 0;
+	return true;
+}
+
+void CaptureWriter::Append(const float *const *planes, uint32_t frames, uint64_t timestamp)
+{
+	if (!writer.IsOpen() || frames == 0)
+		return;
+
+	size_t size = block_size(frames, channels);
+	if (position + size > writer.SegmentSize()) {
+		// Move on to the segment Maintain() prepared; the rest of this one stays zero
+		if (size > writer.SegmentSize() || !writer.Advance()) {
+			blocks_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		position = 0;
+	}
+
+	uint8_t *dst = writer.Current() + position;
+	float *samples = (float *)(dst + sizeof(CaptureBlockHeader));
+	for (uint32_t ch = 0; ch < channels; ch++) {
+		if (planes[ch])
+			memcpy(samples + (size_t)ch * frames, planes[ch], frames * sizeof(float));
+	}
+
+	CaptureBlockHeader *block = (CaptureBlockHeader *)dst;
+	block->frames = frames;
+	block->channels = channels;
+	block->reserved = 0;
+	block->timestamp = timestamp;
+	// Magic goes in last so a crashed capture ends on a complete block
+	std::atomic_thread_fence(std::memory_order_release);
+	block->magic = CAPTURE_BLOCK_MAGIC;
+
+	position += size;
+	blocks_written.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CaptureWriter::Stop()
+{
+	// Callers guarantee Append() is no longer running
+	writer.Close(position);
+	position = 0;
+}
+
+// CaptureReader
+
+bool CaptureReader::Open(const char *path)
+{
+	Close();
+
+	if (!file.Open(path, false))
+		return false;
+
+	mapped_size = (size_t)file.Size();
+	if (mapped_size < MAPPED_SEGMENT_ALIGN) {
+		Close();
+		return false;
+	}
+
+	base = (const uint8_t *)file.Map(0, mapped_size);
+	if (!base) {
+		Close();
+		return false;
+	}
+
+	memcpy(&header, base, sizeof(header));
+	if (header.magic != CAPTURE_MAGIC || header.version != CAPTURE_VERSION || header.channels == 0 ||
+	    header.channels > CAPTURE_MAX_CHANNELS || header.sample_rate == 0 || header.segment_size == 0 ||
+	    header.segment_size % MAPPED_SEGMENT_ALIGN != 0) {
+		Close();
+		return false;
+	}
+
+	for (size_t segment = MAPPED_SEGMENT_ALIGN; segment < mapped_size; segment += header.segment_size) {
+		size_t end = segment + header.segment_size;
+		if (end > mapped_size)
+			end = mapped_size; // Last segment was cut short by Stop()
+
+		size_t offset = segment;
+		while (offset + sizeof(CaptureBlockHeader) <= end) {
+			const CaptureBlockHeader *block = (const CaptureBlockHeader *)(base + offset);
+			if (block->magic != CAPTURE_BLOCK_MAGIC)
+				break;
+
+			size_t size = block_size(block->frames, block->channels);
+			if (block->channels == 0 || block->channels > CAPTURE_MAX_CHANNELS || offset + size > end)
+				break;
+
+			CaptureBlock out = {};
+			out.timestamp = block->timestamp;
+			out.frames = block->frames;
+			out.channels = block->channels;
+			const float *samples = (const float *)(block + 1);
+			for (uint32_t ch = 0; ch < block->channels; ch++)
+				out.data[ch] = samples + (size_t)ch * block->frames;
+			blocks.push_back(out);
+
+			offset += size;
+		}
+
+		// An empty segment means the writer never got there
+		if (offset == segment)
+			break;
+	}
+	return true;
+}
+
+void CaptureReader::Close()
+{
+	if (base) {
+		MappedFile::Unmap((void *)base, mapped_size);
+		base = nullptr;
+	}
+	file.Close();
+	blocks.clear();
+	mapped_size = 0;
+}
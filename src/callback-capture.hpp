@@ -0,0 +1,102 @@
+#pragma once
+
+#include "mapped-file.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Audio callback capture
+// Records every block the audio capture callback receives (frame count,
+// timestamp and planar channel data) to a .glcap file, so the exact callback
+// pattern of a session can be replayed through the analysis pipeline outside
+// OBS. Segments are mapped ahead by Maintain(), Append() is a memory copy.
+//
+// File layout (little endian):
+//   [CaptureFileHeader, padded to MAPPED_SEGMENT_ALIGN]
+//   [CaptureBlockHeader][channels x frames floats] ...  (packed per segment)
+// A block never straddles segments; a zero magic ends a segment's blocks.
+
+#define CAPTURE_MAGIC 0x50434C47u       // "GLCP"
+#define CAPTURE_BLOCK_MAGIC 0x4B424C47u // "GLBK"
+#define CAPTURE_VERSION 1
+#define CAPTURE_MAX_CHANNELS 8
+
+struct CaptureFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t sample_rate;
+	uint32_t channels;
+	uint32_t segment_size;
+	// Analysis settings at capture time, used as replay defaults
+	uint32_t fft_size;
+	uint32_t decimation;
+	uint32_t hop; // Analysis-rate samples between spectra
+	float attack_ms;
+	float release_ms;
+	uint32_t reserved;
+	uint64_t created_ns; // Wall clock, ns since the Unix epoch
+};
+
+struct CaptureBlockHeader {
+	uint32_t magic;
+	uint32_t frames;
+	uint32_t channels;
+	uint32_t reserved;
+	uint64_t timestamp; // OBS audio timestamp (ns) of the first frame
+};
+
+// Block as returned by the reader; channel data points into the mapping
+struct CaptureBlock {
+	uint64_t timestamp;
+	uint32_t frames;
+	uint32_t channels;
+	const float *data[CAPTURE_MAX_CHANNELS];
+};
+
+class CaptureWriter {
+public:
+	~CaptureWriter() { Stop(); }
+
+	bool Start(const char *path, uint32_t sample_rate, uint32_t channels, uint32_t fft_size, uint32_t decimation,
+		   uint32_t hop, float attack_ms, float release_ms);
+	void Stop();
+	bool IsRecording() const { return writer.IsOpen(); }
+
+	// Audio thread. Never blocks; a block that doesn't fit while the next
+	// segment isn't mapped yet is dropped and counted.
+	void Append(const float *const *planes, uint32_t frames, uint64_t timestamp);
+
+	// Any non-audio thread (video tick)
+	void Maintain() { writer.Maintain(); }
+
+	uint64_t BlocksWritten() const { return blocks_written.load(std::memory_order_relaxed); }
+	uint64_t BlocksDropped() const { return blocks_dropped.load(std::memory_order_relaxed); }
+	const std::string &Path() const { return writer.Path(); }
+
+private:
+	SegmentWriter writer;
+	uint32_t channels = 0;
+	size_t position = 0; // Write offset inside the current segment
+	std::atomic<uint64_t> blocks_written{0};
+	std::atomic<uint64_t> blocks_dropped{0};
+};
+
+class CaptureReader {
+public:
+	~CaptureReader() { Close(); }
+
+	bool Open(const char *path);
+	void Close();
+
+	const CaptureFileHeader &Header() const { return header; }
+	size_t BlockCount() const { return blocks.size(); }
+	const CaptureBlock &Block(size_t index) const { return blocks[index]; }
+
+private:
+	MappedFile file;
+	const uint8_t *base = nullptr;
+	size_t mapped_size = 0;
+	CaptureFileHeader header = {};
+	std::vector<CaptureBlock> blocks;
+};
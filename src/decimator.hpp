@@ -0,0 +1,127 @@
+#pragma once
+
+#include "simd.hpp"
+#include <cmath>
+#include <cstddef>
+
+// Multistage polyphase decimator (2x, 4x or 8x)
+// Each stage is a 2x halfband FIR split into its two polyphase branches. In a
+// halfband filter every other tap is zero, so the odd branch collapses to a
+// single centre tap and only the even branch needs a real (SIMD) dot product.
+
+class HalfbandStage {
+public:
+	static const size_t K = 12;           // Filter length is 4K - 1 = 47 taps
+	static const size_t EVEN_TAPS = 2 * K; // Non-zero taps on the even branch
+
+	HalfbandStage()
+	{
+		// Blackman-windowed sinc with cutoff at a quarter of the input rate
+		const size_t n = 4 * K - 1;
+		const double centre = (double)(n - 1) / 2.0;
+		double sum = 0.0;
+		for (size_t j = 0; j < EVEN_TAPS; j++) {
+			double t = (double)(2 * j) - centre; // Always odd, so sinc is non-zero
+			double w = 0.42 - 0.5 * cos(2.0 * M_PI * (double)(2 * j) / (double)(n - 1)) +
+				   0.08 * cos(4.0 * M_PI * (double)(2 * j) / (double)(n - 1));
+			double h = sin(M_PI * t / 2.0) / (M_PI * t) * w;
+			taps[j] = (float)h;
+			sum += h;
+		}
+		// Normalise so DC gain is exactly 1 (even branch sums to 0.5, plus 0.5 centre)
+		for (size_t j = 0; j < EVEN_TAPS; j++)
+			taps[j] = (float)(taps[j] * 0.5 / sum);
+
+		Reset();
+	}
+
+	void Reset()
+	{
+		for (size_t i = 0; i < 2 * EVEN_TAPS; i++)
+			even_hist[i] = 0.0f;
+		for (size_t i = 0; i < K; i++)
+			odd_hist[i] = 0.0f;
+		even_pos = 0;
+		odd_pos = 0;
+		phase = 0;
+	}
+
+	// Decimates n samples by 2. Safe to run in place (out == in).
+	// Returns the number of output samples written.
+	size_t Process(const float *in, size_t n, float *out)
+	{
+		size_t produced = 0;
+		for (size_t i = 0; i < n; i++) {
+			float x = in[i];
+			if (phase == 0) {
+				// Even sample: push into the SIMD delay line (written twice so the
+				// newest EVEN_TAPS samples are always contiguous) and emit.
+				even_pos = (even_pos == 0) ? EVEN_TAPS - 1 : even_pos - 1;
+				even_hist[even_pos] = x;
+				even_hist[even_pos + EVEN_TAPS] = x;
+
+				float acc = simd::dot(taps, &even_hist[even_pos], EVEN_TAPS);
+				acc += 0.5f * odd_hist[odd_pos]; // Oldest odd sample is the centre tap
+				out[produced++] = acc;
+			} else {
+				odd_hist[odd_pos] = x;
+				odd_pos = (odd_pos + 1) % K;
+			}
+			phase ^= 1;
+		}
+		return produced;
+	}
+
+private:
+	float taps[EVEN_TAPS];
+	float even_hist[2 * EVEN_TAPS];
+	float odd_hist[K];
+	size_t even_pos;
+	size_t odd_pos;
+	int phase;
+};
+
+class PolyphaseDecimator {
+public:
+	static const int MAX_STAGES = 3;
+
+	// Largest factor (1, 2, 4 or 8) that still leaves top_freq inside the
+	// alias-free passband of the cascaded halfband stages
+	static int ChooseFactor(double sample_rate, double top_freq)
+	{
+		for (int factor = 1 << MAX_STAGES; factor > 1; factor >>= 1) {
+			if (top_freq <= PASSBAND * sample_rate / factor)
+				return factor;
+		}
+		return 1;
+	}
+
+	void SetFactor(int new_factor)
+	{
+		int stages = 0;
+		while ((1 << stages) < new_factor && stages < MAX_STAGES)
+			stages++;
+		num_stages = stages;
+		factor = 1 << stages;
+		for (int i = 0; i < MAX_STAGES; i++)
+			stage[i].Reset();
+	}
+
+	int GetFactor() const { return factor; }
+
+	// Decimates in place, returns the new sample count
+	size_t Process(float *samples, size_t n)
+	{
+		for (int i = 0; i < num_stages; i++)
+			n = stage[i].Process(samples, n, samples);
+		return n;
+	}
+
+private:
+	// Fraction of the output rate that stays alias-free with 47-tap stages
+	static constexpr double PASSBAND = 0.375;
+
+	HalfbandStage stage[MAX_STAGES];
+	int num_stages = 0;
+	int factor = 1;
+};
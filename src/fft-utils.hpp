@@ -1,58 +1,88 @@
 #pragma once
 
-#include <vector>
-#include <complex>
+#include <cstddef>
+#include <cstdint>
 #include <cmath>
 
 // Simple FFT implementation
-// Based on standard Cooley-Tukey algorithm
+// Iterative radix-2 Cooley-Tukey over split real/imaginary arrays.
+// Twiddle and bit-reversal tables live in caller-provided storage (the
+// analysis arena), so transforms never allocate.
 // Note: Size must be power of 2
 
 class SimpleFFT {
 public:
-	static void Compute(const std::vector<float> &input, std::vector<float> &output_magnitudes)
+	// Table sizes for a transform of size n
+	static size_t TwiddleCount(size_t n) { return n / 2; }
+	static size_t BitrevCount(size_t n) { return n; }
+
+	void Init(size_t size, float *cos_storage, float *sin_storage, uint32_t *bitrev_storage)
 	{
-		size_t n = input.size();
-		if (n == 0)
-			return;
+		n = size;
+		cos_table = cos_storage;
+		sin_table = sin_storage;
+		bitrev = bitrev_storage;
 
-		// Check if power of 2 (omitted for brevity, assume caller ensures)
+		size_t bits = 0;
+		while (((size_t)1 << bits) < n)
+			bits++;
 
-		std::vector<std::complex<float>> data(n);
 		for (size_t i = 0; i < n; i++) {
-			data[i] = std::complex<float>(input[i], 0.0f);
+			size_t r = 0;
+			for (size_t b = 0; b < bits; b++)
+				r |= ((i >> b) & 1) << (bits - 1 - b);
+			bitrev_storage[i] = (uint32_t)r;
 		}
 
-		fft(data);
-
-		output_magnitudes.resize(n / 2);
-		for (size_t i = 0; i < n / 2; i++) {
-			output_magnitudes[i] = std::abs(data[i]);
+		for (size_t k = 0; k < n / 2; k++) {
+			double angle = -2.0 * M_PI * (double)k / (double)n;
+			cos_storage[k] = (float)cos(angle);
+			sin_storage[k] = (float)sin(angle);
 		}
 	}
 
-private:
-	static void fft(std::vector<std::complex<float>> &x)
+	size_t Size() const { return n; }
+
+	void Forward(float *re, float *im) const
 	{
-		size_t n = x.size();
 		if (n <= 1)
 			return;
 
-		std::vector<std::complex<float>> even(n / 2);
-		std::vector<std::complex<float>> odd(n / 2);
-
-		for (size_t i = 0; i < n / 2; i++) {
-			even[i] = x[2 * i];
-			odd[i] = x[2 * i + 1];
+		for (size_t i = 0; i < n; i++) {
+			size_t j = bitrev[i];
+			if (j > i) {
+				float t = re[i];
+				re[i] = re[j];
+				re[j] = t;
+				t = im[i];
+				im[i] = im[j];
+				im[j] = t;
+			}
 		}
 
-		fft(even);
-		fft(odd);
-
-		for (size_t k = 0; k < n / 2; k++) {
-			std::complex<float> t = std::polar(1.0f, -2.0f * (float)M_PI * k / n) * odd[k];
-			x[k] = even[k] + t;
-			x[k + n / 2] = even[k] - t;
+		for (size_t len = 2; len <= n; len <<= 1) {
+			size_t half = len / 2;
+			size_t step = n / len;
+			for (size_t start = 0; start < n; start += len) {
+				for (size_t k = 0; k < half; k++) {
+					float wr = cos_table[k * step];
+					float wi = sin_table[k * step];
+					size_t a = start + k;
+					size_t b = a + half;
+					float tr = re[b] * wr - im[b] * wi;
+					float ti = re[b] * wi + im[b] * wr;
+					re[b] = re[a] - tr;
+					im[b] = im[a] - ti;
+					re[a] += tr;
+					im[a] += ti;
+				}
+			}
 		}
 	}
+
+private:
+	size_t n = 0;
+	const float *cos_table = nullptr;
+	const float *sin_table = nullptr;
+	const uint32_t *bitrev = nullptr;
 };
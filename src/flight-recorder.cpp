@@ -0,0 +1,364 @@
+#include "flight-recorder.hpp"
+#include "spectrum-kernels.hpp"
+#include <cmath>
+#include <cstring>
+#include <chrono>
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "chunk header must be plain data");
+static_assert(sizeof(FlightFileHeader) <= FLIGHT_SEGMENT_ALIGN, "file header must fit its segment");
+
+// Frames start at a fixed offset inside each chunk
+#define CHUNK_HEADER_SPAN 64
+
+// Magnitudes are stored over this range in 8-bit log mode
+#define LOG8_MIN_DB -80.0f
+#define LOG8_MAX_DB 60.0f
+
+// Codecs
+
+static uint8_t quantize_log8_db(float db)
+{
+	float t = (db - LOG8_MIN_DB) / (LOG8_MAX_DB - LOG8_MIN_DB);
+	if (t <= 0.0f)
+		return 0;
+	if (t >= 1.0f)
+		return 255;
+	return (uint8_t)(t * 254.0f + 1.5f); // 0 is reserved for silence
+}
+
+uint8_t flight_encode_log8(float magnitude)
+{
+	if (!(magnitude > 0.0f))
+		return 0;
+	return quantize_log8_db(20.0f * log10f(magnitude));
+}
+
+float flight_decode_log8(uint8_t value)
+{
+	if (value == 0)
+		return 0.0f;
+	float db = LOG8_MIN_DB + (float)(value - 1) / 254.0f * (LOG8_MAX_DB - LOG8_MIN_DB);
+	return powf(10.0f, db / 20.0f);
+}
+
+uint16_t flight_encode_half(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	int32_t exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+	uint32_t mantissa = bits & 0x7FFFFF;
+
+	if (((bits >> 23) & 0xFF) == 0xFF) // Inf / NaN
+		return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+	if (exponent >= 31) // Overflow to infinity
+		return (uint16_t)(sign | 0x7C00);
+	if (exponent <= 0) { // Subnormal or zero
+		if (exponent < -10)
+			return (uint16_t)sign;
+		mantissa |= 0x800000;
+		uint32_t shift = (uint32_t)(14 - exponent);
+		uint32_t half = mantissa >> shift;
+		if ((mantissa >> (shift - 1)) & 1)
+			half++;
+		return (uint16_t)(sign | half);
+	}
+
+	uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+	if (mantissa & 0x1000) // Round to nearest
+		half++;
+	return (uint16_t)half;
+}
+
+float flight_decode_half(uint16_t value)
+{
+	uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1F;
+	uint32_t mantissa = value & 0x3FF;
+	uint32_t bits;
+
+	if (exponent == 0) {
+		if (mantissa == 0) {
+			bits = sign;
+		} else {
+			// Normalise the subnormal
+			exponent = 127 - 15 + 1;
+			while (!(mantissa & 0x400)) {
+				mantissa <<= 1;
+				exponent--;
+			}
+			bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+		}
+	} else if (exponent == 31) {
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	} else {
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+
+	float out;
+	memcpy(&out, &bits, sizeof(out));
+	return out;
+}
+
+// FlightRecorder
+
+size_t FlightRecorder::FrameSize(uint32_t band_count, FlightEncoding encoding)
+{
+	size_t value_size = encoding == FLIGHT_ENCODING_FLOAT16 ? 2 : 1;
+	return mapped_align_up(sizeof(FlightFrameHeader) + band_count * value_size, 8);
+}
+
+bool FlightRecorder::Start(const char *path, uint32_t bands, FlightEncoding enc, uint32_t fft_size,
+			   float analysis_rate)
+{
+	Stop();
+
+	encoding = enc;
+	band_count = bands;
+	frame_size = FrameSize(bands, enc);
+	db_scratch.assign(bands, 0.0f);
+	to_db = spectrum_kernels().to_db;
+
+	// Roughly 1 MB chunks, rounded to the mapping granularity
+	size_t segment_size = mapped_align_up(CHUNK_HEADER_SPAN + frame_size * ((1 << 20) / frame_size),
+					      FLIGHT_SEGMENT_ALIGN);
+	chunk_frames = (uint32_t)((segment_size - CHUNK_HEADER_SPAN) / frame_size);
+
+	if (!writer.Open(path, segment_size))
+		return false;
+
+	FlightFileHeader *header = (FlightFileHeader *)writer.Header();
+	header->magic = FLIGHT_MAGIC;
+	header->version = FLIGHT_VERSION;
+	header->band_count = bands;
+	header->encoding = enc;
+	header->frame_size = (uint32_t)frame_size;
+	header->chunk_frames = chunk_frames;
+	header->fft_size = fft_size;
+	header->analysis_rate = analysis_rate;
+	header->created_ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+				     std::chrono::system_clock::now().time_since_epoch())
+				     .count();
+
+	frames_written = 0;
+	frames_dropped = 0;
+	BeginChunk();
+	return true;
+}
+
+void FlightRecorder::BeginChunk()
+{
+	FlightChunkHeader *chunk = (FlightChunkHeader *)writer.Current();
+	chunk->magic = FLIGHT_CHUNK_MAGIC;
+	chunk->frame_count.store(0, std::memory_order_relaxed);
+	chunk->first_timestamp = 0;
+	chunk->last_timestamp = 0;
+}
+
+void FlightRecorder::Append(const FlightFrameStats &stats, const float *bands, size_t count)
+{
+	if (!writer.IsOpen())
+		return;
+
+	FlightChunkHeader *chunk = (FlightChunkHeader *)writer.Current();
+	uint32_t index = chunk->frame_count.load(std::memory_order_relaxed);
+
+	if (index >= chunk_frames) {
+		// Swap in the chunk Maintain() prepared; the full one goes back to it
+		if (!writer.Advance()) {
+			frames_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		BeginChunk();
+		chunk = (FlightChunkHeader *)writer.Current();
+		index = 0;
+	}
+
+	uint8_t *dst = writer.Current() + CHUNK_HEADER_SPAN + (size_t)index * frame_size;
+	FlightFrameHeader *frame = (FlightFrameHeader *)dst;
+	frame->timestamp = stats.timestamp;
+	frame->peak = stats.peak;
+	frame->rms = stats.rms;
+	frame->flags = stats.flags;
+	frame->reserved = 0;
+
+	if (count > band_count)
+		count = band_count;
+
+	if (encoding == FLIGHT_ENCODING_FLOAT16) {
+		uint16_t *values = (uint16_t *)(dst + sizeof(FlightFrameHeader));
+		for (size_t i = 0; i < count; i++)
+			values[i] = flight_encode_half(bands[i]);
+		for (size_t i = count; i < band_count; i++)
+			values[i] = 0;
+	} else {
+		// Whole frame to dB in one vectorised pass, then quantise; anything
+		// at or below the floor (silence included) encodes as 0
+		uint8_t *values = dst + sizeof(FlightFrameHeader);
+		to_db(bands, db_scratch.data(), count, LOG8_MIN_DB);
+		for (size_t i = 0; i < count; i++)
+			values[i] = quantize_log8_db(db_scratch[i]);
+		for (size_t i = count; i < band_count; i++)
+			values[i] = 0;
+	}
+
+	if (index == 0)
+		chunk->first_timestamp = stats.timestamp;
+	chunk->last_timestamp = stats.timestamp;
+	chunk->frame_count.store(index + 1, std::memory_order_release);
+	frames_written.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FlightRecorder::Stop()
+{
+	// Callers guarantee Append() is no longer running
+	if (!writer.IsOpen())
+		return;
+
+	// Drop the preallocated tail so the file ends after the last frame
+	const FlightChunkHeader *chunk = (const FlightChunkHeader *)writer.Current();
+	writer.Close(CHUNK_HEADER_SPAN + (size_t)chunk->frame_count.load(std::memory_order_acquire) * frame_size);
+}
+
+// FlightReader
+
+bool FlightReader::Open(const char *path)
+{
+	Close();
+
+	if (!file.Open(path, false))
+		return false;
+
+	mapped_size = (size_t)file.Size();
+	if (mapped_size < sizeof(FlightFileHeader)) {
+		Close();
+		return false;
+	}
+
+	base = (const uint8_t *)file.Map(0, mapped_size);
+	if (!base) {
+		Close();
+		return false;
+	}
+
+	memcpy(&header, base, sizeof(header));
+	if (header.magic != FLIGHT_MAGIC || header.version != FLIGHT_VERSION || header.frame_size == 0 ||
+	    header.frame_size != FlightRecorder::FrameSize(header.band_count, (FlightEncoding)header.encoding)) {
+		Close();
+		return false;
+	}
+
+	size_t segment_size = mapped_align_up(CHUNK_HEADER_SPAN + (size_t)header.frame_size * header.chunk_frames,
+				       FLIGHT_SEGMENT_ALIGN);
+
+	for (size_t offset = FLIGHT_SEGMENT_ALIGN; offset + CHUNK_HEADER_SPAN <= mapped_size; offset += segment_size) {
+		const FlightChunkHeader *chunk = (const FlightChunkHeader *)(base + offset);
+		if (chunk->magic != FLIGHT_CHUNK_MAGIC)
+			break;
+
+		uint32_t count = chunk->frame_count.load(std::memory_order_acquire);
+		if (count > header.chunk_frames)
+			break;
+		// The last chunk may have been cut short by Stop()
+		size_t available = (mapped_size - offset - CHUNK_HEADER_SPAN) / header.frame_size;
+		if (count > available)
+			count = (uint32_t)available;
+		if (count == 0)
+			break;
+
+		chunks.push_back({base + offset + CHUNK_HEADER_SPAN, total_frames, count, chunk->first_timestamp});
+		total_frames += count;
+	}
+	return true;
+}
+
+void FlightReader::Close()
+{
+	if (base) {
+		MappedFile::Unmap((void *)base, mapped_size);
+		base = nullptr;
+	}
+	file.Close();
+	chunks.clear();
+	total_frames = 0;
+	mapped_size = 0;
+}
+
+const FlightFrameHeader *FlightReader::FrameAt(size_t index) const
+{
+	if (index >= total_frames)
+		return nullptr;
+
+	// Chunks are sorted by first_index
+	size_t lo = 0, hi = chunks.size();
+	while (hi - lo > 1) {
+		size_t mid = (lo + hi) / 2;
+		if (chunks[mid].first_index <= index)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	const Chunk &chunk = chunks[lo];
+	return (const FlightFrameHeader *)(chunk.frames + (index - chunk.first_index) * header.frame_size);
+}
+
+uint64_t FlightReader::FirstTimestamp() const
+{
+	const FlightFrameHeader *frame = FrameAt(0);
+	return frame ? frame->timestamp : 0;
+}
+
+uint64_t FlightReader::LastTimestamp() const
+{
+	const FlightFrameHeader *frame = total_frames ? FrameAt(total_frames - 1) : nullptr;
+	return frame ? frame->timestamp : 0;
+}
+
+size_t FlightReader::Seek(uint64_t timestamp) const
+{
+	// Timestamps are monotonic within a recording, so binary search frames
+	size_t lo = 0, hi = total_frames;
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (FrameAt(mid)->timestamp < timestamp)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+bool FlightReader::ReadStats(size_t index, FlightFrameStats &out) const
+{
+	const FlightFrameHeader *frame = FrameAt(index);
+	if (!frame)
+		return false;
+
+	out.timestamp = frame->timestamp;
+	out.peak = frame->peak;
+	out.rms = frame->rms;
+	out.flags = frame->flags;
+	return true;
+}
+
+bool FlightReader::ReadFrame(size_t index, FlightFrame &out) const
+{
+	if (!ReadStats(index, out.stats))
+		return false;
+
+	const uint8_t *values = (const uint8_t *)FrameAt(index) + sizeof(FlightFrameHeader);
+	out.bands.resize(header.band_count);
+
+	if (header.encoding == FLIGHT_ENCODING_FLOAT16) {
+		for (size_t i = 0; i < header.band_count; i++) {
+			uint16_t half;
+			memcpy(&half, values + i * 2, sizeof(half));
+			out.bands[i] = flight_decode_half(half);
+		}
+	} else {
+		for (size_t i = 0; i < header.band_count; i++)
+			out.bands[i] = flight_decode_log8(values[i]);
+	}
+	return true;
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "mapped-file.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Spectrum flight recorder
+// Appends timestamped band frames plus per-frame stats to a chunked binary
+// file (.glfr). Chunks are preallocated and memory-mapped ahead of time by
+// Maintain(), so Append() on the audio thread is a plain memory write.
+//
+// File layout (little endian):
+//   [FlightFileHeader, padded to FLIGHT_SEGMENT_ALIGN]
+//   [FlightChunkHeader][frame 0]...[frame chunk_frames-1]  (padded, repeated)
+// Each frame is a FlightFrameHeader followed by band_count encoded values,
+// padded to 8 bytes. A chunk's frame_count is only bumped after the frame is
+// fully written, so a crashed recording is still readable up to that point.
+
+#define FLIGHT_MAGIC 0x52464C47u       // "GLFR"
+#define FLIGHT_CHUNK_MAGIC 0x4B434C47u // "GLCK"
+#define FLIGHT_VERSION 1
+#define FLIGHT_SEGMENT_ALIGN MAPPED_SEGMENT_ALIGN
+
+enum FlightEncoding : uint32_t {
+	FLIGHT_ENCODING_LOG8 = 0,    // 8-bit log-quantised magnitude
+	FLIGHT_ENCODING_FLOAT16 = 1, // IEEE half float magnitude
+};
+
+enum FlightFrameFlags : uint32_t {
+	FLIGHT_FLAG_CLIPPED = 1 << 0,       // Input peak reached full scale
+	FLIGHT_FLAG_SILENT = 1 << 1,        // Input below the silence floor
+	FLIGHT_FLAG_DISCONTINUITY = 1 << 2, // Audio timestamp jumped (sync drift / dropout)
+};
+
+struct FlightFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t band_count;
+	uint32_t encoding;
+	uint32_t frame_size;   // Bytes per frame including its header
+	uint32_t chunk_frames; // Frames per chunk
+	uint32_t fft_size;
+	float analysis_rate; // Sample rate the FFT saw (after decimation)
+	uint64_t created_ns; // Wall clock, ns since the Unix epoch
+};
+
+struct FlightChunkHeader {
+	uint32_t magic;
+	std::atomic<uint32_t> frame_count;
+	uint64_t first_timestamp;
+	uint64_t last_timestamp;
+};
+
+struct FlightFrameHeader {
+	uint64_t timestamp; // OBS audio timestamp (ns) at the end of the analysis window
+	float peak;         // Input block peak (linear)
+	float rms;          // Input block RMS (linear)
+	uint32_t flags;     // FlightFrameFlags
+	uint32_t reserved;
+};
+
+// Stats that go with one band frame
+struct FlightFrameStats {
+	uint64_t timestamp;
+	float peak;
+	float rms;
+	uint32_t flags;
+};
+
+// Decoded frame as returned by the reader
+struct FlightFrame {
+	FlightFrameStats stats;
+	std::vector<float> bands;
+};
+
+class FlightRecorder {
+public:
+	~FlightRecorder() { Stop(); }
+
+	bool Start(const char *path, uint32_t band_count, FlightEncoding encoding, uint32_t fft_size,
+		   float analysis_rate);
+	void Stop();
+	bool IsRecording() const { return writer.IsOpen(); }
+
+	// Audio thread. Never blocks and never makes a syscall; if the next chunk
+	// isn't mapped yet the frame is dropped and counted.
+	void Append(const FlightFrameStats &stats, const float *bands, size_t count);
+
+	// Any non-audio thread (video tick). Maps the next chunk ahead of time
+	// and unmaps the retired one.
+	void Maintain() { writer.Maintain(); }
+
+	uint64_t FramesWritten() const { return frames_written.load(std::memory_order_relaxed); }
+	uint64_t FramesDropped() const { return frames_dropped.load(std::memory_order_relaxed); }
+	const std::string &Path() const { return writer.Path(); }
+
+	static size_t FrameSize(uint32_t band_count, FlightEncoding encoding);
+
+private:
+	void BeginChunk();
+
+	SegmentWriter writer;
+	FlightEncoding encoding = FLIGHT_ENCODING_LOG8;
+	uint32_t band_count = 0;
+	size_t frame_size = 0;
+	uint32_t chunk_frames = 0;
+	std::vector<float> db_scratch; // LOG8 encoding, band_count entries
+	void (*to_db)(const float *magnitude, float *db, size_t n, float floor_db) = nullptr;
+
+	std::atomic<uint64_t> frames_written{0};
+	std::atomic<uint64_t> frames_dropped{0};
+};
+
+class FlightReader {
+public:
+	~FlightReader() { Close(); }
+
+	bool Open(const char *path);
+	void Close();
+
+	const FlightFileHeader &Header() const { return header; }
+	size_t FrameCount() const { return total_frames; }
+	uint64_t FirstTimestamp() const;
+	uint64_t LastTimestamp() const;
+
+	// Index of the first frame at or after timestamp (FrameCount() if none)
+	size_t Seek(uint64_t timestamp) const;
+	bool ReadFrame(size_t index, FlightFrame &out) const;
+	bool ReadStats(size_t index, FlightFrameStats &out) const;
+
+private:
+	struct Chunk {
+		const uint8_t *frames;
+		size_t first_index;
+		uint32_t count;
+		uint64_t first_timestamp;
+	};
+
+	const FlightFrameHeader *FrameAt(size_t index) const;
+
+	MappedFile file;
+	const uint8_t *base = nullptr;
+	size_t mapped_size = 0;
+	FlightFileHeader header = {};
+	std::vector<Chunk> chunks;
+	size_t total_frames = 0;
+};
+
+// Band value codecs shared by the writer and the reader
+uint8_t flight_encode_log8(float magnitude);
+float flight_decode_log8(uint8_t value);
+uint16_t flight_encode_half(float value);
+float flight_decode_half(uint16_t value);
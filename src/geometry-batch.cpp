@@ -0,0 +1,62 @@
+#include "geometry-batch.hpp"
+
+bool GeometryBatch::Create(size_t max_vertices)
+{
+	Destroy();
+
+	struct gs_vb_data *data = gs_vbdata_create();
+	data->num = max_vertices;
+	data->points = (struct vec3 *)bzalloc(sizeof(struct vec3) * max_vertices);
+	data->colors = (uint32_t *)bzalloc(sizeof(uint32_t) * max_vertices);
+	data->num_tex = 1;
+	data->tvarray = (struct gs_tvertarray *)bzalloc(sizeof(struct gs_tvertarray));
+	data->tvarray[0].width = 2;
+	data->tvarray[0].array = bzalloc(sizeof(struct vec2) * max_vertices);
+
+	vb = gs_vertexbuffer_create(data, GS_DYNAMIC);
+	if (!vb)
+		return false;
+
+	// The buffer keeps its data; vertices are written straight into it
+	data = gs_vertexbuffer_get_data(vb);
+	points = data->points;
+	colors = data->colors;
+	uv = (struct vec2 *)data->tvarray[0].array;
+	capacity = max_vertices;
+	Begin();
+	return true;
+}
+
+void GeometryBatch::Destroy()
+{
+	gs_vertexbuffer_destroy(vb);
+	vb = nullptr;
+	points = nullptr;
+	colors = nullptr;
+	uv = nullptr;
+	capacity = 0;
+	count = 0;
+}
+
+void GeometryBatch::Upload()
+{
+	if (!vb || count < 3)
+		return;
+
+	// Only the vertices written this frame go to the GPU
+	struct gs_vb_data upload = *gs_vertexbuffer_get_data(vb);
+	upload.num = count;
+	gs_vertexbuffer_flush_direct(vb, &upload);
+}
+
+void GeometryBatch::DrawRange(gs_effect_t *effect, const char *technique, size_t start, size_t vertices)
+{
+	if (!vb || !effect || vertices < 3 || start + vertices > count)
+		return;
+
+	gs_load_vertexbuffer(vb);
+	gs_load_indexbuffer(nullptr);
+	while (gs_effect_loop(effect, technique))
+		gs_draw(GS_TRISTRIP, (uint32_t)start, (uint32_t)vertices);
+	gs_load_vertexbuffer(nullptr);
+}
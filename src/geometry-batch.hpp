@@ -0,0 +1,116 @@
+#pragma once
+
+#include <obs.h>
+#include <graphics/vec2.h>
+#include <graphics/vec3.h>
+#include <cstddef>
+#include <cstdint>
+
+// Batched 2D geometry with per-vertex colour
+// Everything a mode draws in a frame (fills, bars, dots and anti-aliased
+// strokes) is appended to one triangle strip and drawn with a single
+// gs_draw. Separate pieces are joined with degenerate triangles.
+//
+// Each vertex carries an ABGR colour and an edge term for geometry.effect:
+// u is the position across a stroke (+-1 at its outer edges, 0 for fills)
+// and f the fraction of the half width that fades out.
+//
+// A transform and opacity can be set for the vertices that follow, so pieces
+// placed differently (compositor layers) still share the one upload; ranges
+// of the batch can then be drawn with different blend states.
+
+class GeometryBatch {
+public:
+	// Graphics thread (inside obs_enter_graphics)
+	bool Create(size_t max_vertices);
+	void Destroy();
+
+	void Begin()
+	{
+		count = 0;
+		restart = false;
+		placed = false;
+	}
+
+	// Maps the following vertices through the row-major 2x3 `matrix` and
+	// scales their alpha by `opacity`
+	void SetTransform(const float matrix[6], float opacity)
+	{
+		for (int i = 0; i < 6; i++)
+			m[i] = matrix[i];
+		alpha_scale = opacity <= 0.0f ? 0 : opacity >= 1.0f ? 256 : (uint32_t)(opacity * 256.0f);
+		placed = true;
+	}
+	void ClearTransform() { placed = false; }
+
+	// Ends the current piece; the next vertex starts a new one
+	void Break() { restart = count > 0; }
+
+	// Vertices left, keeping room for the join into a new piece
+	size_t Available() const { return capacity > count + 2 ? capacity - count - 2 : 0; }
+
+	// Dropped once the batch is full
+	void Vertex(float x, float y, uint32_t abgr, float u = 0.0f, float f = 1.0f)
+	{
+		if (count + 3 > capacity)
+			return;
+		if (placed) {
+			float tx = m[0] * x + m[1] * y + m[2];
+			y = m[3] * x + m[4] * y + m[5];
+			x = tx;
+			abgr = (abgr & 0x00FFFFFF) | ((((abgr >> 24) * alpha_scale) >> 8) << 24);
+		}
+		if (restart) {
+			Put(points[count - 1].x, points[count - 1].y, colors[count - 1], uv[count - 1].x, uv[count - 1].y);
+			Put(x, y, abgr, u, f);
+			restart = false;
+		}
+		Put(x, y, abgr, u, f);
+	}
+
+	// Axis-aligned box as its own piece, top and bottom colours
+	void Rect(float x0, float y0, float x1, float y1, uint32_t top, uint32_t bottom)
+	{
+		Break();
+		Vertex(x0, y0, top);
+		Vertex(x0, y1, bottom);
+		Vertex(x1, y0, top);
+		Vertex(x1, y1, bottom);
+		Break();
+	}
+	void Rect(float x0, float y0, float x1, float y1, uint32_t abgr) { Rect(x0, y0, x1, y1, abgr, abgr); }
+
+	size_t Count() const { return count; }
+
+	// Uploads the vertices written since Begin() and draws them with the
+	// given technique of `effect` (parameters already set)
+	void Draw(gs_effect_t *effect, const char *technique)
+	{
+		Upload();
+		DrawRange(effect, technique, 0, count);
+	}
+
+	// The same in two steps, for drawing parts of one upload separately
+	void Upload();
+	void DrawRange(gs_effect_t *effect, const char *technique, size_t start, size_t vertices);
+
+private:
+	void Put(float x, float y, uint32_t abgr, float u, float f)
+	{
+		vec3_set(&points[count], x, y, 0.0f);
+		colors[count] = abgr;
+		vec2_set(&uv[count], u, f);
+		count++;
+	}
+
+	gs_vertbuffer_t *vb = nullptr;
+	struct vec3 *points = nullptr; // Owned by the vertex buffer's data
+	uint32_t *colors = nullptr;
+	struct vec2 *uv = nullptr;
+	size_t capacity = 0;
+	size_t count = 0;
+	bool restart = false;
+	bool placed = false;
+	float m[6] = {1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f};
+	uint32_t alpha_scale = 256;
+};
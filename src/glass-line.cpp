@@ -1,5 +1,6 @@
 #include "glass-line.hpp"
-#include "fft-utils.hpp"
+#include "audio-tap.hpp"
+#include "plugin-support.h"
 #include <obs-module.h>
 #include <util/platform.h>
 #include <util/circlebuf.h>
@@ -7,6 +8,11 @@
 #include <graphics/graphics.h>
 #include <graphics/vec2.h>
 #include <graphics/vec4.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <ctime>
 
 #define S_SOURCE "source"
 #define S_MODE "mode"
@@ -17,8 +23,43 @@
 #define S_GLOW_STRENGTH "glow_strength"
 #define S_THICKNESS "thickness"
 #define S_LINE_WIDTH "line_width"
-#define S_SMOOTHING "smoothing"
+#define S_LINE_JOIN "line_join"
+#define S_GRADIENT "gradient"
+#define S_BEAT_PULSE "beat_pulse"
+#define S_PEAK_HOLD "peak_hold"
+#define S_GOVERNOR "quality_governor"
+#define S_ATTACK_MS "attack_ms"
+#define S_RELEASE_MS "release_ms"
+#define S_HOP_MS "hop_ms"
+#define S_SMOOTHING "smoothing" // Replaced by S_ATTACK_MS and S_RELEASE_MS; read once to convert
 #define S_AMP_SCALE "amp_scale"
+#define S_DECIMATE "decimate"
+#define S_TOP_FREQ "top_freq"
+#define S_WINDOW_MS "window_ms"
+#define S_TRIGGER "trigger"
+#define S_RECORD "record"
+#define S_RECORD_PATH "record_path"
+#define S_RECORD_ENCODING "record_encoding"
+#define S_REPLAY_FILE "replay_file"
+#define S_REPLAY_START "replay_start"
+#define S_CAPTURE "capture_callbacks"
+#define S_LATENCY_LOG "latency_log"
+#define S_LATENCY_EXPORT "latency_export"
+#define S_SHM "shm_publish"
+#define S_SHM_NAME "shm_name"
+#define S_LAYERS "layers"
+#define S_LAYER "layer"
+#define S_LAYER_EDITED "layer_edited"
+#define S_LAYER_ADD "layer_add"
+#define S_LAYER_REMOVE "layer_remove"
+#define S_LAYER_X "layer_x"
+#define S_LAYER_Y "layer_y"
+#define S_LAYER_SCALE "layer_scale"
+#define S_LAYER_ROTATION "layer_rotation"
+#define S_LAYER_OPACITY "layer_opacity"
+#define S_LAYER_BLEND "layer_blend"
+#define S_LOUDNESS_TARGET "loudness_target"
+#define S_LOUDNESS_RESET "loudness_reset"
 
 #define T_SOURCE "Audio Source"
 #define T_MODE "Visual Mode"
@@ -29,8 +70,121 @@
 #define T_GLOW_STRENGTH "Glow Strength"
 #define T_THICKNESS "Thickness"
 #define T_LINE_WIDTH "Line Width"
-#define T_SMOOTHING "Smoothing"
+#define T_LINE_JOIN "Line Joins"
+#define T_GRADIENT "Gradient"
+#define T_BEAT_PULSE "Beat Pulse"
+#define T_PEAK_HOLD "Peak Hold (Spectrum Bars)"
+#define T_GOVERNOR "Adaptive Quality"
+#define T_ATTACK_MS "Attack (ms)"
+#define T_RELEASE_MS "Release (ms)"
+#define T_HOP_MS "Analysis Interval (ms)"
 #define T_AMP_SCALE "Amplitude Scale"
+#define T_DECIMATE "Low-Frequency Focus (Decimate)"
+#define T_TOP_FREQ "Top Frequency (Hz)"
+#define T_WINDOW_MS "Time Window (ms)"
+#define T_TRIGGER "Oscilloscope Trigger"
+#define T_RECORD "Flight Recorder"
+#define T_RECORD_PATH "Recording Folder"
+#define T_RECORD_ENCODING "Recording Format"
+#define T_REPLAY_FILE "Replay Recording"
+#define T_REPLAY_START "Replay Start (s)"
+#define T_CAPTURE "Capture Audio Callbacks"
+#define T_LATENCY_LOG "Log Latency Stats"
+#define T_LATENCY_EXPORT "Export Latency CSV"
+#define T_SHM "Publish to Shared Memory"
+#define T_SHM_NAME "Shared Memory Name"
+#define T_LAYER "Edit Layer"
+#define T_LAYER_ADD "Add Layer"
+#define T_LAYER_REMOVE "Remove Layer"
+#define T_LAYER_X "Layer Offset X (%)"
+#define T_LAYER_Y "Layer Offset Y (%)"
+#define T_LAYER_SCALE "Layer Scale (%)"
+#define T_LAYER_ROTATION "Layer Rotation (degrees)"
+#define T_LAYER_OPACITY "Layer Opacity (%)"
+#define T_LAYER_BLEND "Layer Blend"
+#define T_LOUDNESS_TARGET "Loudness Target (LUFS)"
+#define T_LOUDNESS_RESET "Reset Integrated Loudness"
+
+// Upper ends of the Attack and Release sliders (ms)
+#define MAX_ATTACK_MS 1000.0
+#define MAX_RELEASE_MS 5000.0
+
+// Shared-memory feed: room for the largest FFT, and about a second at the fastest hop
+#define SHM_MAX_BANDS 4096
+#define SHM_SLOTS 64
+#define SHM_DEFAULT_NAME_MAX 30 // macOS caps shm_open() names at 31 bytes with the slash
+
+// Joins a source and audio tap name in the Audio Source setting
+#define TAP_SEPARATOR '\x1f'
+
+// Fewest bands the governor pools the spectrum down to
+#define MIN_POOLED_BANDS 32
+
+// Bar counts of Mirrored Bars and Pixel Bars. With only these shown the
+// analyzer can evaluate just the bars' bands.
+#define MIRRORED_BARS 64
+#define PIXEL_BARS 32
+
+// Pitch confidence needed for a note to take over the pitch-driven visuals
+#define PITCH_MIN_CONFIDENCE 0.85f
+
+// Bottom of the loudness scales (LUFS and dBTP); the top is 0
+#define LOUDNESS_FLOOR -60.0f
+#define TRUE_PEAK_LIMIT -1.0f // dBTP marked on the true peak bar
+
+// Line tessellation limit; longer curves are cut short rather than reallocated
+#define MAX_POLYLINE_POINTS 4096
+// Vertices one frame's batch can hold, shapes past it are dropped
+#define MAX_BATCH_VERTICES 131072
+#define AA_FEATHER 1.0f // Anti-aliased edge width (px)
+
+// Decay of the amplitude bump after a detected beat
+#define BEAT_PULSE_DECAY_NS 120000000.0
+
+// Widest output the per-column scratch buffers are reserved for
+#define MAX_RENDER_COLUMNS 4096
+
+// Spectrogram ring texture size (columns x history rows)
+#define SPECTROGRAM_COLUMNS 512
+#define SPECTROGRAM_ROWS 1080
+
+// Vectorscope trace added per second of audio, spread over the cells it
+// covers, and the share of the source height the correlation meter takes
+#define SCOPE_TRACE_MASS 2048.0f
+#define SCOPE_METER_FRACTION 0.05f
+
+// Helper to fix color format (OBS uses ABGR, we have ARGB)
+static uint32_t fix_color(uint32_t argb)
+{
+	uint8_t a = (argb >> 24) & 0xFF;
+	uint8_t r = (argb >> 16) & 0xFF;
+	uint8_t g = (argb >> 8) & 0xFF;
+	uint8_t b = argb & 0xFF;
+	return (a << 24) | (b << 16) | (g << 8) | r; // ABGR
+}
+
+// Start colour (ABGR) turned to the hue of the note's pitch class: C red,
+// then around the colour wheel a semitone at a time, fully saturated at the
+// start colour's brightness and opacity. Before any note, the start colour.
+static uint32_t pitch_color(uint32_t abgr, float pitch_hz)
+{
+	if (!(pitch_hz > 0.0f))
+		return abgr;
+	float semitones = 12.0f * log2f(pitch_hz / 440.0f) + 9.0f; // Above a C
+	int note = (int)lroundf(semitones) % 12;
+	if (note < 0)
+		note += 12;
+
+	float r = (float)(abgr & 0xFF), g = (float)((abgr >> 8) & 0xFF), b = (float)((abgr >> 16) & 0xFF);
+	float v = std::max(r, std::max(g, b));
+	// Odd notes sit halfway between two of the six primaries and secondaries
+	static const float wheel[12][3] = {{1, 0, 0}, {1, 0.5f, 0}, {1, 1, 0}, {0.5f, 1, 0}, {0, 1, 0}, {0, 1, 0.5f},
+					   {0, 1, 1}, {0, 0.5f, 1}, {0, 0, 1}, {0.5f, 0, 1}, {1, 0, 1}, {1, 0, 0.5f}};
+	uint32_t out_r = (uint32_t)(wheel[note][0] * v + 0.5f);
+	uint32_t out_g = (uint32_t)(wheel[note][1] * v + 0.5f);
+	uint32_t out_b = (uint32_t)(wheel[note][2] * v + 0.5f);
+	return (abgr & 0xFF000000) | (out_b << 16) | (out_g << 8) | out_r;
+}
 
 static void audio_capture_callback(void *param, obs_source_t *source, const struct audio_data *audio_data, bool muted)
 {
@@ -40,851 +194,1562 @@ static void audio_capture_callback(void *param, obs_source_t *source, const stru
 	context->AudioCallback(audio_data);
 }
 
+static void audio_tap_callback(void *param, const struct audio_data *audio_data)
+{
+	GlassLineSource *context = (GlassLineSource *)param;
+	context->AudioCallback(audio_data);
+}
+
+// "filter_remove" of the bound source
+static void filter_remove_callback(void *param, calldata_t *cd)
+{
+	GlassLineSource *context = (GlassLineSource *)param;
+	context->TapRemoved((obs_source_t *)calldata_ptr(cd, "filter"));
+}
+
 GlassLineSource::GlassLineSource(obs_source_t *source) : source(source)
 {
 	// Initialize defaults
-	mode = 0;
 	color = 0xFFFFFFFF;
-	color_start = 0xFFFFE7C1; // Light orange/cream
-	color_end = 0xFFB63814;   // Dark orange/red
-	glow_color = 0xFFFF7832;  // Orange glow
-	glow_strength = 0.5f;
-	thickness = 2.0f;
-	line_width = 4.0f;
-	smoothing = 0.5f;
-	amp_scale = 1.0f;
 
 	parent_source = source;
 
-	// FFT Buffer Init
-	fft_input_buffer.reserve(2048);
+	// Render-side scratch is sized up front so drawing never allocates
+	wave_min.reserve(MAX_RENDER_COLUMNS);
+	wave_max.reserve(MAX_RENDER_COLUMNS);
+	poly_x.resize(MAX_POLYLINE_POINTS);
+	poly_y.resize(MAX_POLYLINE_POINTS);
+	poly_c.resize(MAX_POLYLINE_POINTS);
+	poly_glow.resize(MAX_POLYLINE_POINTS);
+	poly_end.resize(MAX_POLYLINE_POINTS);
+	tessellator.Reserve(MAX_POLYLINE_POINTS);
+	layer_draws.reserve(MAX_LAYERS);
+
+	char *spectrogram_path = obs_module_file("spectrogram.effect");
+	char *geometry_path = obs_module_file("geometry.effect");
+	char *vectorscope_path = obs_module_file("vectorscope.effect");
+	obs_enter_graphics();
+	spectrogram_effect = gs_effect_create_from_file(spectrogram_path, nullptr);
+	geometry_effect = gs_effect_create_from_file(geometry_path, nullptr);
+	vectorscope_effect = gs_effect_create_from_file(vectorscope_path, nullptr);
+	if (!batch.Create(MAX_BATCH_VERTICES))
+		obs_log(LOG_ERROR, "Failed to create the %d-vertex geometry buffer", MAX_BATCH_VERTICES);
+	obs_leave_graphics();
+	bfree(spectrogram_path);
+	bfree(geometry_path);
+	bfree(vectorscope_path);
 }
 
 GlassLineSource::~GlassLineSource()
 {
-	if (audio_source_obj) {
-		obs_source_remove_audio_capture_callback(audio_source_obj, audio_capture_callback, this);
-		obs_source_release(audio_source_obj);
-	}
+	SetAudioSource(nullptr);
+
+	obs_enter_graphics();
+	gs_effect_destroy(spectrogram_effect);
+	gs_effect_destroy(geometry_effect);
+	gs_effect_destroy(vectorscope_effect);
+	batch.Destroy();
+	gs_texture_destroy(spec_row_tex);
+	gs_texrender_destroy(spec_ring);
+	gs_texture_destroy(scope_hits_tex);
+	gs_texrender_destroy(scope_trace);
+	gs_texrender_destroy(scaled_target);
+	obs_leave_graphics();
 }
 
+// `name` is a source, or a source and one of its Audio Tap filters joined by
+// TAP_SEPARATOR. A tap hands over the audio at its place in the filter chain;
+// a plain source is captured after all of its filters. The tap is only held
+// weakly, so removing it from the source's filters still destroys it.
 void GlassLineSource::SetAudioSource(const char *name)
 {
-	if (audio_source_obj) {
+	// Disconnecting waits out a TapRemoved() in progress, and none can start
+	// after it, so the binding below is ours alone to change
+	if (audio_source_obj)
+		signal_handler_disconnect(obs_source_get_signal_handler(audio_source_obj), "filter_remove",
+					  filter_remove_callback, this);
+
+	if (tap_filter) {
+		obs_source_t *filter = obs_weak_source_get_source(tap_filter);
+		audio_tap_remove_listener(filter, audio_tap_callback, this); // Nothing to do if it's gone
+		obs_source_release(filter);
+		obs_weak_source_release(tap_filter);
+		tap_filter = nullptr;
+	} else if (audio_source_obj) {
 		obs_source_remove_audio_capture_callback(audio_source_obj, audio_capture_callback, this);
+	}
+	if (audio_source_obj) {
 		obs_source_release(audio_source_obj);
 		audio_source_obj = nullptr;
 	}
 
-	if (name && *name) {
-		audio_source_obj = obs_get_source_by_name(name);
-		if (audio_source_obj) {
-			obs_source_add_audio_capture_callback(audio_source_obj, audio_capture_callback, this);
+	if (!name || !*name)
+		return;
+
+	std::string source_name = name;
+	std::string filter_name;
+	size_t separator = source_name.find(TAP_SEPARATOR);
+	if (separator != std::string::npos) {
+		filter_name = source_name.substr(separator + 1);
+		source_name.resize(separator);
+	}
+
+	audio_source_obj = obs_get_source_by_name(source_name.c_str());
+	if (!audio_source_obj)
+		return;
+
+	if (!filter_name.empty()) {
+		obs_source_t *filter = obs_source_get_filter_by_name(audio_source_obj, filter_name.c_str());
+		bool tapped = filter && audio_tap_add_listener(filter, audio_tap_callback, this);
+		if (tapped) {
+			tap_filter = obs_source_get_weak_source(filter);
+			signal_handler_connect(obs_source_get_signal_handler(audio_source_obj), "filter_remove",
+					       filter_remove_callback, this);
 		}
+		obs_source_release(filter);
+		if (tapped)
+			return;
+		obs_log(LOG_WARNING, "'%s' has no audio tap named '%s', capturing its output instead",
+			source_name.c_str(), filter_name.c_str());
+	}
+	obs_source_add_audio_capture_callback(audio_source_obj, audio_capture_callback, this);
+}
+
+// A filter left the bound source's chain. If it's our tap, fall back to
+// capturing the source's output, as for a name without a tap. Runs inside the
+// signal, with the filter still alive.
+void GlassLineSource::TapRemoved(obs_source_t *filter)
+{
+	if (!tap_filter || !obs_weak_source_references_source(tap_filter, filter))
+		return;
+
+	audio_tap_remove_listener(filter, audio_tap_callback, this);
+	obs_weak_source_release(tap_filter);
+	tap_filter = nullptr;
+	obs_log(LOG_WARNING, "Audio tap '%s' was removed from '%s', capturing its output instead",
+		obs_source_get_name(filter), obs_source_get_name(audio_source_obj));
+	obs_source_add_audio_capture_callback(audio_source_obj, audio_capture_callback, this);
+}
+
+// In place: value k becomes the largest of values [k * stride, (k + 1) * stride)
+static void pool_bands(float *values, size_t count, size_t stride)
+{
+	for (size_t k = 0; k < count / stride; k++) {
+		float value = values[k * stride];
+		for (size_t j = 1; j < stride; j++)
+			value = values[k * stride + j] > value ? values[k * stride + j] : value;
+		values[k] = value;
 	}
 }
 
+// Settings that belong to a layer. The top-level copies are the layer being
+// edited; S_LAYERS items hold every layer's own.
+enum LayerKeyType { LAYER_KEY_INT, LAYER_KEY_DOUBLE, LAYER_KEY_BOOL };
+static const struct {
+	const char *name;
+	LayerKeyType type;
+} layer_keys[] = {
+	{S_MODE, LAYER_KEY_INT},          {S_COLOR_START, LAYER_KEY_INT},      {S_COLOR_END, LAYER_KEY_INT},
+	{S_GLOW_COLOR, LAYER_KEY_INT},    {S_GLOW_STRENGTH, LAYER_KEY_DOUBLE}, {S_THICKNESS, LAYER_KEY_DOUBLE},
+	{S_LINE_WIDTH, LAYER_KEY_DOUBLE}, {S_LINE_JOIN, LAYER_KEY_INT},        {S_GRADIENT, LAYER_KEY_INT},
+	{S_AMP_SCALE, LAYER_KEY_DOUBLE},  {S_BEAT_PULSE, LAYER_KEY_DOUBLE},    {S_PEAK_HOLD, LAYER_KEY_BOOL},
+	{S_WINDOW_MS, LAYER_KEY_DOUBLE},  {S_TRIGGER, LAYER_KEY_BOOL},         {S_LAYER_X, LAYER_KEY_DOUBLE},
+	{S_LAYER_Y, LAYER_KEY_DOUBLE},    {S_LAYER_SCALE, LAYER_KEY_DOUBLE},   {S_LAYER_ROTATION, LAYER_KEY_DOUBLE},
+	{S_LAYER_OPACITY, LAYER_KEY_DOUBLE}, {S_LAYER_BLEND, LAYER_KEY_INT},
+};
+
+static void copy_layer_settings(obs_data_t *from, obs_data_t *to)
+{
+	for (const auto &key : layer_keys) {
+		switch (key.type) {
+		case LAYER_KEY_INT:
+			obs_data_set_int(to, key.name, obs_data_get_int(from, key.name));
+			break;
+		case LAYER_KEY_DOUBLE:
+			obs_data_set_double(to, key.name, obs_data_get_double(from, key.name));
+			break;
+		case LAYER_KEY_BOOL:
+			obs_data_set_bool(to, key.name, obs_data_get_bool(from, key.name));
+			break;
+		}
+	}
+}
+
+static void set_layer_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_int(settings, S_MODE, 0);
+	obs_data_set_default_int(settings, S_COLOR_START, 0xFFFFE7C1);
+	obs_data_set_default_int(settings, S_COLOR_END, 0xFFB63814);
+	obs_data_set_default_int(settings, S_GLOW_COLOR, 0xFFFF7832);
+	obs_data_set_default_double(settings, S_GLOW_STRENGTH, 0.5);
+	obs_data_set_default_double(settings, S_THICKNESS, 2.0);
+	obs_data_set_default_double(settings, S_LINE_WIDTH, 4.0);
+	obs_data_set_default_int(settings, S_LINE_JOIN, POLYLINE_JOIN_ROUND);
+	obs_data_set_default_int(settings, S_GRADIENT, GRADIENT_SOLID);
+	obs_data_set_default_double(settings, S_AMP_SCALE, 1.0);
+	obs_data_set_default_double(settings, S_BEAT_PULSE, 0.0);
+	obs_data_set_default_bool(settings, S_PEAK_HOLD, false);
+	obs_data_set_default_double(settings, S_WINDOW_MS, 50.0);
+	obs_data_set_default_bool(settings, S_TRIGGER, true);
+	obs_data_set_default_double(settings, S_LAYER_X, 0.0);
+	obs_data_set_default_double(settings, S_LAYER_Y, 0.0);
+	obs_data_set_default_double(settings, S_LAYER_SCALE, 100.0);
+	obs_data_set_default_double(settings, S_LAYER_ROTATION, 0.0);
+	obs_data_set_default_double(settings, S_LAYER_OPACITY, 100.0);
+	obs_data_set_default_int(settings, S_LAYER_BLEND, LAYER_BLEND_NORMAL);
+}
+
+static void read_layer(obs_data_t *settings, VisualLayer &layer)
+{
+	layer.mode = (int)obs_data_get_int(settings, S_MODE);
+	layer.glow_strength = (float)obs_data_get_double(settings, S_GLOW_STRENGTH);
+	layer.thickness = (float)obs_data_get_double(settings, S_THICKNESS);
+	layer.line_width = (float)obs_data_get_double(settings, S_LINE_WIDTH);
+	layer.line_join = (int)obs_data_get_int(settings, S_LINE_JOIN);
+	layer.gradient_mode = (int)obs_data_get_int(settings, S_GRADIENT);
+	layer.amp_scale = (float)obs_data_get_double(settings, S_AMP_SCALE);
+	layer.beat_pulse = (float)obs_data_get_double(settings, S_BEAT_PULSE);
+	layer.peak_hold = obs_data_get_bool(settings, S_PEAK_HOLD);
+	layer.window_ms = (float)obs_data_get_double(settings, S_WINDOW_MS);
+	layer.trigger = obs_data_get_bool(settings, S_TRIGGER);
+	layer.offset_x = (float)obs_data_get_double(settings, S_LAYER_X) / 100.0f;
+	layer.offset_y = (float)obs_data_get_double(settings, S_LAYER_Y) / 100.0f;
+	layer.scale = (float)obs_data_get_double(settings, S_LAYER_SCALE) / 100.0f;
+	layer.rotation = (float)obs_data_get_double(settings, S_LAYER_ROTATION);
+	layer.opacity = (float)obs_data_get_double(settings, S_LAYER_OPACITY) / 100.0f;
+	layer.blend = (int)obs_data_get_int(settings, S_LAYER_BLEND);
+
+	// Vertex colours are ABGR; convert once here rather than every frame
+	layer.start_abgr = fix_color((uint32_t)obs_data_get_int(settings, S_COLOR_START));
+	layer.end_abgr = fix_color((uint32_t)obs_data_get_int(settings, S_COLOR_END));
+	layer.glow_abgr = fix_color((uint32_t)obs_data_get_int(settings, S_GLOW_COLOR));
+	if (layer.gradient_mode == GRADIENT_SOLID)
+		layer.gradient.Fill(layer.start_abgr);
+	else
+		layer.gradient.Build(layer.start_abgr, layer.end_abgr);
+}
+
+// Scenes saved before attack and release times have a single smoothing
+// factor s, kept from the previous spectrum once per audio callback of 1024
+// frames, up or down alike. The same decay is a time constant of
+// -block_ms / ln(s) for both. The old key is dropped once converted.
+static void convert_smoothing(obs_data_t *settings)
+{
+	if (!obs_data_has_user_value(settings, S_SMOOTHING))
+		return;
+
+	if (!obs_data_has_user_value(settings, S_ATTACK_MS) && !obs_data_has_user_value(settings, S_RELEASE_MS)) {
+		audio_t *audio = obs_get_audio();
+		double rate = audio ? (double)audio_output_get_sample_rate(audio) : 48000.0;
+		double block_ms = 1024.0 * 1000.0 / rate;
+		double s = obs_data_get_double(settings, S_SMOOTHING);
+		double tau_ms = s <= 0.0 ? 0.0 : s >= 1.0 ? INFINITY : -block_ms / log(s);
+		double attack_ms = std::min(tau_ms, MAX_ATTACK_MS);
+		double release_ms = std::min(tau_ms, MAX_RELEASE_MS);
+		obs_data_set_double(settings, S_ATTACK_MS, attack_ms);
+		obs_data_set_double(settings, S_RELEASE_MS, release_ms);
+		obs_log(LOG_INFO, "Converted smoothing %.2f to %.0f ms attack, %.0f ms release", s, attack_ms,
+			release_ms);
+	}
+	obs_data_erase(settings, S_SMOOTHING);
+}
+
 void GlassLineSource::Update(obs_data_t *settings)
 {
+	convert_smoothing(settings);
+
 	const char *new_source_name = obs_data_get_string(settings, S_SOURCE);
 	if (audio_source_name != new_source_name) {
 		audio_source_name = new_source_name;
 		SetAudioSource(audio_source_name.c_str());
 	}
 
-	mode = (int)obs_data_get_int(settings, S_MODE);
 	color = (uint32_t)obs_data_get_int(settings, S_COLOR);
-	color_start = (uint32_t)obs_data_get_int(settings, S_COLOR_START);
-	color_end = (uint32_t)obs_data_get_int(settings, S_COLOR_END);
-	glow_color = (uint32_t)obs_data_get_int(settings, S_GLOW_COLOR);
-	glow_strength = (float)obs_data_get_double(settings, S_GLOW_STRENGTH);
-	thickness = (float)obs_data_get_double(settings, S_THICKNESS);
-	line_width = (float)obs_data_get_double(settings, S_LINE_WIDTH);
-	smoothing = (float)obs_data_get_double(settings, S_SMOOTHING);
-	amp_scale = (float)obs_data_get_double(settings, S_AMP_SCALE);
+	CoreSettings core;
+	core.attack_ms = (float)obs_data_get_double(settings, S_ATTACK_MS);
+	core.release_ms = (float)obs_data_get_double(settings, S_RELEASE_MS);
+	core.hop_ms = (float)obs_data_get_double(settings, S_HOP_MS);
+	core.governor = obs_data_get_bool(settings, S_GOVERNOR);
+	core.decimate = obs_data_get_bool(settings, S_DECIMATE);
+	core.top_freq = (float)obs_data_get_int(settings, S_TOP_FREQ);
+	loudness_target = (float)obs_data_get_double(settings, S_LOUDNESS_TARGET);
+
+	// The style controls edit one layer; S_LAYERS holds all of them once
+	// there is more than one
+	std::vector<VisualLayer> new_layers;
+	obs_data_array_t *array = obs_data_get_array(settings, S_LAYERS);
+	size_t layer_count = array ? obs_data_array_count(array) : 0;
+	if (layer_count == 0) {
+		new_layers.resize(1);
+		read_layer(settings, new_layers[0]);
+	} else {
+		long long edit = obs_data_get_int(settings, S_LAYER);
+		edit = edit < 0 ? 0 : edit >= (long long)layer_count ? (long long)layer_count - 1 : edit;
+		obs_data_t *edited = obs_data_array_item(array, (size_t)edit);
+		copy_layer_settings(settings, edited);
+		obs_data_release(edited);
+		obs_data_set_int(settings, S_LAYER_EDITED, edit);
+
+		new_layers.resize(layer_count < MAX_LAYERS ? layer_count : MAX_LAYERS);
+		for (size_t i = 0; i < new_layers.size(); i++) {
+			obs_data_t *item = obs_data_array_item(array, i);
+			set_layer_defaults(item);
+			read_layer(item, new_layers[i]);
+			obs_data_release(item);
+		}
+	}
+	obs_data_array_release(array);
+	for (const VisualLayer &l : new_layers) {
+		core.peak_hold = core.peak_hold || l.peak_hold;
+		core.loudness = core.loudness || l.mode == 14 || l.mode == 15;
+		core.pitch = core.pitch || l.mode == 7 || l.gradient_mode == GRADIENT_PITCH;
+		core.scope = core.scope || l.mode == 16;
+	}
+
+	// Only the bars' bands need analysing when every layer shows the same bars
+	for (size_t i = 0; i < new_layers.size(); i++) {
+		int mode = new_layers[i].mode;
+		size_t bars = mode == 2 ? MIRRORED_BARS : mode == 8 ? PIXEL_BARS : 0;
+		if (bars == 0 || (i > 0 && bars != core.bands)) {
+			core.bands = 0;
+			break;
+		}
+		core.bands = bars;
+	}
+
+	audio_t *audio = obs_get_audio();
+	core.sample_rate = audio ? (float)audio_output_get_sample_rate(audio) : 48000.0f;
+	core.channels = audio ? audio_output_get_channels(audio) : 2;
+
+	// new_layers comes back holding the old layers, freed outside the lock
+	ApplySettings(core, new_layers);
+
+	UpdateFlight(settings);
 }
 
-void GlassLineSource::AudioCallback(const struct audio_data *data)
+// Timestamped file in the recording folder (or the module config dir)
+static std::string recording_path(std::string dir, const char *extension)
+{
+	if (dir.empty()) {
+		char *config_dir = obs_module_config_path("flight");
+		dir = config_dir ? config_dir : "";
+		bfree(config_dir);
+	}
+	os_mkdirs(dir.c_str());
+
+	char name[64];
+	time_t now = time(nullptr);
+	strftime(name, sizeof(name), "glassline-%Y%m%d-%H%M%S.", localtime(&now));
+	return dir + "/" + name + extension;
+}
+
+void GlassLineSource::UpdateFlight(obs_data_t *settings)
 {
-	std::lock_guard<std::mutex> lock(audio_mutex);
+	bool record = obs_data_get_bool(settings, S_RECORD);
+	std::string dir = obs_data_get_string(settings, S_RECORD_PATH);
+	int encoding = (int)obs_data_get_int(settings, S_RECORD_ENCODING);
+	std::string new_replay = obs_data_get_string(settings, S_REPLAY_FILE);
+
+	std::lock_guard<CoreMutex> guard(flight_mutex);
+
+	UpdateCapture(obs_data_get_bool(settings, S_CAPTURE), dir);
+	UpdatePublisher(obs_data_get_bool(settings, S_SHM), obs_data_get_string(settings, S_SHM_NAME));
+
+	// Replay
+	replay_start = obs_data_get_double(settings, S_REPLAY_START);
+	if (new_replay != replay_path) {
+		replay_path = new_replay;
+		if (!SetReplay(replay_path))
+			obs_log(LOG_WARNING, "Could not open flight recording '%s'", replay_path.c_str());
+	}
 
-	size_t frames = data->frames;
-	if (frames == 0)
+	// Recording. Anything that changes the band layout starts a new file.
+	std::string key;
+	if (record && !replaying) {
+		key = dir + "|" + std::to_string(encoding) + "|" + std::to_string(analysis_rate) + "|" +
+		      std::to_string(top_freq) + "|" + std::to_string(fft_size);
+	}
+	if (key == record_key)
 		return;
+	record_key = key;
 
-	// Accumulate samples for FFT
-	// We need a power of 2, say 1024 or 2048
-	const size_t fft_size = 2048;
+	std::unique_ptr<FlightRecorder> old = SwapRecorder(nullptr);
+	if (old) {
+		obs_log(LOG_INFO, "Flight recording stopped: %s (%llu frames, %llu dropped)", old->Path().c_str(),
+			(unsigned long long)old->FramesWritten(), (unsigned long long)old->FramesDropped());
+		old.reset();
+	}
 
-	// Just take the first channel (mono)
-	const float *samples = (const float *)data->data[0];
+	if (key.empty())
+		return;
+
+	std::string path = recording_path(dir, "glfr");
+
+	// Record the bins the render path shows, up to the top frequency
+	float bin_hz = analysis_rate / (float)fft_size;
+	size_t bands = (size_t)(top_freq / bin_hz);
+	if (bands > fft_size / 2)
+		bands = fft_size / 2;
 
-	for (size_t i = 0; i < frames; i++) {
-		fft_input_buffer.push_back(samples[i]);
+	std::unique_ptr<FlightRecorder> rec(new FlightRecorder());
+	if (!rec->Start(path.c_str(), (uint32_t)bands, (FlightEncoding)encoding, (uint32_t)fft_size, analysis_rate)) {
+		obs_log(LOG_WARNING, "Failed to start flight recording at '%s'", path.c_str());
+		return;
 	}
+	obs_log(LOG_INFO, "Flight recording to %s (%zu bands)", path.c_str(), bands);
+	SwapRecorder(std::move(rec));
+}
 
-	// If we have enough data, run FFT
-	if (fft_input_buffer.size() >= fft_size) {
-		// Keep only the latest fft_size samples
-		if (fft_input_buffer.size() > fft_size) {
-			size_t excess = fft_input_buffer.size() - fft_size;
-			fft_input_buffer.erase(fft_input_buffer.begin(), fft_input_buffer.begin() + excess);
-		}
+// Callback capture for offline replay. Call with flight_mutex held.
+void GlassLineSource::UpdateCapture(bool enabled, const std::string &dir)
+{
+	audio_t *audio = obs_get_audio();
+	uint32_t channels = audio ? (uint32_t)audio_output_get_channels(audio) : 2;
+	if (channels > CAPTURE_MAX_CHANNELS)
+		channels = CAPTURE_MAX_CHANNELS;
+
+	// Analysis settings are stored as replay defaults, a change starts a new file
+	std::string key;
+	if (enabled) {
+		key = dir + "|" + std::to_string(sample_rate) + "|" + std::to_string(channels) + "|" +
+		      std::to_string(decimation) + "|" + std::to_string(hop) + "|" + std::to_string(attack_ms) + "|" +
+		      std::to_string(release_ms);
+	}
+	if (key == capture_key)
+		return;
+	capture_key = key;
 
-		// Apply window function (Hann)
-		std::vector<float> windowed_input = fft_input_buffer;
-		for (size_t i = 0; i < fft_size; i++) {
-			float multiplier = 0.5f * (1.0f - cosf(2.0f * (float)M_PI * i / (fft_size - 1)));
-			windowed_input[i] *= multiplier;
-		}
+	std::unique_ptr<CaptureWriter> old = SwapCapture(nullptr);
+	if (old) {
+		obs_log(LOG_INFO, "Callback capture stopped: %s (%llu blocks, %llu dropped)", old->Path().c_str(),
+			(unsigned long long)old->BlocksWritten(), (unsigned long long)old->BlocksDropped());
+		old.reset();
+	}
 
-		SimpleFFT::Compute(windowed_input, fft_output_magnitudes);
+	if (key.empty())
+		return;
 
-		// Smooth the magnitudes
-		if (smoothed_magnitudes.size() != fft_output_magnitudes.size()) {
-			smoothed_magnitudes = fft_output_magnitudes;
-		} else {
-			for (size_t i = 0; i < fft_output_magnitudes.size(); i++) {
-				smoothed_magnitudes[i] = smoothed_magnitudes[i] * smoothing +
-							 fft_output_magnitudes[i] * (1.0f - smoothing);
-			}
-		}
+	std::string path = recording_path(dir, "glcap");
+	std::unique_ptr<CaptureWriter> writer(new CaptureWriter());
+	if (!writer->Start(path.c_str(), (uint32_t)sample_rate, channels, (uint32_t)fft_size, (uint32_t)decimation,
+			   (uint32_t)hop, attack_ms, release_ms)) {
+		obs_log(LOG_WARNING, "Failed to start callback capture at '%s'", path.c_str());
+		return;
+	}
+	obs_log(LOG_INFO, "Capturing audio callbacks to %s", path.c_str());
+	SwapCapture(std::move(writer));
+}
+
+// Feed name used when none is set: the source's name, made safe for
+// shm_open(), so each source publishes under its own
+static std::string shm_default_name(const char *source_name)
+{
+	std::string name = "glassline-";
+	for (const char *c = source_name; c && *c; c++)
+		name += isalnum((unsigned char)*c) || *c == '-' || *c == '_' || *c == '.' ? *c : '-';
+	return name.substr(0, SHM_DEFAULT_NAME_MAX);
+}
+
+// Shared-memory spectrum feed for other processes. Call with flight_mutex held.
+void GlassLineSource::UpdatePublisher(bool enabled, const std::string &name)
+{
+	std::string key;
+	if (enabled)
+		key = name.empty() ? shm_default_name(obs_source_get_name(source)) : name;
+	if (key == publisher_name)
+		return;
+	publisher_name = key;
+
+	std::unique_ptr<ShmPublisher> old = SwapPublisher(nullptr);
+	if (old) {
+		obs_log(LOG_INFO, "Shared-memory feed '%s' closed (%llu frames)", old->Name().c_str() + 1,
+			(unsigned long long)old->FramesWritten());
+		old.reset();
+	}
 
-		// Clear buffer partially to allow overlap?
-		// For now, just keep it sliding in the next frame.
-		// Actually, we usually want to consume the buffer.
-		// But for a visualizer, we want the latest data.
-		// The sliding window above handles it.
+	if (key.empty())
+		return;
+
+	std::unique_ptr<ShmPublisher> pub(new ShmPublisher());
+	if (!pub->Open(key.c_str(), SHM_MAX_BANDS, SHM_SLOTS)) {
+		if (pub->InUseBy())
+			obs_log(LOG_WARNING, "Shared-memory feed '%s' is already published by process %u",
+				key.c_str(), pub->InUseBy());
+		else
+			obs_log(LOG_WARNING, "Failed to open shared-memory feed '%s'", key.c_str());
+		return;
 	}
+	obs_log(LOG_INFO, "Publishing spectra to shared memory '/%s'", key.c_str());
+	SwapPublisher(std::move(pub));
 }
 
-void GlassLineSource::Render(gs_effect_t *effect)
+// Latency distribution since the analysis was last configured. The hop and
+// window lines are what the measurement can't see: a sound waits up to a hop
+// before a spectrum includes it, and the window's centre is half a window
+// before the spectrum's timestamp.
+void GlassLineSource::LogLatency()
 {
-	UNUSED_PARAMETER(effect);
+	char summary[1024];
+	double hop_ms_now, window_ms_now, delay_ms;
+	{
+		std::lock_guard<CoreMutex> lock(audio_mutex);
+		latency.Format(summary, sizeof(summary));
+		hop_ms_now = (double)analyzer.Config().hop * 1000.0 / analysis_rate;
+		window_ms_now = (double)analyzer.WindowSize() * 1000.0 / analysis_rate;
+		delay_ms = (double)playout_delay / 1e6;
+	}
 
-	std::lock_guard<std::mutex> lock(audio_mutex);
+	obs_log(LOG_INFO, "Latency of '%s' (window %.1f ms, hop %.1f ms, playout delay %.1f ms):\n%s",
+		obs_source_get_name(source), window_ms_now, hop_ms_now, delay_ms, summary);
+	obs_log(LOG_INFO, "Not measured: up to %.1f ms hop wait, window centre %.1f ms before the timestamp", hop_ms_now,
+		window_ms_now / 2.0);
+}
 
-	if (smoothed_magnitudes.empty())
+// The latest latency records as CSV in the recording folder
+void GlassLineSource::ExportLatency()
+{
+	obs_data_t *settings = obs_source_get_settings(source);
+	std::string path = recording_path(obs_data_get_string(settings, S_RECORD_PATH), "latency.csv");
+	obs_data_release(settings);
+
+	// Copy out so the file is written without holding up the audio thread
+	LatencyStats snapshot;
+	{
+		std::lock_guard<CoreMutex> lock(audio_mutex);
+		snapshot = latency;
+	}
+
+	if (snapshot.WriteCsv(path.c_str()))
+		obs_log(LOG_INFO, "Latency records written to %s", path.c_str());
+	else
+		obs_log(LOG_WARNING, "Failed to write latency records to '%s'", path.c_str());
+}
+
+// Logs a governor step. Call with flight_mutex held.
+void GlassLineSource::Govern()
+{
+	struct obs_video_info ovi;
+	uint64_t interval = obs_get_video_info(&ovi) && ovi.fps_num
+				    ? (uint64_t)1000000000 * ovi.fps_den / ovi.fps_num
+				    : 0;
+	GovernorStep step;
+	if (!VisualizerCore::Govern(obs_get_average_frame_time_ns(), interval, step))
 		return;
 
-	gs_effect_t *solid = obs_get_base_effect(OBS_EFFECT_SOLID);
+	const QualityLevel &quality = governor.Settings();
+	obs_log(LOG_INFO,
+		"'%s' quality %d -> %d (%s; OBS at %.0f%%, this source at %.1f%% of the frame): "
+		"FFT %zu, interval x%.1f%s, 1/%d bands, glow %s, render scale %.2f",
+		obs_source_get_name(source), step.previous, governor.Current(), governor.Reason(),
+		governor.ObsLoad() * 100.0f, governor.OwnLoad() * 100.0f, step.fft_size, step.hop_scale,
+		step.pinned ? " (held while recording)" : "", quality.band_stride, quality.glow ? "on" : "off",
+		quality.render_scale);
+}
 
-	float width = (float)obs_source_get_width(source);
-	float height = (float)obs_source_get_height(source);
+void GlassLineSource::Tick(float seconds)
+{
+	std::lock_guard<CoreMutex> guard(flight_mutex);
+	Govern();
+	Maintain(seconds, obs_get_video_frame_time());
+}
 
-	// Prepare data for visualization
-	size_t start_bin = 1;
-	size_t end_bin = smoothed_magnitudes.size() / 2;
-	if (end_bin <= start_bin)
+void GlassLineSource::AudioCallback(const struct audio_data *data)
+{
+	VisualizerCore::AudioCallback((const float *const *)data->data, data->frames, data->timestamp);
+}
+
+uint64_t GlassLineSource::Now() const
+{
+	return os_gettime_ns();
+}
+
+void GlassLineSource::AnalysisFailed(size_t fft_size)
+{
+	obs_log(LOG_ERROR, "Failed to allocate %zu-point analysis buffers", fft_size);
+}
+
+void GlassLineSource::RenderWaveform(float width, float height)
+{
+	size_t columns = (size_t)width;
+	if (columns == 0 || waveform.Total() == 0)
 		return;
 
-	size_t num_bins = end_bin - start_bin;
+	size_t window = (size_t)(sample_rate * layer->window_ms / 1000.0f);
+	if (window < 2)
+		window = 2;
+	if (window > waveform.Capacity())
+		window = waveform.Capacity();
+
+	uint64_t total = waveform.Total();
+	uint64_t end = total;
+
+	if (layer->mode == 12 && layer->trigger && total > 2 * (uint64_t)window) {
+		// Show the window starting at the latest rising edge that still has a
+		// full window of data after it. The search span is capped so long
+		// windows don't turn into a per-sample scan.
+		size_t span = window < 8192 ? window : 8192;
+		uint64_t to = total - window;
+		uint64_t edge = waveform.FindRisingEdge(to - span, to, 0.01f);
+		if (edge != to)
+			end = edge + window;
+	}
 
-	// Helper to fix color format (OBS uses ABGR, we have ARGB)
-	auto fix_color = [](uint32_t argb) -> uint32_t {
-		uint8_t a = (argb >> 24) & 0xFF;
-		uint8_t r = (argb >> 16) & 0xFF;
-		uint8_t g = (argb >> 8) & 0xFF;
-		uint8_t b = argb & 0xFF;
-		return (a << 24) | (b << 16) | (g << 8) | r; // ABGR
+	if (wave_min.size() != columns) {
+		wave_min.resize(columns);
+		wave_max.resize(columns);
+	}
+	waveform.Query(end, window, columns, wave_min.data(), wave_max.data());
+
+	float center_y = height / 2.0f;
+	float max_amplitude = height * 0.45f;
+	float half_line = layer->line_width * 0.5f;
+
+	// One min/max pair per pixel column, drawn as a filled envelope. Each
+	// edge is shaded by its own level, so the amplitude gradient follows the
+	// peaks.
+	auto draw_envelope = [&](float scale, float pad, bool glow_pass) {
+		batch.Break();
+		for (size_t i = 0; i < columns; i++) {
+			float position = (float)i / (float)columns;
+			float x = position * width;
+			float top = wave_max[i] * scale;
+			float bottom = wave_min[i] * scale;
+			uint32_t top_col = glow_pass ? layer->glow_abgr : Shade(position, position, fabsf(top));
+			uint32_t bottom_col = glow_pass ? layer->glow_abgr : Shade(position, position, fabsf(bottom));
+			batch.Vertex(x, center_y - top * max_amplitude - pad, top_col);
+			batch.Vertex(x, center_y - bottom * max_amplitude + pad, bottom_col);
+		}
+		batch.Break();
 	};
 
-	while (gs_effect_loop(solid, "Solid")) {
+	if (render_glow > 0.01f)
+		draw_envelope(layer->amp_scale, half_line * (1.0f + render_glow * 2.0f), true);
+	draw_envelope(layer->amp_scale, half_line, false);
+}
 
-		if (mode == 0) { // Centered Waveform (bass from center, spreads left/right)
-			float center_x = width / 2.0f;
-			float max_amplitude = height * 0.3f;
+void GlassLineSource::UpdateSpectrogram(size_t start_bin, size_t num_bins)
+{
+	if (!spectrogram_effect)
+		return;
 
-			// Draw glow first
-			if (glow_strength > 0.01f) {
-				gs_effect_set_color(gs_effect_get_param_by_name(solid, "color"), fix_color(glow_color));
+	if (!spec_row_tex) {
+		spec_row_tex =
+			gs_texture_create(SPECTROGRAM_COLUMNS, PUBLISHED_FRAMES, GS_R32F, 1, nullptr, GS_DYNAMIC);
+		spec_ring = gs_texrender_create(GS_R32F, GS_ZS_NONE);
+		if (!spec_row_tex || !spec_ring)
+			return;
+	}
 
-				// Top half glow
-				gs_render_start(true);
-				for (size_t i = 0; i < num_bins / 2; i++) {
-					size_t bin_idx = start_bin + i;
-					float mag = smoothed_magnitudes[bin_idx] * amp_scale;
-					float amplitude = mag * max_amplitude * (1.0f + glow_strength * 0.5f);
+	// Every band frame published since the last render gets its own row, so
+	// the scroll speed follows the hop rather than the frame rate. The new
+	// rows go up in one upload and at most two blits (split where the ring
+	// wraps). Older rows are never touched again. A new layout numbers its
+	// frames from 0 again.
+	uint64_t published = analyzer.Published();
+	uint64_t first = spec_last_frame;
+	if (first > published || first < analyzer.OldestFrame())
+		first = analyzer.OldestFrame();
+	if (published - first > PUBLISHED_FRAMES)
+		first = published - PUBLISHED_FRAMES; // The staging texture's height
+
+	uint32_t rows = (uint32_t)(published - first);
+	if (rows > 0) {
+		uint8_t *ptr;
+		uint32_t linesize;
+		if (!gs_texture_map(spec_row_tex, &ptr, &linesize))
+			return;
+		for (uint32_t r = 0; r < rows; r++) {
+			ArenaSpan<float> frame = analyzer.Frame(first + r);
+			float *row = (float *)(ptr + (size_t)r * linesize);
+			for (size_t c = 0; c < SPECTROGRAM_COLUMNS; c++)
+				row[c] = frame[start_bin + c * num_bins / SPECTROGRAM_COLUMNS];
+		}
+		gs_texture_unmap(spec_row_tex);
+	}
+	spec_last_frame = published;
+
+	if (rows > 0 || !spec_ring_cleared) {
+		uint32_t start = (spec_write_row + 1) % SPECTROGRAM_ROWS;
+		uint32_t before_wrap = std::min(rows, SPECTROGRAM_ROWS - start);
+		spec_write_row = (spec_write_row + rows) % SPECTROGRAM_ROWS;
+
+		gs_texrender_reset(spec_ring);
+		if (gs_texrender_begin(spec_ring, SPECTROGRAM_COLUMNS, SPECTROGRAM_ROWS)) {
+			if (!spec_ring_cleared) {
+				struct vec4 zero;
+				vec4_set(&zero, 0.0f, 0.0f, 0.0f, 0.0f);
+				gs_clear(GS_CLEAR_COLOR, &zero, 0.0f, 0);
+				spec_ring_cleared = true;
+			}
 
-					// Left side (bass at center, highs outward)
-					float x_left = center_x - ((float)i / (float)(num_bins / 2)) * (center_x);
-					float y_top = height / 2.0f - amplitude;
-					gs_vertex2f(x_left, y_top);
-				}
-				gs_render_stop(GS_LINESTRIP);
-
-				// Bottom half glow
-				gs_render_start(true);
-				for (size_t i = 0; i < num_bins / 2; i++) {
-					size_t bin_idx = start_bin + i;
-					float mag = smoothed_magnitudes[bin_idx] * amp_scale;
-					float amplitude = mag * max_amplitude * (1.0f + glow_strength * 0.5f);
-
-					float x_left = center_x - ((float)i / (float)(num_bins / 2)) * (center_x);
-					float y_bottom = height / 2.0f + amplitude;
-					gs_vertex2f(x_left, y_bottom);
-				}
-				gs_render_stop(GS_LINESTRIP);
-
-				// Right side glow (mirror)
-				gs_render_start(true);
-				for (size_t i = 0; i < num_bins / 2; i++) {
-					size_t bin_idx = start_bin + i;
-					float mag = smoothed_magnitudes[bin_idx] * amp_scale;
-					float amplitude = mag * max_amplitude * (1.0f + glow_strength * 0.5f);
-
-					float x_right = center_x + ((float)i / (float)(num_bins / 2)) * (center_x);
-					float y_top = height / 2.0f - amplitude;
-					gs_vertex2f(x_right, y_top);
-				}
-				gs_render_stop(GS_LINESTRIP);
+			gs_ortho(0.0f, (float)SPECTROGRAM_COLUMNS, 0.0f, (float)SPECTROGRAM_ROWS, -100.0f, 100.0f);
+			gs_blend_state_push();
+			gs_enable_blending(false);
+
+			gs_effect_t *copy = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+			gs_effect_set_texture(gs_effect_get_param_by_name(copy, "image"), spec_row_tex);
+			auto blit = [&](uint32_t from_row, uint32_t to_row, uint32_t count) {
+				if (count == 0)
+					return;
+				gs_matrix_push();
+				gs_matrix_translate3f(0.0f, (float)to_row, 0.0f);
+				while (gs_effect_loop(copy, "Draw"))
+					gs_draw_sprite_subregion(spec_row_tex, 0, 0, from_row, SPECTROGRAM_COLUMNS,
+								 count);
+				gs_matrix_pop();
+			};
+			blit(0, start, before_wrap);
+			blit(before_wrap, 0, rows - before_wrap);
 
-				gs_render_start(true);
-				for (size_t i = 0; i < num_bins / 2; i++) {
-					size_t bin_idx = start_bin + i;
-					float mag = smoothed_magnitudes[bin_idx] * amp_scale;
-					float amplitude = mag * max_amplitude * (1.0f + glow_strength * 0.5f);
+			gs_blend_state_pop();
+			gs_texrender_end(spec_ring);
+		}
+	}
+}
 
-					float x_right = center_x + ((float)i / (float)(num_bins / 2)) * (center_x);
-					float y_bottom = height / 2.0f + amplitude;
-					gs_vertex2f(x_right, y_bottom);
-				}
-				gs_render_stop(GS_LINESTRIP);
-			}
+// Draws the ring for the current layer with `technique` of the spectrogram
+// effect. Its placement goes on the matrix stack since the sprite isn't part
+// of the batch.
+void GlassLineSource::DrawSpectrogram(float width, float height, const char *technique)
+{
+	gs_texture_t *ring = spec_ring ? gs_texrender_get_texture(spec_ring) : nullptr;
+	if (!spectrogram_effect || !ring)
+		return;
 
-			// Draw main waveform
-			gs_effect_set_color(gs_effect_get_param_by_name(solid, "color"), fix_color(color_start));
-
-			// Left top
-			gs_render_start(true);
-			for (size_t i = 0; i < num_bins / 2; i++) {
-				size_t bin_idx = start_bin + i;
-				float mag = smoothed_magnitudes[bin_idx] * amp_scale;
-				float amplitude = mag * max_amplitude;
-				float x_left = center_x - ((float)i / (float)(num_bins / 2)) * (center_x);
-				float y_top = height / 2.0f - amplitude;
-				gs_vertex2f(x_left, y_top);
-			}
-			gs_render_stop(GS_LINESTRIP);
-
-			// Left bottom
-			gs_render_start(true);
-			for (size_t i = 0; i < num_bins / 2; i++) {
-				size_t bin_idx = start_bin + i;
-				float mag = smoothed_magnitudes[bin_idx] * amp_scale;
-				float amplitude = mag * max_amplitude;
-				float x_left = center_x - ((float)i / (float)(num_bins / 2)) * (center_x);
-				float y_bottom = height / 2.0f + amplitude;
-				gs_vertex2f(x_left, y_bottom);
-			}
-			gs_render_stop(GS_LINESTRIP);
-
-			// Right top (mirror)
-			gs_render_start(true);
-			for (size_t i = 0; i < num_bins / 2; i++) {
-				size_t bin_idx = start_bin + i;
-				float mag = smoothed_magnitudes[bin_idx] * amp_scale;
-				float amplitude = mag * max_amplitude;
-				float x_right = center_x + ((float)i / (float)(num_bins / 2)) * (center_x);
-				float y_top = height / 2.0f - amplitude;
-				gs_vertex2f(x_right, y_top);
-			}
-			gs_render_stop(GS_LINESTRIP);
-
-			// Right bottom (mirror)
-			gs_render_start(true);
-			for (size_t i = 0; i < num_bins / 2; i++) {
-				size_t bin_idx = start_bin + i;
-				float mag = smoothed_magnitudes[bin_idx] * amp_scale;
-				float amplitude = mag * max_amplitude;
-				float x_right = center_x + ((float)i / (float)(num_bins / 2)) * (center_x);
-				float y_bottom = height / 2.0f + amplitude;
-				gs_vertex2f(x_right, y_bottom);
-			}
-			gs_render_stop(GS_LINESTRIP);
+	// Scroll offset and colour mapping happen in the shader
+	gs_effect_t *effect = spectrogram_effect;
+	gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), ring);
+	gs_effect_set_float(gs_effect_get_param_by_name(effect, "newest_row"),
+			    ((float)spec_write_row + 0.5f) / (float)SPECTROGRAM_ROWS);
+	gs_effect_set_float(gs_effect_get_param_by_name(effect, "rows"), (float)SPECTROGRAM_ROWS);
+	gs_effect_set_float(gs_effect_get_param_by_name(effect, "gain"), layer->amp_scale * fft_gain);
+	gs_effect_set_color(gs_effect_get_param_by_name(effect, "color_low"), layer->start_abgr & 0x00FFFFFF);
+	gs_effect_set_color(gs_effect_get_param_by_name(effect, "color_mid"), layer->start_abgr);
+	gs_effect_set_color(gs_effect_get_param_by_name(effect, "color_high"), layer->end_abgr);
+	gs_effect_set_float(gs_effect_get_param_by_name(effect, "opacity"), layer->opacity);
+
+	// Matrix calls apply to vertices last first: centre on the origin,
+	// scale, rotate, then move back out to the placed centre
+	float cx = width * 0.5f;
+	float cy = height * 0.5f;
+	gs_matrix_push();
+	gs_matrix_translate3f(cx + layer->offset_x * width, cy + layer->offset_y * height, 0.0f);
+	gs_matrix_rotaa4f(0.0f, 0.0f, 1.0f, layer->rotation * (float)M_PI / 180.0f);
+	gs_matrix_scale3f(layer->scale, layer->scale, 1.0f);
+	gs_matrix_translate3f(-cx, -cy, 0.0f);
+	while (gs_effect_loop(effect, technique))
+		gs_draw_sprite(ring, 0, (uint32_t)width, (uint32_t)height);
+	gs_matrix_pop();
+}
 
-		} else if (mode == 1) { // Symmetric Waveform (existing - vertical mirror)
-			float center_y = height / 2.0f;
-			float max_amplitude = height * 0.3f;
+// Vectorscope square, centred above the correlation meter
+struct ScopeLayout {
+	float x, y, size;
+	float meter_top, meter_bottom;
+};
 
-			// Draw glow layer first
-			if (glow_strength > 0.01f) {
-				gs_effect_set_color(gs_effect_get_param_by_name(solid, "color"), fix_color(glow_color));
+static ScopeLayout scope_layout(float width, float height)
+{
+	ScopeLayout box;
+	float meter = height * SCOPE_METER_FRACTION;
+	float area = height - meter * 2.0f; // The meter and a gap as high as it go below
+	box.size = std::max(std::min(width, area), 0.0f);
+	box.x = (width - box.size) * 0.5f;
+	box.y = (area - box.size) * 0.5f;
+	box.meter_top = box.y + box.size + meter * 0.5f;
+	box.meter_bottom = box.meter_top + meter;
+	return box;
+}
 
-				// Top half glow
-				gs_render_start(true);
-				for (size_t i = 0; i < num_bins; i++) {
-					float mag = smoothed_magnitudes[start_bin + i] * amp_scale;
-					float amplitude = mag * max_amplitude * (1.0f + glow_strength * 0.5f);
+// Adds the hits since the last video frame to the trace, which loses
+// 1 - 1/e of itself every `persistence_ms`. One upload of the grid and one
+// quad whatever the sample rate: the blend keeps dest * decay and adds the
+// weighted hits, so the trace is never read back. Shared by all vectorscope
+// layers.
+void GlassLineSource::UpdateScope(float persistence_ms)
+{
+	if (!vectorscope_effect)
+		return;
+	if (!scope_hits_tex)
+		scope_hits_tex = gs_texture_create(SCOPE_SIZE, SCOPE_SIZE, GS_R32F, 1, nullptr, GS_DYNAMIC);
+	if (!scope_trace)
+		scope_trace = gs_texrender_create(GS_R32F, GS_ZS_NONE);
+	if (!scope_hits_tex || !scope_trace)
+		return;
 
-					float x = (float)i / (float)num_bins * width;
-					float y_top = center_y - amplitude;
-					gs_vertex2f(x, y_top);
-				}
-				gs_render_stop(GS_LINESTRIP);
+	// Once per video frame, however many views draw the source
+	if (scope_trace_start != scope_starts) {
+		scope_trace_start = scope_starts;
+		scope_trace_cleared = false;
+	}
+	uint64_t now = obs_get_video_frame_time();
+	if (now == scope_last_time && scope_trace_cleared)
+		return;
+	float seconds = scope_last_time && now > scope_last_time ? (float)(now - scope_last_time) / 1e9f : 0.0f;
+	scope_last_time = now;
+	float persistence = persistence_ms / 1000.0f;
+	float decay = expf(-std::min(seconds, 1.0f) / persistence);
+	// Trace per hit such that a steady signal builds up SCOPE_TRACE_MASS in
+	// all, at any sample rate and persistence
+	float weight = SCOPE_TRACE_MASS / (scope.SampleRate() * persistence);
+
+	// Only the rows the splat touched go up, packed at the top of the
+	// staging texture; nothing at all when no point landed on the grid
+	size_t first = scope.DirtyFirst();
+	uint32_t rows = first < scope.DirtyEnd() ? (uint32_t)(scope.DirtyEnd() - first) : 0;
+	if (rows > 0) {
+		uint8_t *ptr;
+		uint32_t linesize;
+		if (!gs_texture_map(scope_hits_tex, &ptr, &linesize))
+			return;
+		const float *hits = scope.Hits() + first * SCOPE_SIZE;
+		for (uint32_t r = 0; r < rows; r++)
+			memcpy(ptr + (size_t)r * linesize, hits + (size_t)r * SCOPE_SIZE, SCOPE_SIZE * sizeof(float));
+		gs_texture_unmap(scope_hits_tex);
+		scope.ClearHits();
+	}
 
-				// Bottom half glow
-				gs_render_start(true);
-				for (size_t i = 0; i < num_bins; i++) {
-					float mag = smoothed_magnitudes[start_bin + i] * amp_scale;
-					float amplitude = mag * max_amplitude * (1.0f + glow_strength * 0.5f);
+	gs_texrender_reset(scope_trace);
+	if (!gs_texrender_begin(scope_trace, SCOPE_SIZE, SCOPE_SIZE))
+		return;
+	if (!scope_trace_cleared) {
+		struct vec4 zero;
+		vec4_set(&zero, 0.0f, 0.0f, 0.0f, 0.0f);
+		gs_clear(GS_CLEAR_COLOR, &zero, 0.0f, 0);
+		scope_trace_cleared = true;
+	}
 
-					float x = (float)i / (float)num_bins * width;
-					float y_bottom = center_y + amplitude;
-					gs_vertex2f(x, y_bottom);
-				}
-				gs_render_stop(GS_LINESTRIP);
-			}
+	gs_ortho(0.0f, (float)SCOPE_SIZE, 0.0f, (float)SCOPE_SIZE, -100.0f, 100.0f);
+	gs_blend_state_push();
+	gs_enable_blending(true);
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_SRCALPHA);
+
+	// Decay the whole trace, then add the new rows in place
+	gs_effect_t *effect = vectorscope_effect;
+	gs_effect_set_float(gs_effect_get_param_by_name(effect, "decay"), decay);
+	while (gs_effect_loop(effect, "Decay"))
+		gs_draw_sprite(nullptr, 0, SCOPE_SIZE, SCOPE_SIZE);
+	if (rows > 0) {
+		gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), scope_hits_tex);
+		gs_effect_set_float(gs_effect_get_param_by_name(effect, "weight"), weight);
+		gs_matrix_push();
+		gs_matrix_translate3f(0.0f, (float)first, 0.0f);
+		while (gs_effect_loop(effect, "Accumulate"))
+			gs_draw_sprite_subregion(scope_hits_tex, 0, 0, 0, SCOPE_SIZE, rows);
+		gs_matrix_pop();
+	}
 
-			// Draw main waveform
-			gs_effect_set_color(gs_effect_get_param_by_name(solid, "color"), fix_color(color_start));
+	gs_blend_state_pop();
+	gs_texrender_end(scope_trace);
+}
 
-			// Top half
-			gs_render_start(true);
-			for (size_t i = 0; i < num_bins; i++) {
-				float mag = smoothed_magnitudes[start_bin + i] * amp_scale;
-				float amplitude = mag * max_amplitude;
-				float x = (float)i / (float)num_bins * width;
-				float y_top = center_y - amplitude;
-				gs_vertex2f(x, y_top);
-			}
-			gs_render_stop(GS_LINESTRIP);
+// Draws the trace for the current layer with `technique` of the vectorscope
+// effect, placed like the spectrogram
+void GlassLineSource::DrawScope(float width, float height, const char *technique)
+{
+	gs_texture_t *trace = scope_trace ? gs_texrender_get_texture(scope_trace) : nullptr;
+	if (!vectorscope_effect || !trace)
+		return;
+	ScopeLayout box = scope_layout(width, height);
+	if (box.size < 1.0f)
+		return;
 
-			// Bottom half (mirrored)
-			gs_render_start(true);
-			for (size_t i = 0; i < num_bins; i++) {
-				float mag = smoothed_magnitudes[start_bin + i] * amp_scale;
-				float amplitude = mag * max_amplitude;
-				float x = (float)i / (float)num_bins * width;
-				float y_bottom = center_y + amplitude;
-				gs_vertex2f(x, y_bottom);
-			}
-			gs_render_stop(GS_LINESTRIP);
-
-		} else if (mode == 2) { // Mirrored Bars (Vertical bars from center)
-			float center_y = height / 2.0f;
-			float max_amplitude = height * 0.4f;
-			int count = 64; // Fixed bar count for now, or could reuse bar_count if we kept it
-			if (count > (int)num_bins)
-				count = (int)num_bins;
-
-			size_t bins_per_bar = num_bins / count;
-			if (bins_per_bar == 0)
-				bins_per_bar = 1;
-
-			float bar_width = width / count * 0.8f;
-
-			// Draw glow
-			if (glow_strength > 0.01f) {
-				gs_effect_set_color(gs_effect_get_param_by_name(solid, "color"), fix_color(glow_color));
-				gs_render_start(true);
-				for (int i = 0; i < count; i++) {
-					float sum = 0.0f;
-					for (size_t j = 0; j < bins_per_bar; j++) {
-						size_t bin_idx = start_bin + i * bins_per_bar + j;
-						if (bin_idx < smoothed_magnitudes.size())
-							sum += smoothed_magnitudes[bin_idx];
-					}
-					float mag = (sum / bins_per_bar) * amp_scale;
-					float amplitude = mag * max_amplitude * (1.0f + glow_strength * 0.5f);
-
-					float x = (float)i / (float)count * width + (width / count * 0.1f);
-
-					// Top bar (using TRISTRIP: TL, BL, TR, BR)
-					gs_vertex2f(x, center_y);                         // TL
-					gs_vertex2f(x, center_y - amplitude);             // BL
-					gs_vertex2f(x + bar_width, center_y);             // TR
-					gs_vertex2f(x + bar_width, center_y - amplitude); // BR
-				}
-				gs_render_stop(GS_TRISTRIP);
-			}
+	gs_effect_t *effect = vectorscope_effect;
+	gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), trace);
+	gs_effect_set_float(gs_effect_get_param_by_name(effect, "gain"), layer->amp_scale);
+	gs_effect_set_color(gs_effect_get_param_by_name(effect, "color_low"), layer->start_abgr & 0x00FFFFFF);
+	gs_effect_set_color(gs_effect_get_param_by_name(effect, "color_mid"), layer->start_abgr);
+	gs_effect_set_color(gs_effect_get_param_by_name(effect, "color_high"), layer->end_abgr);
+	gs_effect_set_float(gs_effect_get_param_by_name(effect, "opacity"), layer->opacity);
+
+	float cx = width * 0.5f;
+	float cy = height * 0.5f;
+	gs_matrix_push();
+	gs_matrix_translate3f(cx + layer->offset_x * width, cy + layer->offset_y * height, 0.0f);
+	gs_matrix_rotaa4f(0.0f, 0.0f, 1.0f, layer->rotation * (float)M_PI / 180.0f);
+	gs_matrix_scale3f(layer->scale, layer->scale, 1.0f);
+	gs_matrix_translate3f(box.x - cx, box.y - cy, 0.0f);
+	while (gs_effect_loop(effect, technique))
+		gs_draw_sprite(trace, 0, (uint32_t)box.size, (uint32_t)box.size);
+	gs_matrix_pop();
+}
 
-			// Draw main bars
-			gs_effect_set_color(gs_effect_get_param_by_name(solid, "color"), fix_color(color_start));
-			gs_render_start(true);
-			for (int i = 0; i < count; i++) {
-				float sum = 0.0f;
-				for (size_t j = 0; j < bins_per_bar; j++) {
-					size_t bin_idx = start_bin + i * bins_per_bar + j;
-					if (bin_idx < smoothed_magnitudes.size())
-						sum += smoothed_magnitudes[bin_idx];
-				}
-				float mag = (sum / bins_per_bar) * amp_scale;
-				float amplitude = mag * max_amplitude;
+// The vectorscope's axes and correlation meter; DrawScope() puts the trace
+// under them. The axes are left and right on the diagonals and mid straight
+// up, in the end colour. The meter runs from -1 at the left to +1 and is
+// filled from 0, in the glow colour when the channels are out of phase.
+void GlassLineSource::RenderScope(float width, float height)
+{
+	ScopeLayout box = scope_layout(width, height);
+	if (box.size < 1.0f)
+		return;
+	float rule = layer->thickness;
+	float half_rule = rule * 0.25f;
+	float left = box.x, right = box.x + box.size;
+	float top = box.y, bottom = box.y + box.size;
+	float mid = box.x + box.size * 0.5f;
+
+	const uint32_t axis[2] = {layer->end_abgr, layer->end_abgr};
+	const float l_x[2] = {left, right}, r_x[2] = {right, left}, axis_y[2] = {top, bottom};
+	StrokePolyline(l_x, axis_y, axis, 2, half_rule, AA_FEATHER);
+	StrokePolyline(r_x, axis_y, axis, 2, half_rule, AA_FEATHER);
+	batch.Rect(mid - half_rule, top, mid + half_rule, bottom, layer->end_abgr);
+
+	float correlation = scope.Correlation();
+	float end = mid + correlation * box.size * 0.5f;
+	float position = (end - left) / box.size;
+	uint32_t fill = correlation < 0.0f ? layer->glow_abgr : Shade(position, position, fabsf(correlation));
+	batch.Rect(std::min(mid, end), box.meter_top, std::max(mid, end), box.meter_bottom, fill);
+	for (float x : {left, mid, right})
+		batch.Rect(x - rule * 0.5f, box.meter_top - rule, x + rule * 0.5f, box.meter_bottom + rule,
+			   layer->end_abgr);
+}
 
-				float x = (float)i / (float)count * width + (width / count * 0.1f);
+// Gradient colour for a vertex: `position` is its horizontal place in the
+// output, `band` its place in the shown frequency range and `level` its
+// displayed amplitude, all 0..1. The LUT is solid when no gradient is set.
+uint32_t GlassLineSource::Shade(float position, float band, float level) const
+{
+	switch (layer->gradient_mode) {
+	case GRADIENT_BAND:
+		return layer->gradient.At(band);
+	case GRADIENT_AMPLITUDE:
+		return layer->gradient.At(level);
+	case GRADIENT_PITCH:
+		return render_pitch_abgr;
+	default:
+		return layer->gradient.At(position);
+	}
+}
 
-				// Top bar (TRISTRIP)
-				gs_vertex2f(x, center_y);
-				gs_vertex2f(x, center_y - amplitude);
-				gs_vertex2f(x + bar_width, center_y);
-				gs_vertex2f(x + bar_width, center_y - amplitude);
-
-				// Bottom bar (TRISTRIP)
-				gs_vertex2f(x, center_y);
-				gs_vertex2f(x, center_y + amplitude);
-				gs_vertex2f(x + bar_width, center_y);
-				gs_vertex2f(x + bar_width, center_y + amplitude);
-			}
-			gs_render_stop(GS_TRISTRIP);
-
-		} else if (mode == 3) { // Filled Mirror (Solid waveform mirrored)
-			float center_y = height / 2.0f;
-			float max_amplitude = height * 0.4f;
-
-			// Draw glow
-			if (glow_strength > 0.01f) {
-				gs_effect_set_color(gs_effect_get_param_by_name(solid, "color"), fix_color(glow_color));
-
-				// Top half
-				gs_render_start(true);
-				gs_vertex2f(0.0f, center_y); // Start at center-left
-				for (size_t i = 0; i < num_bins; i++) {
-					float mag = smoothed_magnitudes[start_bin + i] * amp_scale;
-					float amplitude = mag * max_amplitude * (1.0f + glow_strength * 0.5f);
-					float x = (float)i / (float)num_bins * width;
-					gs_vertex2f(x, center_y - amplitude);
-				}
-				gs_vertex2f(width, center_y); // End at center-right
-				gs_render_stop(
-					GS_LINESTRIP); // Using linestrip for outline, or could use triangle strip for fill
-
-				// Bottom half
-				gs_render_start(true);
-				gs_vertex2f(0.0f, center_y);
-				for (size_t i = 0; i < num_bins; i++) {
-					float mag = smoothed_magnitudes[start_bin + i] * amp_scale;
-					float amplitude = mag * max_amplitude * (1.0f + glow_strength * 0.5f);
-					float x = (float)i / (float)num_bins * width;
-					gs_vertex2f(x, center_y + amplitude);
-				}
-				gs_vertex2f(width, center_y);
-				gs_render_stop(GS_LINESTRIP);
-			}
+// Appends one curve as an anti-aliased strip faded over its outer `feather`
+// pixels, coloured per point
+void GlassLineSource::StrokePolyline(const float *x, const float *y, const uint32_t *colors, size_t count,
+				     float half_width, float feather)
+{
+	PolylineStyle style;
+	style.half_width = half_width;
+	style.feather = feather;
+	style.join = (PolylineJoin)layer->line_join;
+
+	float extent = half_width + feather;
+	float fade = feather / extent;
+
+	batch.Break();
+	tessellator.Tessellate(x, y, count, style, batch.Available(),
+			       [&](size_t point, float vx, float vy, float distance) {
+				       batch.Vertex(vx, vy, colors[point], distance / extent, fade);
+			       });
+	batch.Break();
+}
 
-			// Draw main filled shape
-			gs_effect_set_color(gs_effect_get_param_by_name(solid, "color"), fix_color(color_start));
+// The constant colour curves follow the layer being drawn
+void GlassLineSource::FillCurveColors()
+{
+	if (poly_glow_fill != layer->glow_abgr || poly_end_fill != layer->end_abgr) {
+		poly_glow_fill = layer->glow_abgr;
+		poly_end_fill = layer->end_abgr;
+		std::fill(poly_glow.begin(), poly_glow.end(), poly_glow_fill);
+		std::fill(poly_end.begin(), poly_end.end(), poly_end_fill);
+	}
+}
 
-			// We use TRIANGLE_STRIP to create a filled effect from the center line
-			gs_render_start(true);
-			for (size_t i = 0; i < num_bins; i++) {
-				float mag = smoothed_magnitudes[start_bin + i] * amp_scale;
-				float amplitude = mag * max_amplitude;
-				float x = (float)i / (float)num_bins * width;
+// Line modes: each curve is one anti-aliased strip of line_width pixels.
+// Glow is the same curve in the glow colour with a feather that widens
+// with thickness and glow strength.
+void GlassLineSource::RenderLines(size_t start_bin, size_t num_bins, float width, float height)
+{
+	if (num_bins > MAX_POLYLINE_POINTS)
+		num_bins = MAX_POLYLINE_POINTS;
+	if (num_bins < 2)
+		return;
 
-				// Top point
-				gs_vertex2f(x, center_y - amplitude);
-				// Bottom point
-				gs_vertex2f(x, center_y + amplitude);
-			}
-			gs_render_stop(GS_TRISTRIP);
-			gs_render_stop(GS_TRISTRIP);
-		} else if (mode == 4) { // Centered Dots (Mode 0 but with dots)
-			float center_x = width / 2.0f;
-			float max_amplitude = height * 0.3f;
-			float dot_size = thickness * 2.0f;
-
-			// Draw glow dots
-			if (glow_strength > 0.01f) {
-				gs_effect_set_color(gs_effect_get_param_by_name(solid, "color"), fix_color(glow_color));
-				gs_render_start(true);
-
-				bool first = true;
-				float last_x = 0.0f, last_y = 0.0f;
-
-				// Left side
-				for (size_t i = 0; i < num_bins / 2; i += 2) {
-					float mag = smoothed_magnitudes[start_bin + i] * amp_scale;
-					float amplitude = mag * max_amplitude * (1.0f + glow_strength * 0.5f);
-					float x = center_x - ((float)i / (float)(num_bins / 2)) * (center_x);
-
-					// Top dot
-					float y1 = height / 2.0f - amplitude;
-					if (!first) {
-						gs_vertex2f(last_x, last_y);
-						gs_vertex2f(x - dot_size, y1 - dot_size);
-					}
-					gs_vertex2f(x - dot_size, y1 - dot_size);
-					gs_vertex2f(x - dot_size, y1 + dot_size);
-					gs_vertex2f(x + dot_size, y1 - dot_size);
-					gs_vertex2f(x + dot_size, y1 + dot_size);
-					last_x = x + dot_size;
-					last_y = y1 + dot_size;
-					first = false;
-
-					// Bottom dot
-					float y2 = height / 2.0f + amplitude;
-					gs_vertex2f(last_x, last_y);
-					gs_vertex2f(x - dot_size, y2 - dot_size);
-
-					gs_vertex2f(x - dot_size, y2 - dot_size);
-					gs_vertex2f(x - dot_size, y2 + dot_size);
-					gs_vertex2f(x + dot_size, y2 - dot_size);
-					gs_vertex2f(x + dot_size, y2 + dot_size);
-					last_x = x + dot_size;
-					last_y = y2 + dot_size;
-				}
+	const float *mags = display_magnitudes.data() + start_bin;
+	float *px = poly_x.data();
+	float *py = poly_y.data();
+	uint32_t *pc = poly_c.data();
+	uint32_t *glow = poly_glow.data();
+	FillCurveColors();
+
+	float center_y = height / 2.0f;
+	float half_line = layer->line_width * 0.5f;
+	bool glow_on = render_glow > 0.01f;
+	float glow_gain = 1.0f + render_glow * 0.5f;
+	float glow_feather = AA_FEATHER + layer->thickness * 4.0f * render_glow;
+
+	if (layer->mode == 0) { // Centered Waveform (bass from center, spreads left/right)
+		// One curve per side of the centre line: the left half is the right
+		// half mirrored, joined at the centre without a seam
+		size_t half = num_bins / 2;
+		if (half < 2)
+			return;
+		size_t count = half * 2 - 1;
+		size_t mid = half - 1;
+		float center_x = width / 2.0f;
+		polyline_ramp(count, 0.0f, center_x / (float)mid, px);
+		float max_amplitude = height * 0.3f;
+
+		for (size_t i = 0; i < half; i++) {
+			pc[mid + i] = Shade(px[mid + i] / width, (float)i / (float)mid, mags[i] * render_gain);
+			pc[mid - i] = Shade(px[mid - i] / width, (float)i / (float)mid, mags[i] * render_gain);
+		}
 
-				// Right side
-				for (size_t i = 0; i < num_bins / 2; i += 2) {
-					float mag = smoothed_magnitudes[start_bin + i] * amp_scale;
-					float amplitude = mag * max_amplitude * (1.0f + glow_strength * 0.5f);
-					float x = center_x + ((float)i / (float)(num_bins / 2)) * (center_x);
-
-					// Top dot
-					float y1 = height / 2.0f - amplitude;
-					if (!first) {
-						gs_vertex2f(last_x, last_y);
-						gs_vertex2f(x - dot_size, y1 - dot_size);
-					}
-					gs_vertex2f(x - dot_size, y1 - dot_size);
-					gs_vertex2f(x - dot_size, y1 + dot_size);
-					gs_vertex2f(x + dot_size, y1 - dot_size);
-					gs_vertex2f(x + dot_size, y1 + dot_size);
-					last_x = x + dot_size;
-					last_y = y1 + dot_size;
-					first = false;
-
-					// Bottom dot
-					float y2 = height / 2.0f + amplitude;
-					gs_vertex2f(last_x, last_y);
-					gs_vertex2f(x - dot_size, y2 - dot_size);
-
-					gs_vertex2f(x - dot_size, y2 - dot_size);
-					gs_vertex2f(x - dot_size, y2 + dot_size);
-					gs_vertex2f(x + dot_size, y2 - dot_size);
-					gs_vertex2f(x + dot_size, y2 + dot_size);
-					last_x = x + dot_size;
-					last_y = y2 + dot_size;
-				}
-				gs_render_stop(GS_TRISTRIP);
+		auto curve = [&](float gain, const uint32_t *colors, float feather) {
+			polyline_scale(mags, half, gain, center_y, py + mid);
+			for (size_t i = 1; i < half; i++)
+				py[mid - i] = py[mid + i];
+			StrokePolyline(px, py, colors, count, half_line, feather);
+		};
+
+		float gain = max_amplitude * render_gain;
+		if (glow_on) {
+			curve(-gain * glow_gain, glow, glow_feather);
+			curve(gain * glow_gain, glow, glow_feather);
+		}
+		curve(-gain, pc, AA_FEATHER);
+		curve(gain, pc, AA_FEATHER);
+
+	} else if (layer->mode == 1 || layer->mode == 5) { // Symmetric Waveform / Multi-Wave
+		float max_amplitude = height * 0.3f;
+		float gain = max_amplitude * render_gain;
+		polyline_ramp(num_bins, 0.0f, width / (float)num_bins, px);
+		for (size_t i = 0; i < num_bins; i++) {
+			float position = (float)i / (float)num_bins;
+			pc[i] = Shade(position, position, mags[i] * render_gain);
+		}
+
+		// Top half and its vertical mirror
+		auto wave = [&](float scale, float y_offset, const uint32_t *colors, float feather) {
+			polyline_scale(mags, num_bins, -gain * scale, center_y + y_offset, py);
+			StrokePolyline(px, py, colors, num_bins, half_line, feather);
+			polyline_scale(mags, num_bins, gain * scale, center_y + y_offset, py);
+			StrokePolyline(px, py, colors, num_bins, half_line, feather);
+		};
+
+		if (layer->mode == 1) {
+			if (glow_on)
+				wave(glow_gain, 0.0f, glow, glow_feather);
+			wave(1.0f, 0.0f, pc, AA_FEATHER);
+		} else {
+			// Three overlapping waves: glow colour larger and up, end colour
+			// smaller and down, main gradient in the centre
+			uint32_t *end = poly_end.data();
+			wave(1.1f, -5.0f, glow, AA_FEATHER);
+			wave(0.9f, 5.0f, end, AA_FEATHER);
+			wave(1.0f, 0.0f, pc, AA_FEATHER);
+		}
+
+	} else if (layer->mode == 3) { // Filled Mirror (Solid waveform mirrored)
+		float max_amplitude = height * 0.4f;
+		float gain = max_amplitude * render_gain;
+
+		// Glow outline: the fill's edge closed down to the centre line at both ends
+		if (glow_on) {
+			size_t count = num_bins + 2;
+			px[0] = 0.0f;
+			polyline_ramp(num_bins, 0.0f, width / (float)num_bins, px + 1);
+			px[count - 1] = width;
+			for (float sign : {-1.0f, 1.0f}) {
+				py[0] = center_y;
+				polyline_scale(mags, num_bins, sign * gain * glow_gain, center_y, py + 1);
+				py[count - 1] = center_y;
+				StrokePolyline(px, py, glow, count, half_line, glow_feather);
 			}
+		}
 
-			// Draw main dots
-			gs_effect_set_color(gs_effect_get_param_by_name(solid, "color"), fix_color(color_start));
-			gs_render_start(true);
+		// Filled shape from the centre line
+		batch.Break();
+		for (size_t i = 0; i < num_bins; i++) {
+			float amplitude = mags[i] * gain;
+			float position = (float)i / (float)num_bins;
+			uint32_t col = Shade(position, position, mags[i] * render_gain);
+			float x = position * width;
+			batch.Vertex(x, center_y - amplitude, col);
+			batch.Vertex(x, center_y + amplitude, col);
+		}
+		batch.Break();
+	}
+}
 
-			bool first = true;
-			float last_x = 0.0f, last_y = 0.0f;
+// Bar and dot modes. Every shape is a quad in the batch; bar ends take the
+// gradient colour of their height so the amplitude gradient runs along them.
+void GlassLineSource::RenderShapes(size_t start_bin, size_t num_bins, float width, float height)
+{
+	const float *mags = display_magnitudes.data() + start_bin;
+	const uint32_t base = Shade(0.0f, 0.0f, 0.0f);
+	bool glow_on = render_glow > 0.01f;
+	float glow_gain = 1.0f + render_glow * 0.5f;
+	float center_y = height / 2.0f;
+
+	// Mean magnitude of the bins under bar `i` of `count`
+	auto bar_level = [&](int i, int count) {
+		size_t per_bar = num_bins / count;
+		if (per_bar == 0)
+			per_bar = 1;
+		float sum = 0.0f;
+		for (size_t j = 0; j < per_bar; j++) {
+			size_t bin = i * per_bar + j;
+			if (bin < num_bins)
+				sum += mags[bin];
+		}
+		return sum / per_bar * render_gain;
+	};
 
-			// Left side
-			for (size_t i = 0; i < num_bins / 2; i += 2) {
-				float mag = smoothed_magnitudes[start_bin + i] * amp_scale;
-				float amplitude = mag * max_amplitude;
-				float x = center_x - ((float)i / (float)(num_bins / 2)) * (center_x);
+	auto dot = [&](float x, float y, float radius, uint32_t col) {
+		batch.Rect(x - radius, y - radius, x + radius, y + radius, col);
+	};
 
-				// Top
-				float y1 = height / 2.0f - amplitude;
-				if (!first) {
-					gs_vertex2f(last_x, last_y);
-					gs_vertex2f(x - dot_size / 2, y1 - dot_size / 2);
-				}
-				gs_vertex2f(x - dot_size / 2, y1 - dot_size / 2);
-				gs_vertex2f(x - dot_size / 2, y1 + dot_size / 2);
-				gs_vertex2f(x + dot_size / 2, y1 - dot_size / 2);
-				gs_vertex2f(x + dot_size / 2, y1 + dot_size / 2);
-				last_x = x + dot_size / 2;
-				last_y = y1 + dot_size / 2;
-				first = false;
-
-				// Bottom
-				float y2 = height / 2.0f + amplitude;
-				gs_vertex2f(last_x, last_y);
-				gs_vertex2f(x - dot_size / 2, y2 - dot_size / 2);
-
-				gs_vertex2f(x - dot_size / 2, y2 - dot_size / 2);
-				gs_vertex2f(x - dot_size / 2, y2 + dot_size / 2);
-				gs_vertex2f(x + dot_size / 2, y2 - dot_size / 2);
-				gs_vertex2f(x + dot_size / 2, y2 + dot_size / 2);
-				last_x = x + dot_size / 2;
-				last_y = y2 + dot_size / 2;
+	auto shade_base = [&](float position) {
+		return layer->gradient_mode == GRADIENT_AMPLITUDE ? base : Shade(position, position, 0.0f);
+	};
+
+	if (layer->mode == 2) { // Mirrored Bars (Vertical bars from center)
+		float max_amplitude = height * 0.4f;
+		int count = MIRRORED_BARS;
+		if (count > (int)num_bins)
+			count = (int)num_bins;
+		float bar_width = width / count * 0.8f;
+
+		if (glow_on) {
+			for (int i = 0; i < count; i++) {
+				float amplitude = bar_level(i, count) * max_amplitude * glow_gain;
+				float x = (float)i / (float)count * width + (width / count * 0.1f);
+				batch.Rect(x, center_y - amplitude, x + bar_width, center_y, layer->glow_abgr);
 			}
+		}
 
-			// Right side
-			for (size_t i = 0; i < num_bins / 2; i += 2) {
-				float mag = smoothed_magnitudes[start_bin + i] * amp_scale;
-				float amplitude = mag * max_amplitude;
-				float x = center_x + ((float)i / (float)(num_bins / 2)) * (center_x);
-
-				// Top
-				float y1 = height / 2.0f - amplitude;
-				if (!first) {
-					gs_vertex2f(last_x, last_y);
-					gs_vertex2f(x - dot_size / 2, y1 - dot_size / 2);
+		for (int i = 0; i < count; i++) {
+			float level = bar_level(i, count);
+			float amplitude = level * max_amplitude;
+			float position = (float)i / (float)count;
+			float x = position * width + (width / count * 0.1f);
+			uint32_t tip = Shade(position, position, level);
+			uint32_t root = shade_base(position);
+			batch.Rect(x, center_y - amplitude, x + bar_width, center_y, tip, root);
+			batch.Rect(x, center_y, x + bar_width, center_y + amplitude, root, tip);
+		}
+
+	} else if (layer->mode == 4 || layer->mode == 6) { // Centered Dots / Symetric Dots
+		float max_amplitude = height * 0.3f;
+		float dot_size = layer->thickness * 2.0f;
+		size_t span = layer->mode == 4 ? num_bins / 2 : num_bins;
+		float center_x = width / 2.0f;
+
+		// Mode 4 runs from the centre out to both sides, mode 6 left to right
+		auto dots = [&](float gain, float radius, bool glow_pass) {
+			for (int side = layer->mode == 4 ? -1 : 1; side <= 1; side += 2) {
+				for (size_t i = 0; i < span; i += 2) {
+					float level = mags[i] * render_gain;
+					float amplitude = level * max_amplitude * gain;
+					float band = (float)i / (float)span;
+					float x = layer->mode == 4 ? center_x + side * band * center_x : band * width;
+					uint32_t col = glow_pass ? layer->glow_abgr : Shade(x / width, band, level);
+					dot(x, center_y - amplitude, radius, col);
+					dot(x, center_y + amplitude, radius, col);
 				}
-				gs_vertex2f(x - dot_size / 2, y1 - dot_size / 2);
-				gs_vertex2f(x - dot_size / 2, y1 + dot_size / 2);
-				gs_vertex2f(x + dot_size / 2, y1 - dot_size / 2);
-				gs_vertex2f(x + dot_size / 2, y1 + dot_size / 2);
-				last_x = x + dot_size / 2;
-				last_y = y1 + dot_size / 2;
-				first = false;
-
-				// Bottom
-				float y2 = height / 2.0f + amplitude;
-				gs_vertex2f(last_x, last_y);
-				gs_vertex2f(x - dot_size / 2, y2 - dot_size / 2);
-
-				gs_vertex2f(x - dot_size / 2, y2 - dot_size / 2);
-				gs_vertex2f(x - dot_size / 2, y2 + dot_size / 2);
-				gs_vertex2f(x + dot_size / 2, y2 - dot_size / 2);
-				gs_vertex2f(x + dot_size / 2, y2 + dot_size / 2);
-				last_x = x + dot_size / 2;
-				last_y = y2 + dot_size / 2;
 			}
-			gs_render_stop(GS_TRISTRIP);
-
-		} else if (mode == 5) { // Multi-Wave (3 overlapping waveforms)
-			float center_y = height / 2.0f;
-			float max_amplitude = height * 0.3f;
-
-			// Helper to draw one wave
-			auto draw_wave = [&](uint32_t col, float scale_mod, float y_offset) {
-				gs_effect_set_color(gs_effect_get_param_by_name(solid, "color"), fix_color(col));
-
-				// Top half
-				gs_render_start(true);
-				for (size_t i = 0; i < num_bins; i++) {
-					float mag = smoothed_magnitudes[start_bin + i] * amp_scale * scale_mod;
-					float amplitude = mag * max_amplitude;
-					float x = (float)i / (float)num_bins * width;
-					gs_vertex2f(x, center_y + y_offset - amplitude);
-				}
-				gs_render_stop(GS_LINESTRIP);
-
-				// Bottom half
-				gs_render_start(true);
-				for (size_t i = 0; i < num_bins; i++) {
-					float mag = smoothed_magnitudes[start_bin + i] * amp_scale * scale_mod;
-					float amplitude = mag * max_amplitude;
-					float x = (float)i / (float)num_bins * width;
-					gs_vertex2f(x, center_y + y_offset + amplitude);
-				}
-				gs_render_stop(GS_LINESTRIP);
-			};
+		};
+
+		if (glow_on)
+			dots(glow_gain, dot_size, true);
+		dots(1.0f, dot_size / 2, false);
+
+	} else if (layer->mode == 7) { // DNA Wave (Intertwined dots)
+		float max_amplitude = height * 0.3f;
+		float dot_size = layer->thickness * 2.0f;
+
+		// Locked to the tracked pitch, the strands twist once per period of
+		// the fundamental across the time window, like a triggered scope:
+		// the same note always draws the same helix
+		float twist = 0.1f;
+		if (held_pitch_hz > 0.0f) {
+			float cycles = std::min(held_pitch_hz * layer->window_ms / 1000.0f, (float)num_bins / 8.0f);
+			twist = 2.0f * (float)M_PI * cycles / (float)num_bins;
+		}
 
-			// Draw 3 waves with offsets
-			// Wave 1: Glow color, slightly larger, offset up
-			draw_wave(glow_color, 1.1f, -5.0f);
-
-			// Wave 2: End color, slightly smaller, offset down
-			draw_wave(color_end, 0.9f, 5.0f);
-
-			// Wave 3: Main color, normal size, center
-			draw_wave(color_start, 1.0f, 0.0f);
-
-		} else if (mode == 6) { // Symetric Dots
-			float center_y = height / 2.0f;
-			float max_amplitude = height * 0.3f;
-			float dot_size = thickness * 2.0f;
-
-			// Draw glow dots
-			if (glow_strength > 0.01f) {
-				gs_effect_set_color(gs_effect_get_param_by_name(solid, "color"), fix_color(glow_color));
-				gs_render_start(true);
-				bool first = true;
-				float last_x = 0.0f, last_y = 0.0f;
-
-				for (size_t i = 0; i < num_bins; i += 2) {
-					float mag = smoothed_magnitudes[start_bin + i] * amp_scale;
-					float amplitude = mag * max_amplitude * (1.0f + glow_strength * 0.5f);
-					float x = (float)i / (float)num_bins * width;
-
-					// Top dot
-					float y1 = center_y - amplitude;
-					if (!first) {
-						gs_vertex2f(last_x, last_y);
-						gs_vertex2f(x - dot_size, y1 - dot_size);
-					}
-					gs_vertex2f(x - dot_size, y1 - dot_size);
-					gs_vertex2f(x - dot_size, y1 + dot_size);
-					gs_vertex2f(x + dot_size, y1 - dot_size);
-					gs_vertex2f(x + dot_size, y1 + dot_size);
-					last_x = x + dot_size;
-					last_y = y1 + dot_size;
-					first = false;
-
-					// Bottom dot
-					float y2 = center_y + amplitude;
-					gs_vertex2f(last_x, last_y);
-					gs_vertex2f(x - dot_size, y2 - dot_size);
-
-					gs_vertex2f(x - dot_size, y2 - dot_size);
-					gs_vertex2f(x - dot_size, y2 + dot_size);
-					gs_vertex2f(x + dot_size, y2 - dot_size);
-					gs_vertex2f(x + dot_size, y2 + dot_size);
-					last_x = x + dot_size;
-					last_y = y2 + dot_size;
-				}
-				gs_render_stop(GS_TRISTRIP);
+		auto strand = [&](bool gradient_strand, float phase_offset) {
+			for (size_t i = 0; i < num_bins; i += 2) {
+				float level = mags[i] * render_gain;
+				float position = (float)i / (float)num_bins;
+
+				// Sine wave modulation for DNA effect
+				float sine_mod = sinf((float)i * twist + phase_offset);
+				float y = center_y + level * max_amplitude * sine_mod;
+				dot(position * width, y, dot_size / 2,
+				    gradient_strand ? Shade(position, position, level) : layer->end_abgr);
+			}
+		};
+
+		strand(true, 0.0f);
+		strand(false, 3.14159f); // 180 degree phase shift, end colour
+
+	} else if (layer->mode == 8) { // Pixel Bars (Blocky bars)
+		float max_amplitude = height * 0.4f;
+		int count = PIXEL_BARS; // Fewer bars for blocky look
+		if (count > (int)num_bins)
+			count = (int)num_bins;
+		float bar_width = width / count * 0.9f;
+		float block_height = bar_width; // Square blocks
+		float step = block_height * 1.2f;
+
+		for (int i = 0; i < count; i++) {
+			float amplitude = bar_level(i, count) * max_amplitude;
+			if (amplitude > center_y)
+				amplitude = center_y;
+			float position = (float)i / (float)count;
+			float x = position * width + (width / count * 0.05f);
+
+			// Each block takes the gradient colour of its distance from the centre
+			for (float d = 0.0f; d < amplitude; d += step) {
+				uint32_t col = Shade(position, position, d / max_amplitude);
+				batch.Rect(x, center_y - d - block_height, x + bar_width, center_y - d, col);
+				batch.Rect(x, center_y + d, x + bar_width, center_y + d + block_height, col);
 			}
+		}
 
-			// Draw main dots
-			gs_effect_set_color(gs_effect_get_param_by_name(solid, "color"), fix_color(color_start));
-			gs_render_start(true);
-			bool first = true;
-			float last_x = 0.0f, last_y = 0.0f;
+	} else if (layer->mode == 9) { // Circular Dots
+		float center_x = width / 2.0f;
+		float base_radius = (width < height ? width : height) * 0.3f;
+		float max_amp = base_radius * 0.5f;
+		float dot_size = layer->thickness * 2.0f;
 
-			for (size_t i = 0; i < num_bins; i += 2) {
-				float mag = smoothed_magnitudes[start_bin + i] * amp_scale;
-				float amplitude = mag * max_amplitude;
+		for (size_t i = 0; i < num_bins; i += 2) {
+			float level = mags[i] * render_gain;
+			float position = (float)i / (float)num_bins;
+			float angle = position * 2.0f * (float)M_PI;
+
+			float r = base_radius + level * max_amp;
+			dot(center_x + cosf(angle) * r, center_y + sinf(angle) * r, dot_size / 2,
+			    Shade(position, position, level));
+		}
+
+	} else if (layer->mode == 10) { // Spectrum Bars (Bottom up)
+		float max_height = height * 0.8f;
+		float bar_width = width / num_bins * 0.8f;
+		if (bar_width < 1.0f)
+			bar_width = 1.0f;
+
+		for (size_t i = 0; i < num_bins; i++) {
+			float level = mags[i] * render_gain;
+			float position = (float)i / (float)num_bins;
+			float x = position * width;
+			batch.Rect(x, height - level * max_height, x + bar_width, height, Shade(position, position, level),
+				   shade_base(position));
+		}
+
+		if (layer->peak_hold) {
+			const float *peaks = display_peaks.data() + start_bin;
+			float cap = layer->thickness;
+			for (size_t i = 0; i < num_bins; i++) {
+				float y = height - peaks[i] * render_gain * max_height;
 				float x = (float)i / (float)num_bins * width;
+				batch.Rect(x, y - cap, x + bar_width, y, layer->glow_abgr);
+			}
+		}
+	}
+}
 
-				// Top dot
-				float y1 = center_y - amplitude;
-				if (!first) {
-					gs_vertex2f(last_x, last_y);
-					gs_vertex2f(x - dot_size / 2, y1 - dot_size / 2);
-				}
-				gs_vertex2f(x - dot_size / 2, y1 - dot_size / 2);
-				gs_vertex2f(x - dot_size / 2, y1 + dot_size / 2);
-				gs_vertex2f(x + dot_size / 2, y1 - dot_size / 2);
-				gs_vertex2f(x + dot_size / 2, y1 + dot_size / 2);
-				last_x = x + dot_size / 2;
-				last_y = y1 + dot_size / 2;
-				first = false;
-
-				// Bottom dot
-				float y2 = center_y + amplitude;
-				gs_vertex2f(last_x, last_y);
-				gs_vertex2f(x - dot_size / 2, y2 - dot_size / 2);
-
-				gs_vertex2f(x - dot_size / 2, y2 - dot_size / 2);
-				gs_vertex2f(x - dot_size / 2, y2 + dot_size / 2);
-				gs_vertex2f(x + dot_size / 2, y2 - dot_size / 2);
-				gs_vertex2f(x + dot_size / 2, y2 + dot_size / 2);
-				last_x = x + dot_size / 2;
-				last_y = y2 + dot_size / 2;
+// Loudness modes, on a LOUDNESS_FLOOR to 0 scale. The meter is four bars
+// (momentary, short-term, integrated, true peak); whatever is over the
+// target, or over TRUE_PEAK_LIMIT on the true peak bar, is drawn in the
+// glow colour. The history plots the last minute of short-term loudness
+// with momentary behind it. Target lines are in the end colour.
+void GlassLineSource::RenderLoudness(float width, float height)
+{
+	auto level = [](float value) {
+		float l = (value - LOUDNESS_FLOOR) / -LOUDNESS_FLOOR;
+		return l > 0.0f ? (l < 1.0f ? l : 1.0f) : 0.0f; // Also takes -inf to 0
+	};
+	auto to_y = [&](float value) { return height * (1.0f - level(value)); };
+	float rule = layer->thickness;
+
+	if (layer->mode == 14) { // Loudness Meter
+		const float values[4] = {loudness.Momentary(), loudness.ShortTerm(), loudness.Integrated(),
+					 loudness.TruePeak()};
+		float slot = width / 4.0f;
+		float bar_width = slot * 0.6f;
+		for (int i = 0; i < 4; i++) {
+			float limit = i == 3 ? TRUE_PEAK_LIMIT : loudness_target;
+			float position = (float)i / 4.0f;
+			float x = position * width + slot * 0.2f;
+			float top = to_y(values[i]);
+			float over = to_y(limit);
+			if (top < over) {
+				batch.Rect(x, top, x + bar_width, over, layer->glow_abgr);
+				top = over;
 			}
-			gs_render_stop(GS_TRISTRIP);
-		} else if (mode == 7) { // DNA Wave (Intertwined dots)
-			float center_y = height / 2.0f;
-			float max_amplitude = height * 0.3f;
-			float dot_size = thickness * 2.0f;
-
-			auto draw_dna_strand = [&](uint32_t col, float phase_offset) {
-				gs_effect_set_color(gs_effect_get_param_by_name(solid, "color"), fix_color(col));
-				gs_render_start(true);
-				for (size_t i = 0; i < num_bins; i += 2) {
-					float mag = smoothed_magnitudes[start_bin + i] * amp_scale;
-					float base_amp = mag * max_amplitude;
-					float x = (float)i / (float)num_bins * width;
-
-					// Sine wave modulation for DNA effect
-					float sine_mod = sinf((float)i * 0.1f + phase_offset);
-					float y = center_y + base_amp * sine_mod;
-
-					gs_vertex2f(x - dot_size / 2, y - dot_size / 2);
-					gs_vertex2f(x - dot_size / 2, y + dot_size / 2);
-					gs_vertex2f(x + dot_size / 2, y - dot_size / 2);
-					gs_vertex2f(x + dot_size / 2, y + dot_size / 2);
-				}
-				gs_render_stop(GS_TRISTRIP);
-			};
+			batch.Rect(x, top, x + bar_width, height, Shade(position, position, level(values[i])),
+				   Shade(position, position, 0.0f));
+			batch.Rect(x - slot * 0.1f, over - rule * 0.5f, x + bar_width + slot * 0.1f, over + rule * 0.5f,
+				   layer->end_abgr);
+		}
+		return;
+	}
 
-			draw_dna_strand(color_start, 0.0f);
-			draw_dna_strand(color_end, 3.14159f); // 180 degree phase shift
+	// Loudness History, newest block at the right edge
+	FillCurveColors();
+	float *px = poly_x.data();
+	float *py = poly_y.data();
+	uint32_t *pc = poly_c.data();
+	float half_line = layer->line_width * 0.5f;
+	float step = width / (float)(LOUDNESS_HISTORY - 1);
+	uint64_t newest = loudness.Blocks();
+	uint64_t oldest = loudness.OldestBlock();
+
+	float target_y = to_y(loudness_target);
+	batch.Rect(0.0f, target_y - rule * 0.5f, width, target_y + rule * 0.5f, layer->end_abgr);
+
+	// Blocks without a value (silence, or a window still filling) break the curve
+	auto plot = [&](bool short_term, const uint32_t *colors, float half_width, float feather) {
+		size_t count = 0;
+		for (uint64_t i = oldest; i <= newest; i++) {
+			float value = -INFINITY;
+			if (i < newest) {
+				const LoudnessBlock &block = loudness.Block(i);
+				value = short_term ? block.short_term : block.momentary;
+			}
+			if (value > LOUDNESS_FLOOR) {
+				float x = width - (float)(newest - 1 - i) * step;
+				px[count] = x;
+				py[count] = to_y(value);
+				if (colors == pc)
+					pc[count] = Shade(x / width, x / width, level(value));
+				count++;
+			} else if (count > 0) {
+				if (count > 1)
+					StrokePolyline(px, py, colors, count, half_width, feather);
+				count = 0;
+			}
+		}
+	};
 
-		} else if (mode == 8) { // Pixel Bars (Blocky bars)
-			float center_y = height / 2.0f;
-			float max_amplitude = height * 0.4f;
-			int count = 32; // Fewer bars for blocky look
-			if (count > (int)num_bins)
-				count = (int)num_bins;
-			size_t bins_per_bar = num_bins / count;
-			float bar_width = width / count * 0.9f;
-			float block_height = bar_width; // Square blocks
+	plot(false, poly_glow.data(), half_line * 0.5f, AA_FEATHER);
+	if (render_glow > 0.01f)
+		plot(true, poly_glow.data(), half_line, AA_FEATHER + layer->thickness * 4.0f * render_glow);
+	plot(true, pc, half_line, AA_FEATHER);
 
-			gs_effect_set_color(gs_effect_get_param_by_name(solid, "color"), fix_color(color_start));
-			gs_render_start(true);
+	float integrated = loudness.Integrated();
+	if (integrated > LOUDNESS_FLOOR) {
+		float y = to_y(integrated);
+		batch.Rect(0.0f, y - rule * 0.25f, width, y + rule * 0.25f, layer->glow_abgr);
+	}
+}
 
-			for (int i = 0; i < count; i++) {
-				float sum = 0.0f;
-				for (size_t j = 0; j < bins_per_bar; j++) {
-					size_t bin_idx = start_bin + i * bins_per_bar + j;
-					if (bin_idx < smoothed_magnitudes.size())
-						sum += smoothed_magnitudes[bin_idx];
-				}
-				float mag = (sum / bins_per_bar) * amp_scale;
-				float amplitude = mag * max_amplitude;
+void GlassLineSource::Render(gs_effect_t *effect)
+{
+	UNUSED_PARAMETER(effect);
 
-				float x = (float)i / (float)count * width + (width / count * 0.05f);
+	std::lock_guard<CoreMutex> lock(audio_mutex);
 
-				// Draw blocks up
-				for (float y = center_y; y > center_y - amplitude; y -= block_height * 1.2f) {
-					gs_vertex2f(x, y - block_height);
-					gs_vertex2f(x, y);
-					gs_vertex2f(x + bar_width, y - block_height);
-					gs_vertex2f(x + bar_width, y);
-				}
+	uint64_t render_start = Now();
+	RenderFrame();
+	render_cost_ns += Now() - render_start; // For the governor
+}
 
-				// Draw blocks down
-				for (float y = center_y; y < center_y + amplitude; y += block_height * 1.2f) {
-					gs_vertex2f(x, y);
-					gs_vertex2f(x, y + block_height);
-					gs_vertex2f(x + bar_width, y);
-					gs_vertex2f(x + bar_width, y + block_height);
-				}
-			}
-			gs_render_stop(GS_TRISTRIP);
-		} else if (mode == 9) { // Circular Dots
-			float center_x = width / 2.0f;
-			float center_y = height / 2.0f;
-			float base_radius = (width < height ? width : height) * 0.3f;
-			float max_amp = base_radius * 0.5f;
-			float dot_size = thickness * 2.0f;
-
-			gs_effect_set_color(gs_effect_get_param_by_name(solid, "color"), fix_color(color_start));
-			gs_render_start(true);
-			bool first = true;
-			float last_x = 0.0f, last_y = 0.0f;
+void GlassLineSource::RenderFrame()
+{
+	float width = (float)obs_source_get_width(source);
+	float height = (float)obs_source_get_height(source);
+	const QualityLevel &quality = governor.Settings();
+
+	// Every layer draws from the same snapshot: one display spectrum and one
+	// band range, prepared before any of them
+	bool need_spectrum = false;
+	bool need_spectrogram = false;
+	float scope_persistence_ms = 0.0f; // The lowest vectorscope layer's, for the shared trace
+	for (const VisualLayer &l : layers) {
+		need_spectrum = need_spectrum || (l.mode < 11 || l.mode == 13) || l.gradient_mode == GRADIENT_PITCH;
+		need_spectrogram = need_spectrogram || l.mode == 13;
+		if (l.mode == 16 && scope_persistence_ms == 0.0f)
+			scope_persistence_ms = l.window_ms;
+	}
 
-			for (size_t i = 0; i < num_bins; i += 2) {
-				float mag = smoothed_magnitudes[start_bin + i] * amp_scale;
-				float amplitude = mag * max_amp;
-				float angle = (float)i / (float)num_bins * 2.0f * (float)M_PI;
+	size_t start_bin = 1;
+	size_t num_bins = 0;
+	if (need_spectrum && UpdateDisplaySpectrum(obs_get_video_frame_time())) {
+		// Bins run up to the configured top frequency at the analysis (decimated) rate
+		float bin_hz = analysis_rate / (float)(display_magnitudes.size() * 2);
+		size_t end_bin = (size_t)(top_freq / bin_hz);
+		if (end_bin > display_magnitudes.size())
+			end_bin = display_magnitudes.size();
+		num_bins = end_bin > start_bin ? end_bin - start_bin : 0;
+
+		// Held through unpitched stretches, so colours and the DNA twist don't flicker
+		if (track_pitch && display_features.pitch_confidence >= PITCH_MIN_CONFIDENCE)
+			held_pitch_hz = display_features.pitch_hz;
+	}
 
-				float r = base_radius + amplitude;
-				float x = center_x + cosf(angle) * r;
-				float y = center_y + sinf(angle) * r;
+	if (need_spectrogram && num_bins > 0)
+		UpdateSpectrogram(start_bin, num_bins);
+	if (scope_persistence_ms > 0.0f)
+		UpdateScope(scope_persistence_ms);
+
+	// Fewer bands under the governor: each keeps the loudest of its bins.
+	// The display spectrum is rebuilt every frame, so pooling in place is safe.
+	size_t stride = (size_t)quality.band_stride;
+	if (stride > 1 && num_bins / stride >= MIN_POOLED_BANDS) {
+		pool_bands(display_magnitudes.data() + start_bin, num_bins, stride);
+		if (any_peak_hold)
+			pool_bands(display_peaks.data() + start_bin, num_bins, stride);
+		num_bins /= stride;
+	}
 
-				if (!first) {
-					gs_vertex2f(last_x, last_y);
-					gs_vertex2f(x - dot_size / 2, y - dot_size / 2);
-				}
-				gs_vertex2f(x - dot_size / 2, y - dot_size / 2);
-				gs_vertex2f(x + dot_size / 2, y - dot_size / 2);
-				gs_vertex2f(x - dot_size / 2, y + dot_size / 2);
-				gs_vertex2f(x + dot_size / 2, y + dot_size / 2);
-				last_x = x + dot_size / 2;
-				last_y = y + dot_size / 2;
-				first = false;
-			}
-			gs_render_stop(GS_TRISTRIP);
+	// Beat bump, decaying over BEAT_PULSE_DECAY_NS; each layer scales it by its own beat pulse
+	float beat = 0.0f;
+	if (last_beat_time) {
+		double since = (double)(int64_t)(obs_get_video_frame_time() - (uint64_t)playout_delay - last_beat_time);
+		if (since >= 0.0)
+			beat = (float)exp(-since / BEAT_PULSE_DECAY_NS);
+	}
 
-		} else if (mode == 10) { // Spectrum Bars (Bottom up)
-			float max_height = height * 0.8f;
-			float bar_width = width / num_bins * 0.8f;
-			if (bar_width < 1.0f)
-				bar_width = 1.0f;
+	// All layers append to one batch, placed on the CPU, and record their range
+	batch.Begin();
+	layer_draws.clear();
+	for (const VisualLayer &l : layers) {
+		layer = &l;
+		render_glow = quality.glow ? l.glow_strength : 0.0f;
+		render_gain = l.amp_scale * fft_gain * (1.0f + l.beat_pulse * beat);
+		render_pitch_abgr = l.gradient_mode == GRADIENT_PITCH ? pitch_color(l.start_abgr, held_pitch_hz)
+								      : l.start_abgr;
+
+		if (l.mode == 13) {
+			if (num_bins > 0)
+				layer_draws.push_back({&l, batch.Count(), 0});
+			continue;
+		}
 
-			gs_effect_set_color(gs_effect_get_param_by_name(solid, "color"), fix_color(color_start));
-			gs_render_start(true);
+		if (l.Placed()) {
+			float matrix[6];
+			l.Transform(width, height, matrix);
+			batch.SetTransform(matrix, l.opacity);
+		} else {
+			batch.ClearTransform();
+		}
 
-			for (size_t i = 0; i < num_bins; i++) {
-				float mag = smoothed_magnitudes[start_bin + i] * amp_scale;
-				float h = mag * max_height;
-				float x = (float)i / (float)num_bins * width;
-				float y = height;
+		size_t start = batch.Count();
+		if (l.mode == 11 || l.mode == 12)
+			RenderWaveform(width, height);
+		else if (l.mode == 14 || l.mode == 15)
+			RenderLoudness(width, height);
+		else if (l.mode == 16)
+			RenderScope(width, height);
+		else if (num_bins == 0)
+			continue;
+		else if (l.mode == 0 || l.mode == 1 || l.mode == 3 || l.mode == 5)
+			RenderLines(start_bin, num_bins, width, height);
+		else
+			RenderShapes(start_bin, num_bins, width, height);
+		layer_draws.push_back({&l, start, batch.Count() - start});
+	}
+	batch.ClearTransform();
+
+	DrawLayers(width, height);
+	layer = nullptr;
+}
 
-				gs_vertex2f(x, y - h);
-				gs_vertex2f(x, y);
-				gs_vertex2f(x + bar_width, y - h);
-				gs_vertex2f(x + bar_width, y);
+// Pushes the blend state for a layer and returns the technique to draw it
+// with. Add, screen and multiply take premultiplied colour.
+static const char *push_layer_blend(int blend, bool scaled)
+{
+	gs_blend_state_push();
+	switch (blend) {
+	case LAYER_BLEND_ADD:
+		gs_blend_function_separate(GS_BLEND_ONE, GS_BLEND_ONE, GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+		return "DrawPremultiplied";
+	case LAYER_BLEND_SCREEN:
+		gs_blend_function_separate(GS_BLEND_INVDSTCOLOR, GS_BLEND_ONE, GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+		return "DrawPremultiplied";
+	case LAYER_BLEND_MULTIPLY:
+		gs_blend_function_separate(GS_BLEND_DSTCOLOR, GS_BLEND_INVSRCALPHA, GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+		return "DrawPremultiplied";
+	default:
+		// Premultiplied into the texture so edges don't darken when it's stretched
+		if (scaled)
+			gs_blend_function_separate(GS_BLEND_SRCALPHA, GS_BLEND_INVSRCALPHA, GS_BLEND_ONE,
+						   GS_BLEND_INVSRCALPHA);
+		return "Draw";
+	}
+}
+
+// Draws the layers bottom first from one vertex upload, through a smaller
+// texture stretched over the source when the governor has lowered the
+// render scale. Consecutive geometry layers with the same blend go out as
+// one draw. Blends combine with whatever is below the source, or with only
+// this source's lower layers when drawing into the scaled texture.
+void GlassLineSource::DrawLayers(float width, float height)
+{
+	if (layer_draws.empty())
+		return;
+
+	bool scaled = false;
+	float scale = governor.Settings().render_scale;
+	if (scale < 1.0f) {
+		if (!scaled_target)
+			scaled_target = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+		uint32_t cx = (uint32_t)(width * scale);
+		uint32_t cy = (uint32_t)(height * scale);
+		if (scaled_target) {
+			gs_texrender_reset(scaled_target);
+			scaled = cx > 0 && cy > 0 && gs_texrender_begin(scaled_target, cx, cy);
+		}
+		if (scaled) {
+			struct vec4 zero;
+			vec4_set(&zero, 0.0f, 0.0f, 0.0f, 0.0f);
+			gs_clear(GS_CLEAR_COLOR, &zero, 0.0f, 0);
+			gs_ortho(0.0f, width, 0.0f, height, -100.0f, 100.0f);
+		}
+	}
+
+	batch.Upload();
+	for (size_t i = 0; i < layer_draws.size();) {
+		const LayerDraw &draw = layer_draws[i];
+		int blend = draw.layer->blend;
+
+		// Textured layers draw on their own; the vectorscope's meter goes over its trace
+		if (draw.layer->mode == 13 || draw.layer->mode == 16) {
+			layer = draw.layer;
+			const char *technique = push_layer_blend(blend, scaled);
+			if (layer->mode == 13) {
+				DrawSpectrogram(width, height, technique);
+			} else {
+				DrawScope(width, height, technique);
+				if (draw.count > 0)
+					batch.DrawRange(geometry_effect, technique, draw.start, draw.count);
 			}
-			gs_render_stop(GS_TRISTRIP);
+			gs_blend_state_pop();
+			i++;
+			continue;
 		}
+
+		// Layers append in order, so a run of them is one vertex range
+		size_t start = draw.start;
+		size_t end = draw.start + draw.count;
+		for (i++; i < layer_draws.size(); i++) {
+			const LayerDraw &next = layer_draws[i];
+			if (next.layer->mode == 13 || next.layer->mode == 16 || next.layer->blend != blend)
+				break;
+			end = next.start + next.count;
+		}
+		if (end == start)
+			continue;
+
+		const char *technique = push_layer_blend(blend, scaled);
+		batch.DrawRange(geometry_effect, technique, start, end - start);
+		gs_blend_state_pop();
 	}
+
+	if (!scaled)
+		return;
+	gs_texrender_end(scaled_target);
+
+	gs_texture_t *texture = gs_texrender_get_texture(scaled_target);
+	gs_effect_t *copy = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+	gs_effect_set_texture(gs_effect_get_param_by_name(copy, "image"), texture);
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+	while (gs_effect_loop(copy, "Draw"))
+		gs_draw_sprite(texture, 0, (uint32_t)width, (uint32_t)height);
+	gs_blend_state_pop();
 }
 
 // OBS Source Callbacks
@@ -914,6 +1779,12 @@ static void glass_line_update(void *data, obs_data_t *settings)
 	context->Update(settings);
 }
 
+static void glass_line_video_tick(void *data, float seconds)
+{
+	GlassLineSource *context = (GlassLineSource *)data;
+	context->Tick(seconds);
+}
+
 static void glass_line_video_render(void *data, gs_effect_t *effect)
 {
 	GlassLineSource *context = (GlassLineSource *)data;
@@ -934,21 +1805,150 @@ static uint32_t glass_line_get_height(void *data)
 
 static void glass_line_get_defaults(obs_data_t *settings)
 {
-	obs_data_set_default_int(settings, S_MODE, 0);
+	set_layer_defaults(settings);
 	obs_data_set_default_int(settings, S_COLOR, 0xFFFFFFFF);
-	obs_data_set_default_int(settings, S_COLOR_START, 0xFFFFE7C1);
-	obs_data_set_default_int(settings, S_COLOR_END, 0xFFB63814);
-	obs_data_set_default_int(settings, S_GLOW_COLOR, 0xFFFF7832);
-	obs_data_set_default_double(settings, S_GLOW_STRENGTH, 0.5);
-	obs_data_set_default_double(settings, S_THICKNESS, 2.0);
-	obs_data_set_default_double(settings, S_LINE_WIDTH, 4.0);
-	obs_data_set_default_double(settings, S_SMOOTHING, 0.5);
-	obs_data_set_default_double(settings, S_AMP_SCALE, 1.0);
+	obs_data_set_default_double(settings, S_ATTACK_MS, 20.0);
+	obs_data_set_default_double(settings, S_RELEASE_MS, 150.0);
+	obs_data_set_default_double(settings, S_HOP_MS, 10.0);
+	obs_data_set_default_bool(settings, S_GOVERNOR, false);
+	obs_data_set_default_bool(settings, S_DECIMATE, false);
+	obs_data_set_default_int(settings, S_TOP_FREQ, 12000);
+	obs_data_set_default_double(settings, S_LOUDNESS_TARGET, -14.0);
+	obs_data_set_default_int(settings, S_LAYER, 0);
+	obs_data_set_default_bool(settings, S_RECORD, false);
+	obs_data_set_default_int(settings, S_RECORD_ENCODING, FLIGHT_ENCODING_LOG8);
+	obs_data_set_default_double(settings, S_REPLAY_START, 0.0);
+	obs_data_set_default_bool(settings, S_CAPTURE, false);
+	obs_data_set_default_bool(settings, S_SHM, false);
+	obs_data_set_default_string(settings, S_SHM_NAME, ""); // Named after the source
+}
+
+static bool glass_line_log_latency(obs_properties_t *props, obs_property_t *property, void *data)
+{
+	UNUSED_PARAMETER(props);
+	UNUSED_PARAMETER(property);
+	((GlassLineSource *)data)->LogLatency();
+	return false;
+}
+
+static bool glass_line_export_latency(obs_properties_t *props, obs_property_t *property, void *data)
+{
+	UNUSED_PARAMETER(props);
+	UNUSED_PARAMETER(property);
+	((GlassLineSource *)data)->ExportLatency();
+	return false;
+}
+
+static bool glass_line_reset_loudness(obs_properties_t *props, obs_property_t *property, void *data)
+{
+	UNUSED_PARAMETER(props);
+	UNUSED_PARAMETER(property);
+	GlassLineSource *context = (GlassLineSource *)data;
+	std::lock_guard<CoreMutex> lock(context->audio_mutex);
+	context->loudness.Reset();
+	return false;
+}
+
+// Layer editing. The style and placement controls show the layer picked in
+// S_LAYER; S_LAYER_EDITED remembers which item they belong to so a switch
+// can store them back before loading the next one.
+static void fill_layer_list(obs_property_t *list, size_t count)
+{
+	obs_property_list_clear(list);
+	for (size_t i = 0; i < (count > 0 ? count : 1); i++) {
+		std::string name = "Layer " + std::to_string(i + 1);
+		obs_property_list_add_int(list, name.c_str(), (long long)i);
+	}
+}
+
+static void edit_layer(obs_data_t *settings, obs_data_array_t *array, size_t index)
+{
+	obs_data_t *item = obs_data_array_item(array, index);
+	set_layer_defaults(item);
+	copy_layer_settings(item, settings);
+	obs_data_release(item);
+	obs_data_set_int(settings, S_LAYER, (long long)index);
+	obs_data_set_int(settings, S_LAYER_EDITED, (long long)index);
+}
+
+static bool glass_line_layer_changed(obs_properties_t *props, obs_property_t *property, obs_data_t *settings)
+{
+	UNUSED_PARAMETER(props);
+	UNUSED_PARAMETER(property);
+	obs_data_array_t *array = obs_data_get_array(settings, S_LAYERS);
+	size_t count = array ? obs_data_array_count(array) : 0;
+	long long edited = obs_data_get_int(settings, S_LAYER_EDITED);
+	long long wanted = obs_data_get_int(settings, S_LAYER);
+	bool changed = count > 0 && wanted != edited && wanted >= 0 && (size_t)wanted < count;
+	if (changed) {
+		if (edited >= 0 && (size_t)edited < count) {
+			obs_data_t *item = obs_data_array_item(array, (size_t)edited);
+			copy_layer_settings(settings, item);
+			obs_data_release(item);
+		}
+		edit_layer(settings, array, (size_t)wanted);
+	}
+	obs_data_array_release(array);
+	return changed;
+}
+
+static bool glass_line_add_layer(obs_properties_t *props, obs_property_t *property, void *data)
+{
+	UNUSED_PARAMETER(property);
+	GlassLineSource *context = (GlassLineSource *)data;
+	obs_data_t *settings = obs_source_get_settings(context->source);
+	obs_data_array_t *array = obs_data_get_array(settings, S_LAYERS);
+	if (!array) {
+		array = obs_data_array_create();
+		obs_data_set_array(settings, S_LAYERS, array);
+	}
+
+	// The first extra layer turns the single style into layer 1, and every
+	// new layer starts as a copy of the one being edited
+	size_t count = obs_data_array_count(array);
+	size_t copies = count == 0 ? 2 : 1;
+	for (size_t i = 0; i < copies && count < MAX_LAYERS; i++, count++) {
+		obs_data_t *item = obs_data_create();
+		copy_layer_settings(settings, item);
+		obs_data_array_push_back(array, item);
+		obs_data_release(item);
+	}
+	edit_layer(settings, array, count - 1);
+	fill_layer_list(obs_properties_get(props, S_LAYER), count);
+
+	obs_data_array_release(array);
+	obs_data_release(settings);
+	obs_source_update(context->source, nullptr);
+	return true;
+}
+
+static bool glass_line_remove_layer(obs_properties_t *props, obs_property_t *property, void *data)
+{
+	UNUSED_PARAMETER(property);
+	GlassLineSource *context = (GlassLineSource *)data;
+	obs_data_t *settings = obs_source_get_settings(context->source);
+	obs_data_array_t *array = obs_data_get_array(settings, S_LAYERS);
+	size_t count = array ? obs_data_array_count(array) : 0;
+	bool removed = count > 1;
+	if (removed) {
+		long long edited = obs_data_get_int(settings, S_LAYER_EDITED);
+		size_t index = edited < 0 ? 0 : (size_t)edited < count ? (size_t)edited : count - 1;
+		obs_data_array_erase(array, index);
+		count--;
+		edit_layer(settings, array, index < count ? index : count - 1);
+		fill_layer_list(obs_properties_get(props, S_LAYER), count);
+	}
+
+	obs_data_array_release(array);
+	obs_data_release(settings);
+	if (removed)
+		obs_source_update(context->source, nullptr);
+	return removed;
 }
 
 static obs_properties_t *glass_line_get_properties(void *data)
 {
-	UNUSED_PARAMETER(data);
+	GlassLineSource *context = (GlassLineSource *)data;
 	obs_properties_t *props = obs_properties_create();
 
 	obs_properties_add_list(props, S_SOURCE, T_SOURCE, OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
@@ -965,11 +1965,42 @@ static obs_properties_t *glass_line_get_properties(void *data)
 			if ((flags & OBS_SOURCE_AUDIO) != 0) {
 				const char *name = obs_source_get_name(source);
 				obs_property_list_add_string(ed->prop, name, name);
+
+				// Then each audio tap in its filter chain
+				obs_source_enum_filters(
+					source,
+					[](obs_source_t *parent, obs_source_t *filter, void *param) {
+						if (strcmp(obs_source_get_id(filter), AUDIO_TAP_ID) != 0)
+							return;
+						std::string parent_name = obs_source_get_name(parent);
+						std::string filter_name = obs_source_get_name(filter);
+						std::string label = parent_name + " / " + filter_name;
+						std::string value = parent_name + TAP_SEPARATOR + filter_name;
+						obs_property_list_add_string((obs_property_t *)param, label.c_str(),
+									     value.c_str());
+					},
+					ed->prop);
 			}
 			return true;
 		},
 		&enum_data);
 
+	// Layers: the controls below Remove Layer edit the one picked here
+	size_t layer_count = 0;
+	if (context) {
+		obs_data_t *settings = obs_source_get_settings(context->source);
+		obs_data_array_t *array = obs_data_get_array(settings, S_LAYERS);
+		layer_count = array ? obs_data_array_count(array) : 0;
+		obs_data_array_release(array);
+		obs_data_release(settings);
+	}
+	obs_property_t *layer_list =
+		obs_properties_add_list(props, S_LAYER, T_LAYER, OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	fill_layer_list(layer_list, layer_count);
+	obs_property_set_modified_callback(layer_list, glass_line_layer_changed);
+	obs_properties_add_button(props, S_LAYER_ADD, T_LAYER_ADD, glass_line_add_layer);
+	obs_properties_add_button(props, S_LAYER_REMOVE, T_LAYER_REMOVE, glass_line_remove_layer);
+
 	obs_property_t *mode_list =
 		obs_properties_add_list(props, S_MODE, T_MODE, OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
 	obs_property_list_add_int(mode_list, "Centered Waveform", 0);
@@ -983,6 +2014,12 @@ static obs_properties_t *glass_line_get_properties(void *data)
 	obs_property_list_add_int(mode_list, "Pixel Bars", 8);
 	obs_property_list_add_int(mode_list, "Circular Dots", 9);
 	obs_property_list_add_int(mode_list, "Spectrum Bars", 10);
+	obs_property_list_add_int(mode_list, "Waveform", 11);
+	obs_property_list_add_int(mode_list, "Oscilloscope", 12);
+	obs_property_list_add_int(mode_list, "Spectrogram", 13);
+	obs_property_list_add_int(mode_list, "Loudness Meter", 14);
+	obs_property_list_add_int(mode_list, "Loudness History", 15);
+	obs_property_list_add_int(mode_list, "Vectorscope", 16);
 
 	obs_properties_add_color(props, S_COLOR, T_COLOR);
 	obs_properties_add_color(props, S_COLOR_START, T_COLOR_START);
@@ -991,8 +2028,56 @@ static obs_properties_t *glass_line_get_properties(void *data)
 	obs_properties_add_float_slider(props, S_GLOW_STRENGTH, T_GLOW_STRENGTH, 0.0f, 1.0f, 0.01f);
 	obs_properties_add_float(props, S_THICKNESS, T_THICKNESS, 1.0f, 20.0f, 0.5f);
 	obs_properties_add_float(props, S_LINE_WIDTH, T_LINE_WIDTH, 1.0f, 20.0f, 0.5f);
-	obs_properties_add_float(props, S_SMOOTHING, T_SMOOTHING, 0.0f, 1.0f, 0.01f);
+	obs_property_t *join_list =
+		obs_properties_add_list(props, S_LINE_JOIN, T_LINE_JOIN, OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(join_list, "Round", POLYLINE_JOIN_ROUND);
+	obs_property_list_add_int(join_list, "Miter", POLYLINE_JOIN_MITER);
+	obs_property_t *gradient_list =
+		obs_properties_add_list(props, S_GRADIENT, T_GRADIENT, OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(gradient_list, "None (Start Color)", GRADIENT_SOLID);
+	obs_property_list_add_int(gradient_list, "Left to Right", GRADIENT_POSITION);
+	obs_property_list_add_int(gradient_list, "Low to High Frequency", GRADIENT_BAND);
+	obs_property_list_add_int(gradient_list, "By Amplitude", GRADIENT_AMPLITUDE);
+	obs_property_list_add_int(gradient_list, "By Pitch", GRADIENT_PITCH);
+	obs_properties_add_float(props, S_LAYER_X, T_LAYER_X, -100.0, 100.0, 1.0);
+	obs_properties_add_float(props, S_LAYER_Y, T_LAYER_Y, -100.0, 100.0, 1.0);
+	obs_properties_add_float(props, S_LAYER_SCALE, T_LAYER_SCALE, 10.0, 400.0, 1.0);
+	obs_properties_add_float(props, S_LAYER_ROTATION, T_LAYER_ROTATION, -180.0, 180.0, 1.0);
+	obs_properties_add_float_slider(props, S_LAYER_OPACITY, T_LAYER_OPACITY, 0.0, 100.0, 1.0);
+	obs_property_t *blend_list =
+		obs_properties_add_list(props, S_LAYER_BLEND, T_LAYER_BLEND, OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(blend_list, "Normal", LAYER_BLEND_NORMAL);
+	obs_property_list_add_int(blend_list, "Add", LAYER_BLEND_ADD);
+	obs_property_list_add_int(blend_list, "Screen", LAYER_BLEND_SCREEN);
+	obs_property_list_add_int(blend_list, "Multiply", LAYER_BLEND_MULTIPLY);
+	obs_properties_add_float(props, S_ATTACK_MS, T_ATTACK_MS, 0.0, MAX_ATTACK_MS, 1.0);
+	obs_properties_add_float(props, S_RELEASE_MS, T_RELEASE_MS, 0.0, MAX_RELEASE_MS, 1.0);
+	obs_properties_add_float(props, S_HOP_MS, T_HOP_MS, MIN_HOP_MS, 100.0, 1.0);
 	obs_properties_add_float(props, S_AMP_SCALE, T_AMP_SCALE, 0.1f, 100.0f, 0.1f);
+	obs_properties_add_float_slider(props, S_BEAT_PULSE, T_BEAT_PULSE, 0.0, 1.0, 0.01);
+	obs_properties_add_bool(props, S_PEAK_HOLD, T_PEAK_HOLD);
+	obs_properties_add_bool(props, S_DECIMATE, T_DECIMATE);
+	obs_properties_add_int(props, S_TOP_FREQ, T_TOP_FREQ, 500, 24000, 100);
+	obs_properties_add_float(props, S_WINDOW_MS, T_WINDOW_MS, 10.0, MAX_WINDOW_SECONDS * 1000.0, 10.0);
+	obs_properties_add_bool(props, S_TRIGGER, T_TRIGGER);
+	obs_properties_add_float(props, S_LOUDNESS_TARGET, T_LOUDNESS_TARGET, -30.0, -5.0, 0.5);
+	obs_properties_add_button(props, S_LOUDNESS_RESET, T_LOUDNESS_RESET, glass_line_reset_loudness);
+	obs_properties_add_bool(props, S_GOVERNOR, T_GOVERNOR);
+
+	obs_properties_add_bool(props, S_RECORD, T_RECORD);
+	obs_properties_add_path(props, S_RECORD_PATH, T_RECORD_PATH, OBS_PATH_DIRECTORY, nullptr, nullptr);
+	obs_property_t *encoding_list = obs_properties_add_list(props, S_RECORD_ENCODING, T_RECORD_ENCODING,
+								 OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(encoding_list, "8-bit Log (compact)", FLIGHT_ENCODING_LOG8);
+	obs_property_list_add_int(encoding_list, "Float16", FLIGHT_ENCODING_FLOAT16);
+	obs_properties_add_path(props, S_REPLAY_FILE, T_REPLAY_FILE, OBS_PATH_FILE, "GlassLine Recording (*.glfr)",
+				nullptr);
+	obs_properties_add_float(props, S_REPLAY_START, T_REPLAY_START, 0.0, 86400.0, 1.0);
+	obs_properties_add_bool(props, S_CAPTURE, T_CAPTURE);
+	obs_properties_add_bool(props, S_SHM, T_SHM);
+	obs_properties_add_text(props, S_SHM_NAME, T_SHM_NAME, OBS_TEXT_DEFAULT);
+	obs_properties_add_button(props, S_LATENCY_LOG, T_LATENCY_LOG, glass_line_log_latency);
+	obs_properties_add_button(props, S_LATENCY_EXPORT, T_LATENCY_EXPORT, glass_line_export_latency);
 
 	return props;
 }
@@ -1008,6 +2093,7 @@ struct obs_source_info glass_line_source = {
 	.get_height = glass_line_get_height,
 	.get_defaults = glass_line_get_defaults,
 	.update = glass_line_update,
+	.video_tick = glass_line_video_tick,
 	.video_render = glass_line_video_render,
 	.get_properties = glass_line_get_properties,
 };
@@ -1,46 +1,117 @@
 #pragma once
 
 #include <obs.h>
+#include "visualizer-core.hpp"
+#include "polyline.hpp"
+#include "gradient.hpp"
+#include "geometry-batch.hpp"
 #include <vector>
 #include <string>
-#include <mutex>
+#include <memory>
 
-struct GlassLineSource {
+// The OBS side of a visualizer: settings, the audio source binding and
+// drawing, around the shared state and locking in VisualizerCore
+struct GlassLineSource : VisualizerCore {
 	obs_source_t *source;
 
 	// Settings
 	std::string audio_source_name;
-	int mode; // 0: Centered Waveform, 1: Symmetric Waveform, 2: Mirrored Bars, 3: Filled Mirror, 4: Centered Dots, 5: Multi-Wave, 6: Symetric Dots, 7: DNA Wave, 8: Pixel Bars, 9: Circular Dots, 10: Spectrum Bars
 	uint32_t color;
-	uint32_t color_start; // Gradient start color
-	uint32_t color_end;   // Gradient end color
-	uint32_t glow_color;  // Glow/shadow color
-	float glow_strength;  // Glow intensity (0.0-1.0)
-	float thickness;
-	float line_width; // Line width for waveform modes
-	float smoothing;
-	float amp_scale; // Audio amplitude scaling
+	float loudness_target = -14.0f; // LUFS marked by the loudness modes
 
 	// Audio Data
-	std::mutex audio_mutex;
-	std::vector<float> audio_data; // Raw samples for line mode (optional)
+	std::vector<float> wave_min; // Per-pixel envelope, reused every frame
+	std::vector<float> wave_max;
 
-	// FFT State
-	std::vector<float> fft_input_buffer;
-	std::vector<float> fft_output_magnitudes;
-	std::vector<float> smoothed_magnitudes;
+	// Render-side analysis state (under audio_mutex)
+	float held_pitch_hz = 0.0f;     // Last confident pitch shown, 0 before the first
+	float render_gain = 1.0f;       // amp_scale with fft_gain and the beat pulse applied
+	uint32_t render_pitch_abgr = 0; // The layer's colour for the held pitch, for GRADIENT_PITCH
 	obs_source_t *audio_source_obj = nullptr;
-	obs_source_t *parent_source = nullptr; // The source itself
+	obs_weak_source_t *tap_filter = nullptr; // Audio Tap on audio_source_obj we take audio from, if any
+	obs_source_t *parent_source = nullptr;    // The source itself
+
+	// Adaptive quality
+	float render_glow = 0.0f;                // The layer's glow_strength, or 0 when the governor turns glow off
+	gs_texrender_t *scaled_target = nullptr; // Target for a reduced render scale
+
+	// Layer being drawn, and this frame's draws in order
+	struct LayerDraw {
+		const VisualLayer *layer;
+		size_t start; // Batch vertices; none for the spectrogram
+		size_t count;
+	};
+	const VisualLayer *layer = nullptr;
+	std::vector<LayerDraw> layer_draws;
+
+	// Geometry rendering: every layer of a mode goes into one batch
+	gs_effect_t *geometry_effect = nullptr;
+	GeometryBatch batch;
+	PolylineTessellator tessellator;
+	std::vector<float> poly_x; // Curve points, reused every frame
+	std::vector<float> poly_y;
+	std::vector<uint32_t> poly_c;    // Gradient colour per curve point
+	std::vector<uint32_t> poly_glow; // Constant glow / end colour "gradients"
+	std::vector<uint32_t> poly_end;
+	uint32_t poly_glow_fill = 0; // Colours they are filled with
+	uint32_t poly_end_fill = 0;
+
+	// Spectrogram (GPU ring buffer, one row per band frame)
+	gs_effect_t *spectrogram_effect = nullptr;
+	gs_texture_t *spec_row_tex = nullptr; // Dynamic staging, the frames published since the last render
+	gs_texrender_t *spec_ring = nullptr;  // Persistent history, written a few rows at a time
+	bool spec_ring_cleared = false;
+	uint32_t spec_write_row = 0;
+	uint64_t spec_last_frame = 0;         // Next published frame to write
+
+	// Vectorscope (density grid added to a decaying trace once a video frame)
+	gs_effect_t *vectorscope_effect = nullptr;
+	gs_texture_t *scope_hits_tex = nullptr; // Dynamic staging, the rows the scope hit since the last frame
+	gs_texrender_t *scope_trace = nullptr;  // Persistent, decayed in the shader
+	bool scope_trace_cleared = false;
+	uint64_t scope_trace_start = 0; // scope_starts when the trace was last cleared
+	uint64_t scope_last_time = 0;   // Video frame the trace was last updated for
+
+	// Flight recorder / replay (under flight_mutex)
+	std::string record_key;     // Recording config, a change starts a new file
+	std::string replay_path;
+	std::string capture_key;
+	std::string publisher_name;
 
 	GlassLineSource(obs_source_t *source);
 	~GlassLineSource();
 
 	void Update(obs_data_t *settings);
+	void UpdateFlight(obs_data_t *settings);
+	void UpdateCapture(bool enabled, const std::string &dir);
+	void UpdatePublisher(bool enabled, const std::string &name);
+	uint64_t Now() const override;
+	void AnalysisFailed(size_t fft_size) override;
+	void LogLatency();
+	void ExportLatency();
+	void Govern();
+	void Tick(float seconds);
 	void Render(gs_effect_t *effect);
+	void RenderFrame();
+	void DrawLayers(float width, float height);
+	void RenderWaveform(float width, float height);
+	void UpdateSpectrogram(size_t start_bin, size_t num_bins);
+	void DrawSpectrogram(float width, float height, const char *technique);
+	void UpdateScope(float persistence_ms);
+	void DrawScope(float width, float height, const char *technique);
+	void RenderScope(float width, float height);
+	void RenderLines(size_t start_bin, size_t num_bins, float width, float height);
+	void RenderShapes(size_t start_bin, size_t num_bins, float width, float height);
+	void RenderLoudness(float width, float height);
+	void FillCurveColors();
+	void StrokePolyline(const float *x, const float *y, const uint32_t *colors, size_t count, float half_width,
+			    float feather);
+	uint32_t Shade(float position, float band, float level) const;
 	void AudioCallback(const struct audio_data *data);
 
 	// Helper to attach/detach audio source
 	void SetAudioSource(const char *name);
+	void TapRemoved(obs_source_t *filter);
 };
 
 extern struct obs_source_info glass_line_source;
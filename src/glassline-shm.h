@@ -0,0 +1,92 @@
+#pragma once
+
+/*
+ * Shared-memory spectrum feed
+ * GlassLine can publish every spectrum with its features into a named POSIX
+ * shared-memory object ("/" + the name set on the source). Other processes
+ * map it read-only and read frames without copies through the kernel.
+ * This header is plain C so readers don't need the plugin's sources.
+ *
+ * Layout (native endianness, every offset a multiple of 64):
+ *   [glshm_header, padded to header_size]
+ *   slot_count x [glshm_frame][float bands[max_bands]], each slot_size bytes
+ *
+ * Frame `index` lives in slot index % slot_count. Each slot is a seqlock:
+ * its sequence is odd while the writer fills it and 2 * (index + 1) once
+ * frame `index` is complete. A reader copies the slot between two reads of
+ * the sequence and keeps the copy only when both match the frame it wanted.
+ * write_index counts completed frames, so the latest is write_index - 1.
+ *
+ * Readers must check magic and version, and use header_size, slot_size and
+ * max_bands from the header rather than the compiled-in sizes.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GLSHM_MAGIC 0x4D534C47u /* "GLSM" */
+#define GLSHM_VERSION 1
+#define GLSHM_MAX_CHANNELS 8
+#define GLSHM_ALIGN 64
+
+/* Frame flags */
+#define GLSHM_FLAG_ONSET (1u << 0)
+#define GLSHM_FLAG_BEAT (1u << 1)
+
+/* Header states */
+#define GLSHM_STATE_CLOSED 0u
+#define GLSHM_STATE_LIVE 1u
+
+struct glshm_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t header_size; /* Offset of slot 0 */
+	uint32_t slot_size;   /* Bytes per slot, frame header included */
+	uint32_t slot_count;
+	uint32_t max_bands;   /* Room for bands in each slot */
+	uint32_t state;       /* GLSHM_STATE_*, atomic */
+	uint32_t writer_pid;  /* Process that publishes */
+	uint64_t created_ns;  /* Wall clock, ns since the Unix epoch */
+	uint64_t write_index; /* Completed frames, atomic */
+};
+
+struct glshm_frame {
+	uint64_t sequence;     /* Seqlock, atomic */
+	uint64_t index;        /* Frame number since the writer started */
+	uint64_t timestamp_ns; /* OBS audio time of the newest sample in the spectrum */
+	uint64_t publish_ns;   /* Time it was written, same clock */
+	uint32_t band_count;   /* Bands that follow, up to max_bands */
+	uint32_t channels;     /* Entries of rms/peak in use */
+	uint32_t flags;        /* GLSHM_FLAG_* */
+	float bin_hz;          /* Width of one band; band i is centred near i * bin_hz */
+	float rms[GLSHM_MAX_CHANNELS];
+	float peak[GLSHM_MAX_CHANNELS];
+	float centroid_hz;
+	float flux;
+	float onset;            /* Onset strength, 0 when none */
+	float tempo_bpm;        /* 0 while unknown */
+	float beat_phase;       /* 0 on a beat, rising to 1 at the next */
+	float pitch_hz;         /* Fundamental, 0 when none was found or pitch isn't tracked */
+	float pitch_confidence; /* 0 to 1 */
+	uint32_t reserved[1];
+	/* float bands[band_count] follows at offset sizeof(struct glshm_frame) */
+};
+
+/* Slot size for a band capacity */
+static inline uint32_t glshm_slot_size(uint32_t max_bands)
+{
+	uint32_t bytes = (uint32_t)sizeof(struct glshm_frame) + max_bands * (uint32_t)sizeof(float);
+	return (bytes + GLSHM_ALIGN - 1) / GLSHM_ALIGN * GLSHM_ALIGN;
+}
+
+static inline uint32_t glshm_header_size(void)
+{
+	return ((uint32_t)sizeof(struct glshm_header) + GLSHM_ALIGN - 1) / GLSHM_ALIGN * GLSHM_ALIGN;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,92 @@
+#include "goertzel-bank.hpp"
+#include "simd.hpp"
+#include <cmath>
+#include <cstring>
+
+// Relative cost per sample of one vector of four filters, and per point and
+// stage of the FFT with its window and magnitude pass. Measured with
+// glassline-replay --bands on SSE2; the crossover only needs to be roughly
+// right.
+#define GOERTZEL_VECTOR_COST 1.0
+#define FFT_POINT_COST 1.6
+
+size_t GoertzelBank::StorageCount(size_t bands)
+{
+	size_t padded = (bands + 3) & ~(size_t)3;
+	return padded * 3 + bands * 2;
+}
+
+bool GoertzelBank::Cheaper(size_t bands, size_t block, size_t fft_size)
+{
+	if (bands == 0 || block == 0 || block > fft_size)
+		return false;
+	size_t stages = 0;
+	while (((size_t)1 << stages) < fft_size)
+		stages++;
+	double bank = (double)((bands + 3) / 4) * (double)block * GOERTZEL_VECTOR_COST;
+	double fft = (double)fft_size * (double)stages * FFT_POINT_COST;
+	return bank < fft;
+}
+
+void GoertzelBank::Init(const float *frequencies, size_t count, float *storage)
+{
+	bands = count;
+	padded = (count + 3) & ~(size_t)3;
+	coeff = storage;
+	state = coeff + padded;
+	cosine = state + padded * 2;
+	sine = cosine + count;
+
+	for (size_t i = 0; i < padded; i++) {
+		double w = i < count ? 2.0 * M_PI * (double)frequencies[i] : 0.0;
+		coeff[i] = (float)(2.0 * cos(w));
+		if (i < count) {
+			cosine[i] = (float)cos(w);
+			sine[i] = (float)sin(w);
+		}
+	}
+}
+
+// s[i] = x[i] + 2 cos(w) s[i-1] - s[i-2] for G vectors of filters at once
+template<int G> static void run_vectors(const float *x, size_t n, const float *coeff, float *s1_out, float *s2_out)
+{
+	simd::float4 c[G], s1[G], s2[G];
+	for (int g = 0; g < G; g++) {
+		c[g] = simd::load(coeff + 4 * g);
+		s1[g] = simd::set1(0.0f);
+		s2[g] = simd::set1(0.0f);
+	}
+	for (size_t i = 0; i < n; i++) {
+		simd::float4 in = simd::set1(x[i]);
+		for (int g = 0; g < G; g++) {
+			simd::float4 s0 = simd::madd(c[g], s1[g], simd::sub(in, s2[g]));
+			s2[g] = s1[g];
+			s1[g] = s0;
+		}
+	}
+	for (int g = 0; g < G; g++) {
+		simd::store(s1_out + 4 * g, s1[g]);
+		simd::store(s2_out + 4 * g, s2[g]);
+	}
+}
+
+void GoertzelBank::Run(const float *samples, size_t n, float *re, float *im) const
+{
+	float *s1 = state;
+	float *s2 = state + padded;
+
+	// Four vectors per pass keeps enough independent work in flight
+	size_t v = 0;
+	const size_t vectors = padded / 4;
+	for (; v + 4 <= vectors; v += 4)
+		run_vectors<4>(samples, n, coeff + 4 * v, s1 + 4 * v, s2 + 4 * v);
+	for (; v + 2 <= vectors; v += 2)
+		run_vectors<2>(samples, n, coeff + 4 * v, s1 + 4 * v, s2 + 4 * v);
+	for (; v < vectors; v++)
+		run_vectors<1>(samples, n, coeff + 4 * v, s1 + 4 * v, s2 + 4 * v);
+
+	for (size_t i = 0; i < bands; i++) {
+		re[i] = s1[i] - cosine[i] * s2[i];
+		im[i] = sine[i] * s2[i];
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+
+// Goertzel filter bank
+// Evaluates the DFT of a windowed block at a few chosen frequencies only,
+// for when so few bands are shown that most of an FFT would be thrown away.
+// Filters run four to a SIMD vector and several vectors share each pass over
+// the samples, so their recurrences overlap instead of waiting on each other.
+// Coefficients live in caller-provided storage (the analysis arena).
+
+class GoertzelBank {
+public:
+	// Floats of storage for `bands` filters
+	static size_t StorageCount(size_t bands);
+
+	// True when `bands` filters over `block` samples cost less than a
+	// `fft_size`-point FFT plus its magnitude pass
+	static bool Cheaper(size_t bands, size_t block, size_t fft_size);
+
+	// `frequencies` in cycles per sample, 0 to 0.5
+	void Init(const float *frequencies, size_t count, float *storage);
+
+	size_t Bands() const { return bands; }
+
+	// DFT of samples[0, n) at each band's frequency. The magnitude is that
+	// of the DFT; the phase is not.
+	void Run(const float *samples, size_t n, float *re, float *im) const;
+
+private:
+	size_t bands = 0;
+	size_t padded = 0;        // bands rounded up to whole vectors
+	float *coeff = nullptr;   // 2 cos(w), padded
+	float *cosine = nullptr;  // cos(w)
+	float *sine = nullptr;    // sin(w)
+	float *state = nullptr;   // Final s[n-1], s[n-2] of each filter, padded
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Two-colour gradient lookup table
+// Built once per settings change from two packed 8-bit colours (any channel
+// order, the channels are blended independently) so per-vertex shading is a
+// table lookup. At(t) takes t in [0, 1], values outside are clamped.
+
+#define GRADIENT_LUT_SIZE 256
+
+// What a vertex's place on the gradient follows
+enum GradientMode {
+	GRADIENT_SOLID = 0,     // Start colour only
+	GRADIENT_POSITION = 1,  // Left to right across the output
+	GRADIENT_BAND = 2,      // Low to high frequency
+	GRADIENT_AMPLITUDE = 3, // Quiet to loud
+	GRADIENT_PITCH = 4,     // Hue by the pitch class of the tracked note, not the gradient
+};
+
+class GradientLUT {
+public:
+	void Build(uint32_t start, uint32_t end)
+	{
+		for (size_t i = 0; i < GRADIENT_LUT_SIZE; i++) {
+			uint32_t t = (uint32_t)(i * 256 / (GRADIENT_LUT_SIZE - 1)); // 0..256
+			uint32_t packed = 0;
+			for (int shift = 0; shift < 32; shift += 8) {
+				uint32_t a = (start >> shift) & 0xFF;
+				uint32_t b = (end >> shift) & 0xFF;
+				uint32_t c = (a * (256 - t) + b * t + 128) >> 8;
+				packed |= (c > 255 ? 255 : c) << shift;
+			}
+			table[i] = packed;
+		}
+	}
+
+	// Same colour everywhere
+	void Fill(uint32_t color)
+	{
+		for (size_t i = 0; i < GRADIENT_LUT_SIZE; i++)
+			table[i] = color;
+	}
+
+	uint32_t At(float t) const
+	{
+		if (!(t > 0.0f))
+			return table[0];
+		if (t >= 1.0f)
+			return table[GRADIENT_LUT_SIZE - 1];
+		return table[(size_t)(t * (float)(GRADIENT_LUT_SIZE - 1) + 0.5f)];
+	}
+
+private:
+	uint32_t table[GRADIENT_LUT_SIZE] = {};
+};
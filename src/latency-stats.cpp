@@ -0,0 +1,122 @@
+#include "latency-stats.hpp"
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+static const char *stage_names[LATENCY_STAGES] = {"capture", "analysis", "pickup", "total"};
+
+static int64_t stage_ns(const LatencyRecord &r, int stage)
+{
+	switch (stage) {
+	case LATENCY_CAPTURE:
+		return (int64_t)(r.arrival - r.audio_time);
+	case LATENCY_ANALYSIS:
+		return (int64_t)(r.analyzed - r.arrival);
+	case LATENCY_PICKUP:
+		return (int64_t)(r.rendered - r.analyzed);
+	default:
+		return (int64_t)(r.rendered - r.audio_time);
+	}
+}
+
+void LatencyHistogram::Reset()
+{
+	memset(counts, 0, sizeof(counts));
+	count = 0;
+	sum_ms = 0.0;
+	min_ms = 0.0;
+	max_ms = 0.0;
+}
+
+void LatencyHistogram::Add(int64_t ns)
+{
+	double ms = (double)ns / 1e6;
+	// Negative values (clock skew between callbacks) land in the first bucket
+	size_t bucket = ms > 0.0 ? (size_t)(ms / BUCKET_MS) : 0;
+	counts[bucket < BUCKETS ? bucket : BUCKETS]++;
+
+	if (count == 0 || ms < min_ms)
+		min_ms = ms;
+	if (count == 0 || ms > max_ms)
+		max_ms = ms;
+	sum_ms += ms;
+	count++;
+}
+
+double LatencyHistogram::PercentileMs(double p) const
+{
+	if (count == 0)
+		return 0.0;
+	uint64_t target = (uint64_t)(p * (double)count);
+	if (target >= count)
+		target = count - 1;
+
+	uint64_t seen = 0;
+	for (size_t i = 0; i < BUCKETS; i++) {
+		seen += counts[i];
+		if (seen > target) {
+			double ms = ((double)i + 0.5) * BUCKET_MS;
+			return ms < min_ms ? min_ms : ms > max_ms ? max_ms : ms;
+		}
+	}
+	return max_ms; // In the overflow bucket
+}
+
+void LatencyStats::Configure(size_t keep)
+{
+	recent.assign(keep, LatencyRecord{});
+	Reset();
+}
+
+void LatencyStats::Reset()
+{
+	for (LatencyHistogram &stage : stages)
+		stage.Reset();
+	skipped = 0;
+	added = 0;
+}
+
+void LatencyStats::Add(const LatencyRecord &record)
+{
+	for (int s = 0; s < LATENCY_STAGES; s++)
+		stages[s].Add(stage_ns(record, s));
+	if (!recent.empty())
+		recent[(size_t)(added % recent.size())] = record;
+	added++;
+}
+
+void LatencyStats::Format(char *out, size_t size) const
+{
+	size_t used = 0;
+	out[0] = '\0';
+	for (int s = 0; s < LATENCY_STAGES && used < size; s++) {
+		const LatencyHistogram &h = stages[s];
+		int written = snprintf(out + used, size - used,
+				       "%-8s  mean %7.2f ms  p50 %6.1f  p95 %6.1f  p99 %6.1f  min %7.2f  max %7.2f\n",
+				       stage_names[s], h.MeanMs(), h.PercentileMs(0.5), h.PercentileMs(0.95),
+				       h.PercentileMs(0.99), h.MinMs(), h.MaxMs());
+		if (written < 0)
+			break;
+		used += (size_t)written;
+	}
+	if (used < size)
+		snprintf(out + used, size - used, "%" PRIu64 " spectra drawn, %" PRIu64 " never drawn",
+			 stages[LATENCY_TOTAL].Count(), skipped);
+}
+
+bool LatencyStats::WriteCsv(const char *path) const
+{
+	FILE *file = fopen(path, "w");
+	if (!file)
+		return false;
+
+	fprintf(file, "audio_time_ns,capture_ms,analysis_ms,pickup_ms,total_ms\n");
+	size_t kept = added < recent.size() ? (size_t)added : recent.size();
+	for (size_t i = 0; i < kept; i++) {
+		const LatencyRecord &r = recent[(size_t)((added - kept + i) % recent.size())];
+		fprintf(file, "%" PRIu64 ",%.3f,%.3f,%.3f,%.3f\n", r.audio_time, (double)stage_ns(r, LATENCY_CAPTURE) / 1e6,
+			(double)stage_ns(r, LATENCY_ANALYSIS) / 1e6, (double)stage_ns(r, LATENCY_PICKUP) / 1e6,
+			(double)stage_ns(r, LATENCY_TOTAL) / 1e6);
+	}
+	return fclose(file) == 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Audio-to-screen latency of published spectra
+// Each spectrum carries the OBS timestamp of its newest sample. Three more
+// times are taken on its way to the screen: when the audio callback that
+// completed it arrived, when that callback's analysis finished, and the
+// video frame time at which it was first drawn. The differences split the
+// total into capture (OBS audio buffering and block size), analysis, and
+// pickup (playout delay plus the wait for the next video frame).
+//
+// Histograms cover everything since the last Reset(); the latest records
+// are also kept for export. Add() never allocates. No OBS dependencies.
+
+enum LatencyStage {
+	LATENCY_CAPTURE,
+	LATENCY_ANALYSIS,
+	LATENCY_PICKUP,
+	LATENCY_TOTAL,
+	LATENCY_STAGES,
+};
+
+struct LatencyRecord {
+	uint64_t audio_time; // Newest sample in the spectrum
+	uint64_t arrival;    // Audio callback that completed it reached the source
+	uint64_t analyzed;   // That callback's analysis finished
+	uint64_t rendered;   // Video frame time it was first drawn at
+};
+
+class LatencyHistogram {
+public:
+	static const size_t BUCKETS = 1000;      // Plus one for everything beyond
+	static constexpr double BUCKET_MS = 0.5; // 0 - 500 ms at 0.5 ms resolution
+
+	void Reset();
+	void Add(int64_t ns);
+
+	uint64_t Count() const { return count; }
+	double MeanMs() const { return count ? sum_ms / (double)count : 0.0; }
+	double MinMs() const { return count ? min_ms : 0.0; }
+	double MaxMs() const { return count ? max_ms : 0.0; }
+	// Middle of the bucket holding the p-th fraction (0 - 1) of samples
+	double PercentileMs(double p) const;
+
+private:
+	uint32_t counts[BUCKETS + 1] = {};
+	uint64_t count = 0;
+	double sum_ms = 0.0;
+	double min_ms = 0.0;
+	double max_ms = 0.0;
+};
+
+class LatencyStats {
+public:
+	// Allocates room for the latest `keep` records
+	void Configure(size_t keep);
+	void Reset();
+
+	void Add(const LatencyRecord &record);
+	// Spectra replaced before any frame drew them
+	void AddSkipped(uint64_t count) { skipped += count; }
+
+	const LatencyHistogram &Stage(LatencyStage stage) const { return stages[stage]; }
+	uint64_t Skipped() const { return skipped; }
+
+	// One line per stage: count, mean, percentiles, extremes
+	void Format(char *out, size_t size) const;
+	// The kept records, oldest first, with the per-stage latencies in ms
+	bool WriteCsv(const char *path) const;
+
+private:
+	LatencyHistogram stages[LATENCY_STAGES];
+	uint64_t skipped = 0;
+	std::vector<LatencyRecord> recent; // Ring of the latest records
+	uint64_t added = 0;
+};
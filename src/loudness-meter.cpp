@@ -0,0 +1,266 @@
+#include "loudness-meter.hpp"
+#include "simd.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#define ABSOLUTE_GATE -70.0f
+#define RELATIVE_GATE -10.0f
+
+static float to_lufs(double energy)
+{
+	return energy > 0.0 ? (float)(-0.691 + 10.0 * log10(energy)) : -INFINITY;
+}
+
+static float to_dbtp(float peak)
+{
+	return peak > 0.0f ? 20.0f * log10f(peak) : -INFINITY;
+}
+
+// K-weighting stages from their analog prototypes (BS.1770 gives the
+// coefficients at 48 kHz only), bilinear transformed for `rate`
+static void shelf_coefficients(double rate, float *c)
+{
+	const double f0 = 1681.974450955533;
+	const double gain_db = 3.999843853973347;
+	const double q = 0.7071752369554196;
+	double k = tan(M_PI * f0 / rate);
+	double vh = pow(10.0, gain_db / 20.0);
+	double vb = pow(vh, 0.4996667741545416);
+	double a0 = 1.0 + k / q + k * k;
+	c[0] = (float)((vh + vb * k / q + k * k) / a0);
+	c[1] = (float)(2.0 * (k * k - vh) / a0);
+	c[2] = (float)((vh - vb * k / q + k * k) / a0);
+	c[3] = (float)(2.0 * (k * k - 1.0) / a0);
+	c[4] = (float)((1.0 - k / q + k * k) / a0);
+}
+
+static void highpass_coefficients(double rate, float *c)
+{
+	const double f0 = 38.13547087602444;
+	const double q = 0.5003270373238773;
+	double k = tan(M_PI * f0 / rate);
+	double a0 = 1.0 + k / q + k * k;
+	c[0] = 1.0f;
+	c[1] = -2.0f;
+	c[2] = 1.0f;
+	c[3] = (float)(2.0 * (k * k - 1.0) / a0);
+	c[4] = (float)((1.0 - k / q + k * k) / a0);
+}
+
+// Surround channels count 1.41 (+1.5 dB) and the LFE not at all, in OBS's
+// channel order for each layout
+static void channel_weights(size_t channels, float *weight)
+{
+	for (size_t c = 0; c < LOUDNESS_MAX_CHANNELS; c++)
+		weight[c] = c < channels ? 1.0f : 0.0f;
+	switch (channels) {
+	case 3: // 2.1
+		weight[2] = 0.0f;
+		break;
+	case 4: // 4.0
+		weight[3] = 1.41f;
+		break;
+	case 5: // 4.1
+		weight[3] = 0.0f;
+		weight[4] = 1.41f;
+		break;
+	case 6: // 5.1
+	case 8: // 7.1
+		weight[3] = 0.0f;
+		for (size_t c = 4; c < channels; c++)
+			weight[c] = 1.41f;
+		break;
+	}
+}
+
+void LoudnessMeter::Configure(float sample_rate, size_t channel_count)
+{
+	rate = sample_rate;
+	channels = std::min(channel_count, (size_t)LOUDNESS_MAX_CHANNELS);
+	block_frames = std::max((size_t)1, (size_t)lroundf(sample_rate * 0.1f));
+	shelf_coefficients(sample_rate, shelf);
+	highpass_coefficients(sample_rate, highpass);
+	channel_weights(channels, weight);
+
+	// Hann-windowed sinc for 4x interpolation, centred between taps 23 and
+	// 24; each phase is normalised so a constant passes at unit gain
+	const int taps = 4 * LOUDNESS_TRUE_PEAK_TAPS;
+	const double centre = (taps - 1) * 0.5;
+	for (int p = 0; p < 4; p++) {
+		double sum = 0.0;
+		for (int j = 0; j < LOUDNESS_TRUE_PEAK_TAPS; j++) {
+			int k = 4 * j + p;
+			double t = ((double)k - centre) / 4.0;
+			double sinc = sin(M_PI * t) / (M_PI * t);
+			double window = 0.5 - 0.5 * cos(2.0 * M_PI * ((double)k + 0.5) / (double)taps);
+			phase_taps[p][j] = (float)(sinc * window);
+			sum += sinc * window;
+		}
+		for (int j = 0; j < LOUDNESS_TRUE_PEAK_TAPS; j++)
+			phase_taps[p][j] = (float)(phase_taps[p][j] / sum);
+	}
+
+	Reset();
+}
+
+void LoudnessMeter::Reset()
+{
+	memset(state, 0, sizeof(state));
+	memset(delay, 0, sizeof(delay));
+	memset(sum_sq, 0, sizeof(sum_sq));
+	memset(peak, 0, sizeof(peak));
+	memset(energy, 0, sizeof(energy));
+	memset(gate_count, 0, sizeof(gate_count));
+	memset(gate_energy, 0, sizeof(gate_energy));
+	delay_pos = 0;
+	frames_left = block_frames;
+	blocks = 0;
+	gated_blocks = 0;
+	gated_energy = 0.0;
+	current = {-INFINITY, -INFINITY, -INFINITY};
+	integrated = -INFINITY;
+	true_peak_max = -INFINITY;
+}
+
+// One stage of a transposed direct form II biquad, four channels at a time
+static inline simd::float4 biquad(simd::float4 x, const simd::float4 *c, simd::float4 &z1, simd::float4 &z2)
+{
+	simd::float4 y = simd::madd(c[0], x, z1);
+	z1 = simd::sub(simd::madd(c[1], x, z2), simd::mul(c[3], y));
+	z2 = simd::sub(simd::mul(c[2], x), simd::mul(c[4], y));
+	return y;
+}
+
+static inline simd::float4 abs4(simd::float4 x)
+{
+	return simd::max(x, simd::sub(simd::set1(0.0f), x));
+}
+
+void LoudnessMeter::Filter(size_t vector, const float *const *planes, size_t lanes, size_t from, size_t count)
+{
+	const size_t base = vector * 4;
+	simd::float4 sc[5], hc[5];
+	for (int i = 0; i < 5; i++) {
+		sc[i] = simd::set1(shelf[i]);
+		hc[i] = simd::set1(highpass[i]);
+	}
+	simd::float4 s1 = simd::load(state[0] + base), s2 = simd::load(state[1] + base);
+	simd::float4 h1 = simd::load(state[2] + base), h2 = simd::load(state[3] + base);
+	simd::float4 sum = simd::set1(0.0f);
+	simd::float4 top = simd::load(peak + base);
+	float (*line)[4] = delay[vector];
+	size_t pos = delay_pos;
+
+	float in[4] = {};
+	for (size_t i = from; i < from + count; i++) {
+		for (size_t l = 0; l < lanes; l++)
+			in[l] = planes[base + l][i];
+		simd::float4 x = simd::load(in);
+
+		simd::float4 y = biquad(biquad(x, sc, s1, s2), hc, h1, h2);
+		sum = simd::madd(y, y, sum);
+
+		// line[pos + j] is x[i - j]
+		pos = pos == 0 ? LOUDNESS_TRUE_PEAK_TAPS - 1 : pos - 1;
+		simd::store(line[pos], x);
+		simd::store(line[pos + LOUDNESS_TRUE_PEAK_TAPS], x);
+
+		// The four phases as independent sums, each tap loaded once
+		simd::float4 acc[4];
+		for (int p = 0; p < 4; p++)
+			acc[p] = simd::set1(0.0f);
+		for (int j = 0; j < LOUDNESS_TRUE_PEAK_TAPS; j++) {
+			simd::float4 tap = simd::load(line[pos + j]);
+			for (int p = 0; p < 4; p++)
+				acc[p] = simd::madd(simd::set1(phase_taps[p][j]), tap, acc[p]);
+		}
+		top = simd::max(top, abs4(x));
+		for (int p = 0; p < 4; p++)
+			top = simd::max(top, abs4(acc[p]));
+	}
+
+	simd::store(state[0] + base, s1);
+	simd::store(state[1] + base, s2);
+	simd::store(state[2] + base, h1);
+	simd::store(state[3] + base, h2);
+	simd::store(peak + base, top);
+	float block_sum[4];
+	simd::store(block_sum, sum);
+	for (size_t l = 0; l < 4; l++)
+		sum_sq[base + l] += block_sum[l];
+}
+
+void LoudnessMeter::Process(const float *const *planes, size_t channel_count, size_t frames)
+{
+	if (!block_frames || channel_count < channels)
+		return;
+
+	const size_t vectors = (channels + 3) / 4;
+	size_t done = 0;
+	while (done < frames) {
+		size_t count = std::min(frames - done, frames_left);
+		for (size_t v = 0; v < vectors; v++)
+			Filter(v, planes, std::min((size_t)4, channels - v * 4), done, count);
+		delay_pos = (delay_pos + LOUDNESS_TRUE_PEAK_TAPS - count % LOUDNESS_TRUE_PEAK_TAPS) %
+			    LOUDNESS_TRUE_PEAK_TAPS;
+		done += count;
+		frames_left -= count;
+		if (!frames_left) {
+			FinishBlock();
+			frames_left = block_frames;
+		}
+	}
+}
+
+void LoudnessMeter::FinishBlock()
+{
+	double e = 0.0;
+	float block_peak = 0.0f;
+	for (size_t c = 0; c < channels; c++) {
+		e += (double)weight[c] * (double)sum_sq[c];
+		block_peak = std::max(block_peak, peak[c]);
+		sum_sq[c] = 0.0f;
+		peak[c] = 0.0f;
+	}
+	energy[blocks % 30] = e / (double)block_frames;
+	blocks++;
+
+	double momentary = 0.0, short_term = 0.0;
+	for (uint64_t i = 0; i < 30 && i < blocks; i++) {
+		double b = energy[(blocks - 1 - i) % 30];
+		if (i < 4)
+			momentary += b;
+		short_term += b;
+	}
+	momentary /= 4.0;
+	short_term /= 30.0;
+
+	current.momentary = blocks >= 4 ? to_lufs(momentary) : -INFINITY;
+	current.short_term = blocks >= 30 ? to_lufs(short_term) : -INFINITY;
+	current.true_peak = to_dbtp(block_peak);
+	history[(blocks - 1) % LOUDNESS_HISTORY] = current;
+	if (current.true_peak > true_peak_max)
+		true_peak_max = current.true_peak;
+
+	// Each momentary window is a gating block; they overlap by 75%
+	if (blocks < 4 || current.momentary <= ABSOLUTE_GATE)
+		return;
+	int bin = (int)((current.momentary - ABSOLUTE_GATE) * 10.0f);
+	bin = std::min(std::max(bin, 0), LOUDNESS_HISTOGRAM - 1);
+	gate_count[bin]++;
+	gate_energy[bin] += momentary;
+	gated_blocks++;
+	gated_energy += momentary;
+
+	float threshold = to_lufs(gated_energy / (double)gated_blocks) + RELATIVE_GATE;
+	int first = (int)ceilf((threshold - ABSOLUTE_GATE) * 10.0f);
+	first = std::min(std::max(first, 0), LOUDNESS_HISTOGRAM);
+	uint64_t count = 0;
+	double sum = 0.0;
+	for (int i = first; i < LOUDNESS_HISTOGRAM; i++) {
+		count += gate_count[i];
+		sum += gate_energy[i];
+	}
+	integrated = count ? to_lufs(sum / (double)count) : -INFINITY;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// ITU-R BS.1770 / EBU R128 loudness
+// Every channel goes through the K-weighting filters (high shelf, then the
+// RLB high-pass), four channels to a SIMD vector. Weighted mean squares are
+// summed into 100 ms blocks; momentary loudness is the mean of the last 4
+// blocks (400 ms), short-term that of the last 30 (3 s). Each momentary
+// value, every 100 ms, is a gating block for the integrated loudness:
+// blocks under -70 LUFS are dropped, then those 10 LU under the mean of the
+// rest. The gate works on a 0.1 LU histogram, so each block costs the same
+// however long the programme runs. True peak is the largest sample of a 4x
+// polyphase interpolation, as in BS.1770 Annex 2.
+//
+// Holds no heap memory and never allocates. No OBS dependencies.
+
+#define LOUDNESS_MAX_CHANNELS 8
+#define LOUDNESS_HISTORY 600       // Blocks kept for the history view (60 s)
+#define LOUDNESS_HISTOGRAM 800     // 0.1 LU bins from -70 to +10 LUFS
+#define LOUDNESS_TRUE_PEAK_TAPS 12 // Per phase
+
+// Loudness of one 100 ms block. -inf (LUFS or dBTP) means silence, or not
+// enough audio yet for the window.
+struct LoudnessBlock {
+	float momentary;  // LUFS over the last 400 ms
+	float short_term; // LUFS over the last 3 s
+	float true_peak;  // dBTP within this block
+};
+
+class LoudnessMeter {
+public:
+	// Builds the filters for the rate and OBS speaker layout (by channel
+	// count) and starts over
+	void Configure(float sample_rate, size_t channels);
+	void Reset();
+
+	// Planar samples of `channels` channels
+	void Process(const float *const *planes, size_t channels, size_t frames);
+
+	float SampleRate() const { return rate; }
+	size_t Channels() const { return channels; }
+
+	float Momentary() const { return current.momentary; }
+	float ShortTerm() const { return current.short_term; }
+	float Integrated() const { return integrated; } // Gated, since the last reset
+	float TruePeak() const { return true_peak_max; } // dBTP, since the last reset
+
+	// Finished 100 ms blocks are numbered from 0 since the last reset; the
+	// last LOUDNESS_HISTORY of them, [OldestBlock(), Blocks()), can be read
+	uint64_t Blocks() const { return blocks; }
+	uint64_t OldestBlock() const { return blocks > LOUDNESS_HISTORY ? blocks - LOUDNESS_HISTORY : 0; }
+	const LoudnessBlock &Block(uint64_t index) const { return history[index % LOUDNESS_HISTORY]; }
+
+private:
+	void Filter(size_t vector, const float *const *planes, size_t lanes, size_t from, size_t count);
+	void FinishBlock();
+
+	float rate = 0.0f;
+	size_t channels = 0;
+	size_t block_frames = 0; // Frames per 100 ms block
+	size_t frames_left = 0;  // Until the current block is complete
+
+	// K-weighting, shared by all channels; state per channel
+	float shelf[5] = {}; // b0, b1, b2, a1, a2
+	float highpass[5] = {};
+	float state[4][LOUDNESS_MAX_CHANNELS] = {}; // Shelf z1, z2, high-pass z1, z2
+	float weight[LOUDNESS_MAX_CHANNELS] = {};   // Channel weighting, 0 for LFE
+
+	// True peak: phase p of the interpolator, tap j, applies to x[n - j]
+	float phase_taps[4][LOUDNESS_TRUE_PEAK_TAPS] = {};
+	float delay[LOUDNESS_MAX_CHANNELS / 4][LOUDNESS_TRUE_PEAK_TAPS * 2][4] = {}; // Written twice, read straight
+	size_t delay_pos = 0;
+
+	// Current block, per channel
+	float sum_sq[LOUDNESS_MAX_CHANNELS] = {};
+	float peak[LOUDNESS_MAX_CHANNELS] = {};
+
+	double energy[30] = {}; // Weighted mean square of the last 30 blocks
+	uint64_t blocks = 0;
+	LoudnessBlock current = {};
+	LoudnessBlock history[LOUDNESS_HISTORY] = {};
+
+	// Gating blocks above the absolute gate, by loudness
+	uint32_t gate_count[LOUDNESS_HISTOGRAM] = {};
+	double gate_energy[LOUDNESS_HISTOGRAM] = {};
+	uint64_t gated_blocks = 0;
+	double gated_energy = 0.0;
+	float integrated = 0.0f;
+	float true_peak_max = 0.0f;
+};
@@ -0,0 +1,248 @@
+#include "mapped-file.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// MappedFile
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char *path, bool write)
+{
+	Close();
+	writable = write;
+
+	int len = MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+	std::wstring wpath(len, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, path, -1, &wpath[0], len);
+
+	HANDLE h = CreateFileW(wpath.c_str(), write ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ,
+			       nullptr, write ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (h == INVALID_HANDLE_VALUE)
+		return false;
+	file = h;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (file) {
+		CloseHandle((HANDLE)file);
+		file = nullptr;
+	}
+}
+
+bool MappedFile::Resize(uint64_t size)
+{
+	LARGE_INTEGER pos;
+	pos.QuadPart = (LONGLONG)size;
+	return SetFilePointerEx((HANDLE)file, pos, nullptr, FILE_BEGIN) && SetEndOfFile((HANDLE)file);
+}
+
+bool MappedFile::Allocate(uint64_t offset, uint64_t size)
+{
+	// SetEndOfFile() allocates the clusters, as NTFS files aren't sparse
+	// unless marked so. SetFileValidData() is left out: it needs
+	// SE_MANAGE_VOLUME_NAME and would expose stale disk contents where the
+	// segments must read as zeros. Prefaulting has the zero-filling done
+	// ahead of the writer instead.
+	return Resize(offset + size);
+}
+
+uint64_t MappedFile::Size() const
+{
+	LARGE_INTEGER size;
+	if (!file || !GetFileSizeEx((HANDLE)file, &size))
+		return 0;
+	return (uint64_t)size.QuadPart;
+}
+
+void *MappedFile::Map(uint64_t offset, size_t size)
+{
+	uint64_t end = offset + size;
+	HANDLE mapping = CreateFileMappingW((HANDLE)file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY,
+					    (DWORD)(end >> 32), (DWORD)end, nullptr);
+	if (!mapping)
+		return nullptr;
+	void *ptr = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, (DWORD)(offset >> 32),
+				  (DWORD)offset, size);
+	CloseHandle(mapping); // The view keeps the mapping alive
+	return ptr;
+}
+
+void MappedFile::Unmap(void *ptr, size_t size)
+{
+	(void)size;
+	if (ptr)
+		UnmapViewOfFile(ptr);
+}
+
+#else
+
+bool MappedFile::Open(const char *path, bool write)
+{
+	Close();
+	writable = write;
+	fd = write ? open(path, O_RDWR | O_CREAT | O_TRUNC, 0644) : open(path, O_RDONLY);
+	return fd >= 0;
+}
+
+void MappedFile::Close()
+{
+	if (fd >= 0) {
+		close(fd);
+		fd = -1;
+	}
+}
+
+bool MappedFile::Resize(uint64_t size)
+{
+	return ftruncate(fd, (off_t)size) == 0;
+}
+
+bool MappedFile::Allocate(uint64_t offset, uint64_t size)
+{
+#ifdef __APPLE__
+	// No posix_fallocate(); reserve the blocks (best effort), then extend
+	fstore_t store = {F_ALLOCATEALL, F_PEOFPOSMODE, 0, (off_t)size, 0};
+	fcntl(fd, F_PREALLOCATE, &store);
+	return Resize(offset + size);
+#else
+	int err = posix_fallocate(fd, (off_t)offset, (off_t)size);
+	if (err == 0)
+		return true;
+	// Filesystems that can't allocate ahead still get the file extended
+	return (err == EINVAL || err == EOPNOTSUPP) && Resize(offset + size);
+#endif
+}
+
+uint64_t MappedFile::Size() const
+{
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0)
+		return 0;
+	return (uint64_t)st.st_size;
+}
+
+void *MappedFile::Map(uint64_t offset, size_t size)
+{
+	void *ptr = mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, (off_t)offset);
+	return ptr == MAP_FAILED ? nullptr : ptr;
+}
+
+void MappedFile::Unmap(void *ptr, size_t size)
+{
+	if (ptr)
+		munmap(ptr, size);
+}
+
+#endif
+
+// SegmentWriter
+
+bool SegmentWriter::Open(const char *new_path, size_t new_segment_size)
+{
+	Close(0);
+
+	if (!file.Open(new_path, true))
+		return false;
+
+	path = new_path;
+	segment_size = mapped_align_up(new_segment_size, MAPPED_SEGMENT_ALIGN);
+
+	if (!file.Resize(MAPPED_SEGMENT_ALIGN) || !(header = (uint8_t *)file.Map(0, MAPPED_SEGMENT_ALIGN))) {
+		file.Close();
+		return false;
+	}
+	next_offset = MAPPED_SEGMENT_ALIGN;
+
+	// First segment is live straight away, the second one is mapped ahead
+	current = MapSegment();
+	if (!current) {
+		Close(0);
+		return false;
+	}
+	next.store(MapSegment(), std::memory_order_release);
+	return true;
+}
+
+SegmentWriter::Segment *SegmentWriter::MapSegment()
+{
+	uint64_t offset = next_offset;
+	if (!file.Allocate(offset, segment_size))
+		return nullptr;
+
+	uint8_t *base = (uint8_t *)file.Map(offset, segment_size);
+	if (!base)
+		return nullptr;
+
+	// Fault every page in now rather than on the writer thread. The pages
+	// are zero already, so writing a zero leaves the contents alone while
+	// making them writable straight away.
+	for (size_t i = 0; i < segment_size; i += MAPPED_PAGE_SIZE)
+		((volatile uint8_t *)base)[i] = 0;
+
+	next_offset += segment_size;
+	return new Segment{base, offset};
+}
+
+void SegmentWriter::ReleaseSegment(Segment *segment)
+{
+	if (!segment)
+		return;
+	MappedFile::Unmap(segment->base, segment_size);
+	delete segment;
+}
+
+bool SegmentWriter::Advance()
+{
+	// The previous full segment has to be reclaimed first
+	if (!current || retired.load(std::memory_order_acquire))
+		return false;
+
+	Segment *ready = next.exchange(nullptr, std::memory_order_acquire);
+	if (!ready)
+		return false;
+
+	retired.store(current, std::memory_order_release);
+	current = ready;
+	return true;
+}
+
+void SegmentWriter::Maintain()
+{
+	if (!current)
+		return;
+
+	ReleaseSegment(retired.exchange(nullptr, std::memory_order_acq_rel));
+
+	if (!next.load(std::memory_order_acquire))
+		next.store(MapSegment(), std::memory_order_release);
+}
+
+void SegmentWriter::Close(size_t used)
+{
+	uint64_t end = current ? current->offset + used : 0;
+
+	ReleaseSegment(current);
+	ReleaseSegment(next.exchange(nullptr));
+	ReleaseSegment(retired.exchange(nullptr));
+	current = nullptr;
+
+	if (header) {
+		MappedFile::Unmap(header, MAPPED_SEGMENT_ALIGN);
+		header = nullptr;
+	}
+
+	if (end)
+		file.Resize(end);
+	file.Close();
+}
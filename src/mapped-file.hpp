@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Memory-mapped file helpers shared by the on-disk recorders
+
+#define MAPPED_SEGMENT_ALIGN 65536 // Mapping granularity on every platform we ship
+#define MAPPED_PAGE_SIZE 4096      // Smallest page size we ship on, for prefaulting
+
+static inline size_t mapped_align_up(size_t value, size_t align)
+{
+	return (value + align - 1) / align * align;
+}
+
+// Platform file mapping (mmap / MapViewOfFile)
+class MappedFile {
+public:
+	~MappedFile() { Close(); }
+
+	bool Open(const char *path, bool writable);
+	void Close();
+	bool Resize(uint64_t size);
+	// Grows the file to offset + size with disk blocks behind it, unlike the
+	// sparse extension of Resize(); false when the disk is full
+	bool Allocate(uint64_t offset, uint64_t size);
+	uint64_t Size() const;
+	void *Map(uint64_t offset, size_t size);
+	static void Unmap(void *ptr, size_t size);
+
+private:
+	bool writable = false;
+#ifdef _WIN32
+	void *file = nullptr;
+#else
+	int fd = -1;
+#endif
+};
+
+// Append-only file written through fixed-size mapped segments
+// The file starts with a MAPPED_SEGMENT_ALIGN header region, followed by
+// segments of segment_size bytes. The segment after the current one is
+// allocated on disk, mapped and prefaulted ahead of time by Maintain(), so
+// the writer thread moves on with Advance() without making a syscall or
+// taking a page fault that waits on the disk.
+class SegmentWriter {
+public:
+	~SegmentWriter() { Close(0); }
+
+	bool Open(const char *path, size_t segment_size);
+
+	// Writers must have stopped. The file is cut after `used` bytes of the
+	// current segment, dropping the preallocated tail.
+	void Close(size_t used);
+
+	bool IsOpen() const { return current != nullptr; }
+	size_t SegmentSize() const { return segment_size; }
+	uint8_t *Header() const { return header; }
+
+	// Writer thread: zero-filled memory of the current segment
+	uint8_t *Current() const { return current ? current->base : nullptr; }
+
+	// Writer thread: switch to the prepared segment. Returns false (and keeps
+	// the current one) when Maintain() hasn't caught up yet.
+	bool Advance();
+
+	// Any other non-realtime thread: map ahead, unmap the retired segment
+	void Maintain();
+
+	const std::string &Path() const { return path; }
+
+private:
+	struct Segment {
+		uint8_t *base;
+		uint64_t offset;
+	};
+
+	Segment *MapSegment();
+	void ReleaseSegment(Segment *segment);
+
+	MappedFile file;
+	std::string path;
+	uint8_t *header = nullptr;
+	size_t segment_size = 0;
+	uint64_t next_offset = 0;
+
+	Segment *current = nullptr;              // Owned by the writer thread
+	std::atomic<Segment *> next{nullptr};    // Handed from Maintain() to Advance()
+	std::atomic<Segment *> retired{nullptr}; // Handed back from Advance() to Maintain()
+};
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+
+// Multi-level min/max decimation pyramid over a ring of raw samples
+// Level 0 holds the samples themselves, level k holds one min/max pair per
+// 4^k samples. Levels are updated incrementally as samples arrive, so any
+// window can be reduced to one min/max pair per output pixel by reading a
+// handful of entries from the coarsest level that still fits a pixel.
+
+class MinMaxPyramid {
+public:
+	static const int LEVELS = 10; // Coarsest block is 4^9 = 262144 samples
+	static const int SHIFT = 2;   // log2 of the branching factor
+
+	// Capacity is rounded up to a power of two (and at least one top-level block)
+	void Configure(size_t min_capacity)
+	{
+		size_t cap = (size_t)1 << (SHIFT * (LEVELS - 1));
+		while (cap < min_capacity)
+			cap <<= 1;
+
+		capacity = cap;
+		samples.assign(cap, 0.0f);
+		for (int l = 1; l < LEVELS; l++) {
+			size_t n = cap >> (SHIFT * l);
+			mins[l].assign(n, 0.0f);
+			maxs[l].assign(n, 0.0f);
+			acc_min[l] = INFINITY;
+			acc_max[l] = -INFINITY;
+		}
+		total = 0;
+	}
+
+	size_t Capacity() const { return capacity; }
+	uint64_t Total() const { return total; }
+
+	void Push(const float *in, size_t n)
+	{
+		if (!capacity)
+			return;
+
+		const size_t mask = capacity - 1;
+		for (size_t i = 0; i < n; i++) {
+			float x = in[i];
+			samples[total & mask] = x;
+			total++;
+
+			// Cascade the finished blocks up the pyramid
+			float lo = x, hi = x;
+			uint64_t index = total;
+			for (int l = 1; l < LEVELS; l++) {
+				if (lo < acc_min[l])
+					acc_min[l] = lo;
+				if (hi > acc_max[l])
+					acc_max[l] = hi;
+				if (index & ((1u << SHIFT) - 1))
+					break;
+
+				index >>= SHIFT;
+				size_t slot = (size_t)((index - 1) & ((capacity >> (SHIFT * l)) - 1));
+				mins[l][slot] = lo = acc_min[l];
+				maxs[l][slot] = hi = acc_max[l];
+				acc_min[l] = INFINITY;
+				acc_max[l] = -INFINITY;
+			}
+		}
+	}
+
+	float Sample(uint64_t index) const { return samples[index & (capacity - 1)]; }
+
+	// Reduces [end - window, end) to `width` min/max pairs. Cost is bounded by
+	// width, not window: at most a few entries are read per pixel.
+	void Query(uint64_t end, size_t window, size_t width, float *out_min, float *out_max) const
+	{
+		if (!capacity || !width)
+			return;
+
+		if (window > capacity)
+			window = capacity;
+		if (end > total)
+			end = total;
+
+		double spp = (double)window / (double)width;
+
+		// Coarsest level whose block still fits inside one pixel
+		int level = 0;
+		while (level + 1 < LEVELS && (double)((uint64_t)1 << (SHIFT * (level + 1))) <= spp)
+			level++;
+
+		if (level == 0) {
+			for (size_t p = 0; p < width; p++) {
+				uint64_t a = end - window + (uint64_t)((double)p * spp);
+				uint64_t b = end - window + (uint64_t)((double)(p + 1) * spp);
+				if (b <= a)
+					b = a + 1;
+				float lo = INFINITY, hi = -INFINITY;
+				for (uint64_t s = a; s < b; s++) {
+					float x = (s < total && s + capacity >= total) ? Sample(s) : 0.0f;
+					lo = x < lo ? x : lo;
+					hi = x > hi ? x : hi;
+				}
+				out_min[p] = lo;
+				out_max[p] = hi;
+			}
+			return;
+		}
+
+		// Work in level blocks, ending at the last completed block
+		const int shift = SHIFT * level;
+		const size_t mask = (capacity >> shift) - 1;
+		uint64_t end_block = end >> shift;
+		double bpp = spp / (double)((uint64_t)1 << shift);
+		double start_block = (double)end_block - (double)width * bpp;
+		uint64_t oldest = total > capacity ? (total - capacity + ((uint64_t)1 << shift) - 1) >> shift : 0;
+
+		for (size_t p = 0; p < width; p++) {
+			double fa = start_block + (double)p * bpp;
+			double fb = start_block + (double)(p + 1) * bpp;
+			int64_t a = (int64_t)floor(fa);
+			int64_t b = (int64_t)ceil(fb);
+			if (b <= a)
+				b = a + 1;
+
+			float lo = INFINITY, hi = -INFINITY;
+			for (int64_t k = a; k < b; k++) {
+				if (k < (int64_t)oldest || k >= (int64_t)end_block) {
+					lo = lo > 0.0f ? 0.0f : lo;
+					hi = hi < 0.0f ? 0.0f : hi;
+					continue;
+				}
+				size_t slot = (size_t)k & mask;
+				lo = mins[level][slot] < lo ? mins[level][slot] : lo;
+				hi = maxs[level][slot] > hi ? maxs[level][slot] : hi;
+			}
+			out_min[p] = lo;
+			out_max[p] = hi;
+		}
+	}
+
+	// Latest rising zero crossing in [from, to), or `to` if there is none.
+	// The signal has to dip below -hysteresis first so noise can't retrigger.
+	uint64_t FindRisingEdge(uint64_t from, uint64_t to, float hysteresis) const
+	{
+		if (to > total)
+			to = total;
+		if (total > capacity && from < total - capacity)
+			from = total - capacity;
+
+		uint64_t found = to;
+		bool armed = false;
+		for (uint64_t s = from; s < to; s++) {
+			float x = Sample(s);
+			if (x < -hysteresis) {
+				armed = true;
+			} else if (armed && x >= 0.0f) {
+				found = s;
+				armed = false;
+			}
+		}
+		return found;
+	}
+
+private:
+	size_t capacity = 0;
+	uint64_t total = 0;
+	std::vector<float> samples;
+	std::vector<float> mins[LEVELS];
+	std::vector<float> maxs[LEVELS];
+	float acc_min[LEVELS];
+	float acc_max[LEVELS];
+};
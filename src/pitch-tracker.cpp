@@ -0,0 +1,224 @@
+#include "pitch-tracker.hpp"
+#include <cmath>
+#include <cstring>
+
+#define PITCH_WINDOW_SECONDS 0.04f // Over a period and a half of PITCH_MIN_HZ
+#define PITCH_PEAK_RATIO 0.9f      // Of the highest NSDF peak, for an earlier one to be taken
+#define PITCH_SILENCE 1e-8f        // Mean square below which nothing is tracked
+#define PITCH_CHUNK 256            // Input decimated at a time
+#define PITCH_MAX_PEAKS 32
+
+// Decimation for an input rate, and the window at the rate it leaves
+static int pitch_factor(float sample_rate)
+{
+	return PolyphaseDecimator::ChooseFactor(sample_rate, PITCH_TOP_HZ);
+}
+
+size_t PitchTracker::WindowFor(float sample_rate)
+{
+	if (!(sample_rate > 0.0f))
+		return 0;
+	size_t wanted = (size_t)(sample_rate / (float)pitch_factor(sample_rate) * PITCH_WINDOW_SECONDS);
+	size_t w = 64;
+	while (w < wanted)
+		w <<= 1;
+	return w;
+}
+
+size_t PitchTracker::StorageCount(float sample_rate)
+{
+	size_t w = WindowFor(sample_rate);
+	if (w == 0)
+		return 0;
+	// Ring, samples, power, re, im, twiddles re/im, NSDF, FFT cos/sin, chunk
+	return w * 8 + 1 + SimpleFFT::TwiddleCount(w) * 2 + PITCH_CHUNK;
+}
+
+void PitchTracker::Init(float sample_rate, float *storage, uint32_t *bitrev)
+{
+	window = WindowFor(sample_rate);
+	if (window == 0)
+		return;
+	int factor = pitch_factor(sample_rate);
+	decimator.SetFactor(factor);
+	rate = sample_rate / (float)factor;
+
+	ring = storage;
+	samples = ring + window;
+	power = samples + window;
+	re = power + window + 1;
+	im = re + window;
+	twiddle_re = im + window;
+	twiddle_im = twiddle_re + window;
+	nsdf = twiddle_im + window;
+	float *cos_table = nsdf + window;
+	float *sin_table = cos_table + SimpleFFT::TwiddleCount(window);
+	chunk = sin_table + SimpleFFT::TwiddleCount(window);
+	fft.Init(window, cos_table, sin_table, bitrev);
+
+	for (size_t k = 0; k < window; k++) {
+		double angle = -M_PI * (double)k / (double)window;
+		twiddle_re[k] = (float)cos(angle);
+		twiddle_im[k] = (float)sin(angle);
+	}
+	Reset();
+}
+
+void PitchTracker::Reset()
+{
+	if (window == 0)
+		return;
+	memset(ring, 0, window * sizeof(float));
+	ring_pos = 0;
+	decimator.SetFactor(decimator.GetFactor());
+}
+
+void PitchTracker::Push(const float *input, size_t count)
+{
+	if (window == 0)
+		return;
+	while (count > 0) {
+		size_t take = count < PITCH_CHUNK ? count : PITCH_CHUNK;
+		memcpy(chunk, input, take * sizeof(float));
+		size_t produced = decimator.Process(chunk, take);
+		for (size_t i = 0; i < produced; i++) {
+			ring[ring_pos] = chunk[i];
+			ring_pos = (ring_pos + 1) & (window - 1);
+		}
+		input += take;
+		count -= take;
+	}
+}
+
+// Transform of 2W real values packed as z[m] = v[2m] + i v[2m+1] in re/im.
+// The half-length FFT of z is split into the spectra of the even and odd
+// values and recombined, leaving X[k] in re/im for k < W. X[W] is real and
+// returned.
+float PitchTracker::RealForward()
+{
+	fft.Forward(re, im);
+
+	float nyquist = re[0] - im[0];
+	re[0] += im[0];
+	im[0] = 0.0f;
+
+	// X[k] and X[W - k] come from the same pair of Z values
+	for (size_t k = 1; k <= window / 2; k++) {
+		size_t j = window - k;
+		float a_re = re[k], a_im = im[k];
+		float b_re = re[j], b_im = im[j];
+
+		// Even part (Z[k] + conj Z[j]) / 2, odd part (Z[k] - conj Z[j]) / 2i
+		float e_re = 0.5f * (a_re + b_re), e_im = 0.5f * (a_im - b_im);
+		float o_re = 0.5f * (a_im + b_im), o_im = -0.5f * (a_re - b_re);
+		float t_re = twiddle_re[k] * o_re - twiddle_im[k] * o_im;
+		float t_im = twiddle_re[k] * o_im + twiddle_im[k] * o_re;
+		re[k] = e_re + t_re;
+		im[k] = e_im + t_im;
+		re[j] = e_re - t_re; // conj(E - T)
+		im[j] = t_im - e_im;
+	}
+	return nyquist;
+}
+
+void PitchTracker::Estimate(AudioFeatures &out)
+{
+	out.pitch_hz = 0.0f;
+	out.pitch_confidence = 0.0f;
+	if (window == 0)
+		return;
+
+	const size_t w = window;
+	memcpy(samples, ring + ring_pos, (w - ring_pos) * sizeof(float));
+	memcpy(samples + (w - ring_pos), ring, ring_pos * sizeof(float));
+
+	float energy = 0.0f;
+	for (size_t i = 0; i < w; i++)
+		energy += samples[i] * samples[i];
+	if (energy < PITCH_SILENCE * (float)w)
+		return;
+
+	// Power spectrum of the samples padded to 2W, so the circular
+	// autocorrelation doesn't wrap
+	for (size_t m = 0; m < w / 2; m++) {
+		re[m] = samples[2 * m];
+		im[m] = samples[2 * m + 1];
+	}
+	memset(re + w / 2, 0, (w - w / 2) * sizeof(float));
+	memset(im + w / 2, 0, (w - w / 2) * sizeof(float));
+	float nyquist = RealForward();
+	for (size_t k = 0; k < w; k++)
+		power[k] = re[k] * re[k] + im[k] * im[k];
+	power[w] = nyquist * nyquist;
+
+	// The power spectrum is real and even over its 2W bins, so running it
+	// through the same transform gives 2W times the autocorrelation
+	for (size_t m = 0; m < w; m++) {
+		size_t even = 2 * m, odd = 2 * m + 1;
+		re[m] = power[even <= w ? even : 2 * w - even];
+		im[m] = power[odd <= w ? odd : 2 * w - odd];
+	}
+	RealForward();
+
+	size_t min_lag = (size_t)(rate / PITCH_MAX_HZ);
+	size_t max_lag = (size_t)(rate / PITCH_MIN_HZ) + 1;
+	if (min_lag < 2)
+		min_lag = 2;
+	if (max_lag > w - 2)
+		max_lag = w - 2;
+	if (min_lag + 2 > max_lag)
+		return;
+
+	// NSDF: 2 r(t) over m(t), the energy of both parts that overlap at lag t
+	float scale = 1.0f / (float)(2 * w);
+	float m = 2.0f * energy;
+	nsdf[0] = 1.0f;
+	for (size_t t = 1; t <= max_lag + 1; t++) {
+		m -= samples[t - 1] * samples[t - 1] + samples[w - t] * samples[w - t];
+		nsdf[t] = m > 0.0f ? 2.0f * re[t] * scale / m : 0.0f;
+	}
+
+	// Highest point of each positive lobe after the one around lag 0, with
+	// its lag and height refined by a parabola through the neighbours. At
+	// high pitches a period is only a few samples, so the raw heights would
+	// favour whichever multiple of it happens to land on a sample.
+	size_t t = 1;
+	while (t <= max_lag && nsdf[t] > 0.0f)
+		t++;
+	float lags[PITCH_MAX_PEAKS];
+	float heights[PITCH_MAX_PEAKS];
+	size_t count = 0;
+	float highest = 0.0f;
+	while (t <= max_lag && count < PITCH_MAX_PEAKS) {
+		while (t <= max_lag && nsdf[t] <= 0.0f)
+			t++;
+		if (t > max_lag)
+			break;
+		size_t peak = t;
+		while (t <= max_lag && nsdf[t] > 0.0f) {
+			if (nsdf[t] > nsdf[peak])
+				peak = t;
+			t++;
+		}
+		if (peak < min_lag)
+			continue;
+		float a = nsdf[peak - 1], b = nsdf[peak], c = nsdf[peak + 1];
+		float curve = a - 2.0f * b + c;
+		float offset = curve < 0.0f ? 0.5f * (a - c) / curve : 0.0f;
+		lags[count] = (float)peak + offset;
+		heights[count] = b - 0.25f * (a - c) * offset;
+		if (heights[count] > highest)
+			highest = heights[count];
+		count++;
+	}
+
+	// The first peak close to the highest is the period; later ones are its
+	// multiples
+	for (size_t i = 0; i < count; i++) {
+		if (heights[i] < PITCH_PEAK_RATIO * highest)
+			continue;
+		out.pitch_hz = rate / lags[i];
+		out.pitch_confidence = heights[i] < 1.0f ? heights[i] : 1.0f;
+		break;
+	}
+}
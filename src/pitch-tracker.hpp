@@ -0,0 +1,67 @@
+#pragma once
+
+#include "audio-features.hpp"
+#include "decimator.hpp"
+#include "fft-utils.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Monophonic pitch tracking with the McLeod pitch method
+// Input is decimated to the lowest rate that keeps PITCH_TOP_HZ (the second
+// harmonic of the highest pitch) and the newest 40 ms or so are kept in a
+// ring. The normalised square difference function (NSDF) of those samples
+// is 2 r(t) / m(t): the autocorrelation r over the summed energy m of the
+// two overlapping parts. r comes from the power spectrum of the zero-padded
+// samples run back through the FFT, so each estimate is O(W log W) instead
+// of the O(W^2) of correlating in the time domain. Both transforms have
+// real input and go through a complex FFT of half their length. The pitch
+// is the first NSDF peak at least 90% as high as the highest, refined by a
+// parabola; its height is the confidence.
+//
+// Working storage lives in caller-provided buffers (the analysis arena).
+// No OBS dependencies.
+
+#define PITCH_MIN_HZ 40.0f
+#define PITCH_MAX_HZ 2000.0f
+#define PITCH_TOP_HZ 4000.0f
+// Between estimates; the analyzer holds the last one for the spectra in
+// between, since an estimate costs more than the rest of a hop
+#define PITCH_INTERVAL_SECONDS 0.03f
+
+class PitchTracker {
+public:
+	// Storage for Init() at an input rate of `sample_rate`
+	static size_t StorageCount(float sample_rate);
+	static size_t BitrevCount(float sample_rate) { return WindowFor(sample_rate); }
+
+	// A rate of 0 turns tracking off
+	void Init(float sample_rate, float *storage, uint32_t *bitrev);
+	void Reset();
+
+	bool Enabled() const { return window > 0; }
+
+	// Input samples, at the rate given to Init()
+	void Push(const float *samples, size_t count);
+
+	// Pitch of the newest samples into pitch_hz and pitch_confidence of `out`
+	void Estimate(AudioFeatures &out);
+
+private:
+	static size_t WindowFor(float sample_rate);
+	float RealForward();
+
+	size_t window = 0; // W samples at the decimated rate; the transforms are 2W long
+	float rate = 48000.0f; // After decimation
+	PolyphaseDecimator decimator;
+	SimpleFFT fft;           // W points, for 2W real ones
+	float *ring = nullptr;   // Newest W decimated samples
+	size_t ring_pos = 0;     // Oldest sample
+	float *chunk = nullptr;  // Input being decimated, PITCH_CHUNK samples
+	float *samples = nullptr; // Ring unrolled, oldest first
+	float *power = nullptr;   // W + 1
+	float *re = nullptr;      // W each
+	float *im = nullptr;
+	float *twiddle_re = nullptr; // e^(-i pi k / W), W each
+	float *twiddle_im = nullptr;
+	float *nsdf = nullptr; // W
+};
@@ -1,12 +1,20 @@
 #include <obs-module.h>
 #include "glass-line.hpp"
+#include "audio-tap.hpp"
+#include "spectrum-kernels.hpp"
+#include "plugin-support.h"
 
 OBS_DECLARE_MODULE()
 OBS_MODULE_USE_DEFAULT_LOCALE("glass-line", "en-US")
 
 bool obs_module_load(void)
 {
+	// Selection runs the self-check, so do it here rather than on the audio thread
+	obs_log(LOG_INFO, "Spectrum kernels: %s", spectrum_kernels().name);
+	for (size_t i = 0; const char *reason = spectrum_kernels_rejected(i); i++)
+		obs_log(LOG_WARNING, "Spectrum kernels rejected by the self-check: %s", reason);
 	obs_register_source(&glass_line_source);
+	obs_register_source(&glass_line_audio_tap);
 	return true;
 }
 
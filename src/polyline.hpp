@@ -0,0 +1,189 @@
+#pragma once
+
+#include "simd.hpp"
+#include <vector>
+#include <cstddef>
+#include <cmath>
+
+// Thick anti-aliased polyline tessellator
+// Turns a curve into one triangle strip with two vertices per point (more
+// around round joins). Each vertex carries its signed distance from the
+// centre line in pixels, so a pixel shader can fade the outer `feather`
+// pixels to zero alpha for a smooth edge. Ends are butt caps.
+//
+// Segment normals are computed four at a time in a first pass; joins are
+// resolved in a second, scalar pass. No allocation after Reserve().
+
+enum PolylineJoin {
+	POLYLINE_JOIN_MITER = 0,
+	POLYLINE_JOIN_ROUND = 1,
+};
+
+struct PolylineStyle {
+	float half_width = 1.0f; // Fully opaque half width (px)
+	float feather = 1.0f;    // Alpha ramp outside the opaque part (px)
+	PolylineJoin join = POLYLINE_JOIN_ROUND;
+	float miter_limit = 4.0f; // Longest miter as a multiple of the half width
+};
+
+class PolylineTessellator {
+public:
+	static const int MAX_ROUND_STEPS = 8; // Arc segments for a 180 degree turn
+
+	// Worst-case strip length for a curve of `points` points
+	static size_t MaxVertices(size_t points) { return points * 2 * (MAX_ROUND_STEPS + 2); }
+
+	void Reserve(size_t max_points)
+	{
+		normal_x.resize(max_points + 4);
+		normal_y.resize(max_points + 4);
+	}
+	size_t Capacity() const { return normal_x.size() >= 4 ? normal_x.size() - 4 : 0; }
+
+	// Calls emit(point, x, y, distance) for every strip vertex, `point` being
+	// the curve point it belongs to, and returns the vertex count. Stops early
+	// (at a point boundary) rather than exceed max_vertices; points beyond
+	// Capacity() are ignored.
+	template<typename Emit>
+	size_t Tessellate(const float *x, const float *y, size_t count, const PolylineStyle &style,
+			  size_t max_vertices, Emit &&emit)
+	{
+		if (count > Capacity())
+			count = Capacity();
+		if (count < 2)
+			return 0;
+
+		ComputeNormals(x, y, count);
+
+		const float extent = style.half_width + style.feather;
+		const float min_len2 = 4.0f / (style.miter_limit * style.miter_limit);
+		const float round_cos = 0.94f; // Turns sharper than ~20 degrees get an arc
+		size_t n = 0;
+
+		auto pair = [&](size_t point, float lx, float ly, float rx, float ry) {
+			emit(point, lx, ly, extent);
+			emit(point, rx, ry, -extent);
+			n += 2;
+		};
+
+		// First point
+		pair(0, x[0] + normal_x[0] * extent, y[0] + normal_y[0] * extent, x[0] - normal_x[0] * extent,
+		     y[0] - normal_y[0] * extent);
+
+		for (size_t i = 1; i + 1 < count; i++) {
+			if (n + 2 * (MAX_ROUND_STEPS + 2) + 2 > max_vertices)
+				return n;
+
+			float n0x = normal_x[i - 1], n0y = normal_y[i - 1];
+			float n1x = normal_x[i], n1y = normal_y[i];
+
+			// Miter offset: (n0 + n1) * 2 / |n0 + n1|^2 has unit projection on both normals
+			float sx = n0x + n1x, sy = n0y + n1y;
+			float len2 = sx * sx + sy * sy;
+			float mx, my;
+			if (len2 < 1e-6f) {
+				mx = n0x; // Full reversal
+				my = n0y;
+			} else if (len2 < min_len2) {
+				float scale = style.miter_limit / sqrtf(len2); // Clamped to the limit
+				mx = sx * scale;
+				my = sy * scale;
+			} else {
+				mx = sx * 2.0f / len2;
+				my = sy * 2.0f / len2;
+			}
+
+			float cos_turn = n0x * n1x + n0y * n1y;
+			if (style.join == POLYLINE_JOIN_MITER || cos_turn > round_cos) {
+				pair(i, x[i] + mx * extent, y[i] + my * extent, x[i] - mx * extent, y[i] - my * extent);
+				continue;
+			}
+
+			// Round join: the inner side stays on the miter point while the
+			// outer side sweeps an arc from n0 to n1
+			float cross = n0x * n1y - n0y * n1x;
+			float outer = cross > 0.0f ? -1.0f : 1.0f;
+			float angle = acosf(cos_turn < -1.0f ? -1.0f : cos_turn);
+			int steps = (int)ceilf(angle / (float)M_PI * MAX_ROUND_STEPS);
+			if (steps < 1)
+				steps = 1;
+			float step = (cross > 0.0f ? angle : -angle) / (float)steps;
+			float cs = cosf(step), sn = sinf(step);
+
+			float ix = x[i] - outer * mx * extent, iy = y[i] - outer * my * extent;
+			float rx = n0x, ry = n0y;
+			for (int s = 0; s <= steps; s++) {
+				float ax = x[i] + outer * rx * extent, ay = y[i] + outer * ry * extent;
+				if (outer > 0.0f)
+					pair(i, ax, ay, ix, iy);
+				else
+					pair(i, ix, iy, ax, ay);
+
+				float nx = rx * cs - ry * sn;
+				ry = rx * sn + ry * cs;
+				rx = nx;
+			}
+		}
+
+		// Last point
+		size_t last = count - 1;
+		float lx = normal_x[last - 1], ly = normal_y[last - 1];
+		pair(last, x[last] + lx * extent, y[last] + ly * extent, x[last] - lx * extent, y[last] - ly * extent);
+		return n;
+	}
+
+private:
+	// Unit left normal of every segment; zero-length segments inherit the previous one
+	void ComputeNormals(const float *x, const float *y, size_t count)
+	{
+		const size_t segments = count - 1;
+		size_t i = 0;
+		const simd::float4 zero = simd::set1(0.0f);
+		const simd::float4 eps = simd::set1(1e-12f);
+		for (; i + 4 <= segments; i += 4) {
+			simd::float4 dx = simd::sub(simd::load(x + i + 1), simd::load(x + i));
+			simd::float4 dy = simd::sub(simd::load(y + i + 1), simd::load(y + i));
+			simd::float4 inv = simd::rsqrt(simd::add(simd::madd(dx, dx, simd::mul(dy, dy)), eps));
+			simd::store(&normal_x[i], simd::sub(zero, simd::mul(dy, inv)));
+			simd::store(&normal_y[i], simd::mul(dx, inv));
+		}
+		for (; i < segments; i++) {
+			float dx = x[i + 1] - x[i], dy = y[i + 1] - y[i];
+			float inv = 1.0f / sqrtf(dx * dx + dy * dy + 1e-12f);
+			normal_x[i] = -dy * inv;
+			normal_y[i] = dx * inv;
+		}
+
+		float px = 0.0f, py = 1.0f;
+		for (i = 0; i < segments; i++) {
+			if (normal_x[i] * normal_x[i] + normal_y[i] * normal_y[i] < 0.5f) {
+				normal_x[i] = px;
+				normal_y[i] = py;
+			}
+			px = normal_x[i];
+			py = normal_y[i];
+		}
+	}
+
+	std::vector<float> normal_x;
+	std::vector<float> normal_y;
+};
+
+// out[i] = offset + in[i] * scale, four at a time
+static inline void polyline_scale(const float *in, size_t count, float scale, float offset, float *out)
+{
+	size_t i = 0;
+	const simd::float4 s = simd::set1(scale);
+	const simd::float4 o = simd::set1(offset);
+	for (; i + 4 <= count; i += 4)
+		simd::store(out + i, simd::madd(simd::load(in + i), s, o));
+	for (; i < count; i++)
+		out[i] = offset + in[i] * scale;
+}
+
+// out[i] = start + i * step
+static inline void polyline_ramp(size_t count, float start, float step, float *out)
+{
+	for (size_t i = 0; i < count; i++)
+		out[i] = start + (float)i * step;
+}
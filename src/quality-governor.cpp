@@ -0,0 +1,80 @@
+#include "quality-governor.hpp"
+
+// Fractions of the frame interval. The gap between each busy and idle
+// threshold is the hysteresis that keeps the level from oscillating.
+#define OBS_BUSY 0.85f
+#define OBS_IDLE 0.60f
+#define OWN_BUSY 0.10f
+#define OWN_IDLE 0.04f
+
+#define LOAD_SMOOTHING 0.1f // Weight of each new frame in the averages
+#define BUSY_FRAMES 30      // About half a second at 60 fps before stepping down
+#define IDLE_FRAMES 300     // About five seconds of headroom before stepping up
+#define HOLD_FRAMES 120     // After any change
+
+// Cheapest savings first: fewer drawn bands, then glow, then the analysis
+static const QualityLevel levels[QualityGovernor::LEVELS] = {
+	// FFT, hop scale, band stride, glow, render scale
+	{2048, 1.0f, 1, true, 1.0f},
+	{2048, 1.0f, 2, true, 1.0f},
+	{2048, 1.5f, 2, false, 1.0f},
+	{1024, 2.0f, 2, false, 0.75f},
+	{512, 2.0f, 4, false, 0.5f},
+};
+
+const QualityLevel &QualityGovernor::Level(int index)
+{
+	if (index < 0)
+		index = 0;
+	if (index >= LEVELS)
+		index = LEVELS - 1;
+	return levels[index];
+}
+
+void QualityGovernor::Reset()
+{
+	level = 0;
+	own_load = 0.0f;
+	obs_load = 0.0f;
+	frames_busy = 0;
+	frames_idle = 0;
+	hold = 0;
+	reason = "";
+}
+
+bool QualityGovernor::Update(uint64_t own_ns, uint64_t obs_frame_ns, uint64_t interval_ns)
+{
+	if (interval_ns == 0)
+		return false;
+
+	own_load += ((float)own_ns / (float)interval_ns - own_load) * LOAD_SMOOTHING;
+	obs_load += ((float)obs_frame_ns / (float)interval_ns - obs_load) * LOAD_SMOOTHING;
+
+	bool obs_busy = obs_load > OBS_BUSY;
+	bool own_busy = own_load > OWN_BUSY;
+	bool idle = obs_load < OBS_IDLE && own_load < OWN_IDLE;
+	frames_busy = obs_busy || own_busy ? frames_busy + 1 : 0;
+	frames_idle = idle ? frames_idle + 1 : 0;
+
+	if (hold > 0) {
+		hold--;
+		return false;
+	}
+
+	int next = level;
+	if (frames_busy >= BUSY_FRAMES && level < LEVELS - 1) {
+		next = level + 1;
+		reason = obs_busy ? "OBS frame time near budget" : "analysis and rendering over budget";
+	} else if (frames_idle >= IDLE_FRAMES && level > 0) {
+		next = level - 1;
+		reason = "headroom returned";
+	}
+	if (next == level)
+		return false;
+
+	level = next;
+	frames_busy = 0;
+	frames_idle = 0;
+	hold = HOLD_FRAMES;
+	return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Adaptive quality for loaded machines
+// Once per video frame the governor gets this instance's analysis and render
+// cost for the frame and OBS's average frame render time. Sustained pressure
+// (OBS near its frame budget, or this instance over its own share of it)
+// steps quality down one level; a long stretch of headroom steps it back up.
+// After every change the level is held for a while so its effect shows up
+// in the averages before it's judged. No OBS dependencies.
+
+struct QualityLevel {
+	size_t fft_size;
+	float hop_scale;    // Multiplies the configured analysis interval
+	int band_stride;    // Adjacent bins pooled into one drawn band
+	bool glow;          // Glow layers drawn
+	float render_scale; // Internal render resolution
+};
+
+class QualityGovernor {
+public:
+	static const int LEVELS = 5;
+	static const QualityLevel &Level(int index);
+
+	// Back to full quality
+	void Reset();
+
+	// One video frame: this instance's CPU time, OBS's average frame time and
+	// the frame interval, all in ns. Returns true when the level changed.
+	bool Update(uint64_t own_ns, uint64_t obs_frame_ns, uint64_t interval_ns);
+
+	int Current() const { return level; }
+	const QualityLevel &Settings() const { return Level(level); }
+	const char *Reason() const { return reason; } // Of the last change
+	float OwnLoad() const { return own_load; }    // Smoothed fractions of the frame interval
+	float ObsLoad() const { return obs_load; }
+
+private:
+	int level = 0;
+	float own_load = 0.0f;
+	float obs_load = 0.0f;
+	uint32_t frames_busy = 0; // Consecutive frames over budget
+	uint32_t frames_idle = 0; // Consecutive frames with headroom
+	uint32_t hold = 0;        // Frames until the level may change again
+	const char *reason = "";
+};
@@ -0,0 +1,171 @@
+#include "shm-publisher.hpp"
+#include <chrono>
+#include <cstring>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(glshm_header) % 8 == 0, "header fields must stay 8-byte aligned");
+static_assert(sizeof(glshm_frame) % 8 == 0, "bands must follow the frame header aligned");
+static_assert(GLSHM_MAX_CHANNELS == FEATURE_MAX_CHANNELS, "feature channels must fit the frame");
+
+#ifdef _WIN32
+
+bool ShmPublisher::Open(const char *, uint32_t, uint32_t)
+{
+	return false;
+}
+
+void ShmPublisher::Close() {}
+
+void ShmPublisher::Publish(uint64_t, uint64_t, const float *, size_t, float, const AudioFeatures &) {}
+
+#else
+
+// Whether the existing object `name` is a feed whose writer has gone away,
+// so it can be unlinked. Anything else (a live writer, which goes into
+// `owner`, or an object that isn't a feed) is left alone.
+static bool abandoned_feed(const char *name, uint32_t &owner)
+{
+	owner = 0;
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(glshm_header)) {
+		::close(fd);
+		return false;
+	}
+	void *mapped = mmap(nullptr, sizeof(glshm_header), PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (mapped == MAP_FAILED)
+		return false;
+
+	const glshm_header *header = (const glshm_header *)mapped;
+	bool feed = header->magic == GLSHM_MAGIC;
+	uint32_t pid = header->writer_pid;
+	munmap(mapped, sizeof(glshm_header));
+	if (!feed)
+		return false;
+
+	// EPERM means the process exists but belongs to someone else
+	if (pid != 0 && (kill((pid_t)pid, 0) == 0 || errno == EPERM)) {
+		owner = pid;
+		return false;
+	}
+	return true;
+}
+
+bool ShmPublisher::Open(const char *new_name, uint32_t max_bands, uint32_t slot_count)
+{
+	Close();
+	in_use_by = 0;
+	if (!new_name || !*new_name || strchr(new_name, '/') || max_bands == 0 || slot_count == 0)
+		return false;
+
+	name = std::string("/") + new_name;
+	size_t slot_size = glshm_slot_size(max_bands);
+	size_t total = glshm_header_size() + slot_size * slot_count;
+
+	// Only a leftover of a crashed session is replaced (it may have another
+	// size, so it isn't reused); another writer keeps its name
+	int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0 && errno == EEXIST && abandoned_feed(name.c_str(), in_use_by)) {
+		shm_unlink(name.c_str());
+		fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+	}
+	if (fd < 0)
+		return false;
+	if (ftruncate(fd, (off_t)total) != 0) {
+		::close(fd);
+		shm_unlink(name.c_str());
+		return false;
+	}
+	void *mapped = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (mapped == MAP_FAILED) {
+		shm_unlink(name.c_str());
+		return false;
+	}
+
+	base = (uint8_t *)mapped;
+	size = total;
+	memset(base, 0, total); // Touch every page now rather than on the audio thread
+
+	header = (glshm_header *)base;
+	header->magic = GLSHM_MAGIC;
+	header->version = GLSHM_VERSION;
+	header->header_size = glshm_header_size();
+	header->slot_size = (uint32_t)slot_size;
+	header->slot_count = slot_count;
+	header->max_bands = max_bands;
+	header->writer_pid = (uint32_t)getpid();
+	header->created_ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+				     std::chrono::system_clock::now().time_since_epoch())
+				     .count();
+	__atomic_store_n(&header->write_index, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&header->state, GLSHM_STATE_LIVE, __ATOMIC_RELEASE);
+
+	next_index = 0;
+	frames_written = 0;
+	return true;
+}
+
+void ShmPublisher::Close()
+{
+	if (!base)
+		return;
+	__atomic_store_n(&header->state, GLSHM_STATE_CLOSED, __ATOMIC_RELEASE);
+	munmap(base, size);
+	shm_unlink(name.c_str());
+	base = nullptr;
+	header = nullptr;
+	size = 0;
+}
+
+void ShmPublisher::Publish(uint64_t timestamp, uint64_t publish_time, const float *bands, size_t count, float bin_hz,
+			   const AudioFeatures &features)
+{
+	if (!base)
+		return;
+	if (count > header->max_bands)
+		count = header->max_bands;
+
+	uint64_t index = next_index++;
+	uint8_t *slot = base + header->header_size + (size_t)(index % header->slot_count) * header->slot_size;
+	glshm_frame *frame = (glshm_frame *)slot;
+
+	// Seqlock: odd while the slot is being filled, readers retry or skip it
+	__atomic_store_n(&frame->sequence, 2 * index + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	frame->index = index;
+	frame->timestamp_ns = timestamp;
+	frame->publish_ns = publish_time;
+	frame->band_count = (uint32_t)count;
+	frame->channels = features.channels;
+	frame->flags = (features.onset > 0.0f ? GLSHM_FLAG_ONSET : 0u) | (features.beat ? GLSHM_FLAG_BEAT : 0u);
+	frame->bin_hz = bin_hz;
+	memcpy(frame->rms, features.rms, sizeof(frame->rms));
+	memcpy(frame->peak, features.peak, sizeof(frame->peak));
+	frame->centroid_hz = features.centroid_hz;
+	frame->flux = features.flux;
+	frame->onset = features.onset;
+	frame->tempo_bpm = features.tempo_bpm;
+	frame->beat_phase = features.beat_phase;
+	frame->pitch_hz = features.pitch_hz;
+	frame->pitch_confidence = features.pitch_confidence;
+	memcpy(slot + sizeof(glshm_frame), bands, count * sizeof(float));
+
+	__atomic_store_n(&frame->sequence, 2 * index + 2, __ATOMIC_RELEASE);
+	__atomic_store_n(&header->write_index, index + 1, __ATOMIC_RELEASE);
+	frames_written.fetch_add(1, std::memory_order_relaxed);
+}
+
+#endif
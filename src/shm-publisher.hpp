@@ -0,0 +1,44 @@
+#pragma once
+
+#include "audio-features.hpp"
+#include "glassline-shm.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Writer side of the shared-memory spectrum feed (layout in glassline-shm.h)
+// Open() creates and maps the object up front; Publish() is then one memcpy
+// of the bands plus the frame header, with no syscalls. POSIX only; Open()
+// fails on other platforms.
+
+class ShmPublisher {
+public:
+	~ShmPublisher() { Close(); }
+
+	// `name` without the leading slash. An object of that name left behind by
+	// a writer that has gone away is replaced; one whose writer is still
+	// running is left alone and Open() fails, with InUseBy() set.
+	bool Open(const char *name, uint32_t max_bands, uint32_t slot_count);
+	// Marks the feed closed and unlinks the name; mapped readers keep the last frames
+	void Close();
+	bool IsOpen() const { return base != nullptr; }
+
+	// Audio thread: one spectrum with its features. Bands beyond max_bands are cut.
+	void Publish(uint64_t timestamp, uint64_t publish_time, const float *bands, size_t count, float bin_hz,
+		     const AudioFeatures &features);
+
+	uint64_t FramesWritten() const { return frames_written.load(std::memory_order_relaxed); }
+	const std::string &Name() const { return name; }
+	// After a failed Open(): the live process publishing under the name, else 0
+	uint32_t InUseBy() const { return in_use_by; }
+
+private:
+	uint8_t *base = nullptr;
+	size_t size = 0;
+	std::string name; // With the leading slash
+	glshm_header *header = nullptr;
+	uint64_t next_index = 0;
+	std::atomic<uint64_t> frames_written{0};
+	uint32_t in_use_by = 0;
+};
@@ -0,0 +1,202 @@
+#pragma once
+
+// Minimal 4-wide float vector used by the DSP code.
+// SSE on x86, NEON on ARM, plain scalar code everywhere else.
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GLASSLINE_SIMD_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define GLASSLINE_SIMD_NEON 1
+#endif
+
+namespace simd {
+
+#if defined(GLASSLINE_SIMD_SSE)
+
+struct float4 {
+	__m128 v;
+};
+
+static inline float4 load(const float *p)
+{
+	return {_mm_loadu_ps(p)};
+}
+static inline void store(float *p, float4 a)
+{
+	_mm_storeu_ps(p, a.v);
+}
+static inline float4 set1(float x)
+{
+	return {_mm_set1_ps(x)};
+}
+static inline float4 add(float4 a, float4 b)
+{
+	return {_mm_add_ps(a.v, b.v)};
+}
+static inline float4 sub(float4 a, float4 b)
+{
+	return {_mm_sub_ps(a.v, b.v)};
+}
+static inline float4 mul(float4 a, float4 b)
+{
+	return {_mm_mul_ps(a.v, b.v)};
+}
+static inline float4 madd(float4 a, float4 b, float4 c)
+{
+	return {_mm_add_ps(_mm_mul_ps(a.v, b.v), c.v)};
+}
+static inline float4 min(float4 a, float4 b)
+{
+	return {_mm_min_ps(a.v, b.v)};
+}
+static inline float4 max(float4 a, float4 b)
+{
+	return {_mm_max_ps(a.v, b.v)};
+}
+// Approximate 1/sqrt(a), refined with one Newton step (~1e-6 relative error)
+static inline float4 rsqrt(float4 a)
+{
+	__m128 r = _mm_rsqrt_ps(a.v);
+	__m128 half_a = _mm_mul_ps(a.v, _mm_set1_ps(0.5f));
+	return {_mm_mul_ps(r, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(half_a, _mm_mul_ps(r, r))))};
+}
+static inline float hsum(float4 a)
+{
+	__m128 shuf = _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 sums = _mm_add_ps(a.v, shuf);
+	shuf = _mm_movehl_ps(shuf, sums);
+	return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+}
+
+#elif defined(GLASSLINE_SIMD_NEON)
+
+struct float4 {
+	float32x4_t v;
+};
+
+static inline float4 load(const float *p)
+{
+	return {vld1q_f32(p)};
+}
+static inline void store(float *p, float4 a)
+{
+	vst1q_f32(p, a.v);
+}
+static inline float4 set1(float x)
+{
+	return {vdupq_n_f32(x)};
+}
+static inline float4 add(float4 a, float4 b)
+{
+	return {vaddq_f32(a.v, b.v)};
+}
+static inline float4 sub(float4 a, float4 b)
+{
+	return {vsubq_f32(a.v, b.v)};
+}
+static inline float4 mul(float4 a, float4 b)
+{
+	return {vmulq_f32(a.v, b.v)};
+}
+static inline float4 madd(float4 a, float4 b, float4 c)
+{
+	return {vmlaq_f32(c.v, a.v, b.v)};
+}
+static inline float4 min(float4 a, float4 b)
+{
+	return {vminq_f32(a.v, b.v)};
+}
+static inline float4 max(float4 a, float4 b)
+{
+	return {vmaxq_f32(a.v, b.v)};
+}
+static inline float4 rsqrt(float4 a)
+{
+	float32x4_t r = vrsqrteq_f32(a.v);
+	r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(a.v, r), r));
+	return {vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(a.v, r), r))};
+}
+static inline float hsum(float4 a)
+{
+	float32x2_t s = vadd_f32(vget_low_f32(a.v), vget_high_f32(a.v));
+	return vget_lane_f32(vpadd_f32(s, s), 0);
+}
+
+#else
+
+struct float4 {
+	float v[4];
+};
+
+static inline float4 load(const float *p)
+{
+	return {{p[0], p[1], p[2], p[3]}};
+}
+static inline void store(float *p, float4 a)
+{
+	for (int i = 0; i < 4; i++)
+		p[i] = a.v[i];
+}
+static inline float4 set1(float x)
+{
+	return {{x, x, x, x}};
+}
+static inline float4 add(float4 a, float4 b)
+{
+	return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}};
+}
+static inline float4 sub(float4 a, float4 b)
+{
+	return {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}};
+}
+static inline float4 mul(float4 a, float4 b)
+{
+	return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}};
+}
+static inline float4 madd(float4 a, float4 b, float4 c)
+{
+	return add(mul(a, b), c);
+}
+static inline float4 min(float4 a, float4 b)
+{
+	float4 r;
+	for (int i = 0; i < 4; i++)
+		r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i];
+	return r;
+}
+static inline float4 max(float4 a, float4 b)
+{
+	float4 r;
+	for (int i = 0; i < 4; i++)
+		r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+	return r;
+}
+static inline float4 rsqrt(float4 a)
+{
+	float4 r;
+	for (int i = 0; i < 4; i++)
+		r.v[i] = 1.0f / std::sqrt(a.v[i]);
+	return r;
+}
+static inline float hsum(float4 a)
+{
+	return (a.v[0] + a.v[1]) + (a.v[2] + a.v[3]);
+}
+
+#endif
+
+// Dot product of two float arrays, n must be a multiple of 4
+static inline float dot(const float *a, const float *b, size_t n)
+{
+	float4 acc = set1(0.0f);
+	for (size_t i = 0; i < n; i += 4)
+		acc = madd(load(a + i), load(b + i), acc);
+	return hsum(acc);
+}
+
+} // namespace simd
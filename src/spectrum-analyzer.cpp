@@ -0,0 +1,354 @@
+#include "spectrum-analyzer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Time for a held peak to fall to 1/e
+#define PEAK_FALL_MS 1000.0f
+
+void AnalyzerConfig::SetBands(size_t count, float top_hz)
+{
+	float bin_hz = sample_rate / (float)decimation / (float)fft_size;
+	size_t end = (size_t)(top_hz / bin_hz);
+	if (end > fft_size / 2)
+		end = fft_size / 2;
+	size_t shown = end > 1 ? end - 1 : 0;
+	if (count > shown)
+		count = shown;
+	bands = count;
+	first_band_bin = 1;
+	band_bins = count > 0 ? shown / count : 0;
+}
+
+bool SpectrumAnalyzer::Configure(const AnalyzerConfig &new_config)
+{
+	config = new_config;
+	if (config.hop == 0)
+		config.hop = 1;
+	if (config.history < 2)
+		config.history = 2;
+	if (config.channels < 1)
+		config.channels = 1;
+	if (config.channels > FEATURE_MAX_CHANNELS)
+		config.channels = FEATURE_MAX_CHANNELS;
+
+	const size_t n = config.fft_size;
+	const size_t bins = n / 2;
+	const float spectra_per_second = config.sample_rate / (float)config.decimation / (float)config.hop;
+	const float pitch_rate = config.pitch ? config.sample_rate / (float)config.decimation : 0.0f;
+	pitch_hops = std::max((size_t)1, (size_t)(spectra_per_second * PITCH_INTERVAL_SECONDS + 0.5f));
+
+	// The bank's filters are about as wide as a band: a Hann window's main
+	// lobe is two bins of its length wide at half amplitude
+	block = 0;
+	size_t bands = 0;
+	size_t band_end = config.first_band_bin + config.bands * config.band_bins;
+	if (config.bands > 0 && config.band_bins > 0 && band_end <= bins) {
+		size_t length = 2 * n / config.band_bins;
+		if (GoertzelBank::Cheaper(config.bands, length, n)) {
+			block = length;
+			bands = config.bands;
+		}
+	}
+
+	size_t bytes = Arena::Footprint<float>(n) * 4 +                          // ring, window, work re/im
+		       Arena::Footprint<float>(bins) * 3 +                       // magnitudes, smoothed, peaks
+		       Arena::Footprint<float>(config.max_block) +               // decimator scratch
+		       Arena::Footprint<float>(SimpleFFT::TwiddleCount(n)) * 2 + // cos, sin
+		       Arena::Footprint<uint32_t>(SimpleFFT::BitrevCount(n)) +
+		       Arena::Footprint<float>(bins * config.history) + // published spectra
+		       Arena::Footprint<uint64_t>(config.history) +
+		       Arena::Footprint<AudioFeatures>(config.history) +
+		       Arena::Footprint<float>(BeatTracker::StorageCount(spectra_per_second)) +
+		       Arena::Footprint<float>(block) * 2 + // bank window and input
+		       Arena::Footprint<float>(bands) * 2 + Arena::Footprint<float>(GoertzelBank::StorageCount(bands)) +
+		       Arena::Footprint<float>(PitchTracker::StorageCount(pitch_rate)) +
+		       Arena::Footprint<uint32_t>(PitchTracker::BitrevCount(pitch_rate));
+
+	if (!arena.Reset(bytes))
+		return false;
+
+	ring = arena.Allocate<float>(n);
+	window = arena.Allocate<float>(n);
+	work_re = arena.Allocate<float>(n);
+	work_im = arena.Allocate<float>(n);
+	magnitudes = arena.Allocate<float>(bins);
+	smoothed = arena.Allocate<float>(bins);
+	peaks = arena.Allocate<float>(bins);
+	scratch = arena.Allocate<float>(config.max_block);
+	float *cos_table = arena.Allocate<float>(SimpleFFT::TwiddleCount(n));
+	float *sin_table = arena.Allocate<float>(SimpleFFT::TwiddleCount(n));
+	uint32_t *bitrev = arena.Allocate<uint32_t>(SimpleFFT::BitrevCount(n));
+	history = arena.Allocate<float>(bins * config.history);
+	history_time = arena.Allocate<uint64_t>(config.history);
+	history_features = arena.Allocate<AudioFeatures>(config.history);
+	beats.Init(spectra_per_second, arena.Allocate<float>(BeatTracker::StorageCount(spectra_per_second)));
+
+	fft.Init(n, cos_table, sin_table, bitrev);
+	kernels = config.reference_kernels ? &spectrum_kernels_reference() : &spectrum_kernels();
+
+	// Hann window
+	for (size_t i = 0; i < n; i++)
+		window[i] = 0.5f * (1.0f - cosf(2.0f * (float)M_PI * i / (n - 1)));
+
+	// Bank filters at the centre of each band. band_re holds their
+	// frequencies until the bank has taken its own copy.
+	block_window = arena.Allocate<float>(block);
+	block_in = arena.Allocate<float>(block);
+	band_re = arena.Allocate<float>(bands);
+	band_im = arena.Allocate<float>(bands);
+	for (size_t b = 0; b < bands; b++) {
+		size_t first = config.first_band_bin + b * config.band_bins;
+		band_re[b] = ((float)first + (float)(config.band_bins - 1) * 0.5f) / (float)n;
+	}
+	bank.Init(band_re, bands, arena.Allocate<float>(GoertzelBank::StorageCount(bands)));
+	for (size_t i = 0; i < block; i++)
+		block_window[i] = 0.5f * (1.0f - cosf(2.0f * (float)M_PI * i / (block - 1)));
+
+	float *pitch_storage = arena.Allocate<float>(PitchTracker::StorageCount(pitch_rate));
+	pitch.Init(pitch_rate, pitch_storage, arena.Allocate<uint32_t>(PitchTracker::BitrevCount(pitch_rate)));
+
+	decimator.SetFactor(config.decimation);
+	Reset();
+	return true;
+}
+
+void SpectrumAnalyzer::Reset()
+{
+	if (ring)
+		memset(ring, 0, config.fft_size * sizeof(float));
+	if (smoothed)
+		memset(smoothed, 0, NumBins() * sizeof(float));
+	if (magnitudes)
+		memset(magnitudes, 0, NumBins() * sizeof(float));
+	if (peaks)
+		memset(peaks, 0, NumBins() * sizeof(float));
+	memset(level_sum_sq, 0, sizeof(level_sum_sq));
+	memset(level_peak, 0, sizeof(level_peak));
+	level_count = 0;
+	features = {};
+	beats.Reset();
+	pitch.Reset();
+	pitch_hops_left = 0;
+	ring_pos = 0;
+	ring_fill = 0;
+	hop_left = config.hop;
+	primed = false;
+	published = 0;
+	decimator.SetFactor(config.decimation);
+}
+
+void SpectrumAnalyzer::SetTimeConstants(float attack_ms, float release_ms)
+{
+	// One-pole coefficient for a hop: the fraction of the old value left after hop seconds
+	float hop_ms = (float)config.hop * (float)config.decimation * 1000.0f / config.sample_rate;
+	attack_coeff = attack_ms > 0.0f ? expf(-hop_ms / attack_ms) : 0.0f;
+	release_coeff = release_ms > 0.0f ? expf(-hop_ms / release_ms) : 0.0f;
+	peak_coeff = expf(-hop_ms / PEAK_FALL_MS);
+}
+
+bool SpectrumAnalyzer::Process(const float *const *planes, size_t channels, size_t frames, uint64_t timestamp)
+{
+	if (!ring || frames == 0)
+		return false;
+
+	if (channels > config.channels)
+		channels = config.channels;
+	const float *samples = planes[0];
+	const size_t total = frames;
+	size_t metered = 0; // Input frames already in the level sums
+
+	const size_t n = config.fft_size;
+	const double ns_per_sample = 1e9 / (double)config.sample_rate;
+	const size_t factor = (size_t)decimator.GetFactor();
+	size_t consumed = 0; // Input frames before the current chunk
+	bool produced = false;
+
+	while (frames > 0) {
+		size_t chunk = frames;
+		const float *in = samples;
+		size_t chunk_start = consumed;
+
+		if (factor > 1) {
+			if (chunk > config.max_block)
+				chunk = config.max_block;
+			memcpy(scratch, samples, chunk * sizeof(float));
+			in = scratch;
+			samples += chunk;
+			frames -= chunk;
+			consumed += chunk;
+			chunk = decimator.Process(scratch, chunk);
+		} else {
+			samples += chunk;
+			frames = 0;
+			consumed += chunk;
+		}
+
+		// Sliding window: the ring always holds the latest fft_size samples,
+		// and a spectrum is taken every hop samples
+		size_t i = 0;
+		while (i < chunk) {
+			size_t take = chunk - i;
+			if (take > hop_left)
+				take = hop_left;
+
+			for (size_t k = 0; k < take; k++) {
+				ring[ring_pos] = in[i + k];
+				ring_pos = (ring_pos + 1) & (n - 1);
+			}
+			pitch.Push(in + i, take);
+			i += take;
+			hop_left -= take;
+			ring_fill = ring_fill + take < n ? ring_fill + take : n;
+
+			if (hop_left == 0) {
+				hop_left = config.hop;
+				if (ring_fill == n) {
+					// Stamp with the input time of the newest sample in the window
+					size_t end = chunk_start + i * factor;
+					if (end > total)
+						end = total;
+					Meter(planes, channels, metered, end);
+					metered = end > metered ? end : metered;
+					Analyze(timestamp + (uint64_t)((double)end * ns_per_sample));
+					produced = true;
+				}
+			}
+		}
+	}
+
+	Meter(planes, channels, metered, total);
+	return produced;
+}
+
+// Adds input frames [from, to) to the per-channel level sums
+void SpectrumAnalyzer::Meter(const float *const *planes, size_t channels, size_t from, size_t to)
+{
+	if (to <= from)
+		return;
+	for (size_t c = 0; c < channels; c++) {
+		const float *in = planes[c];
+		float sum = 0.0f;
+		float peak = level_peak[c];
+		for (size_t i = from; i < to; i++) {
+			float a = fabsf(in[i]);
+			peak = a > peak ? a : peak;
+			sum += in[i] * in[i];
+		}
+		level_sum_sq[c] += sum;
+		level_peak[c] = peak;
+	}
+	features.channels = (uint32_t)channels;
+	level_count += to - from;
+}
+
+void SpectrumAnalyzer::Analyze(uint64_t timestamp)
+{
+	const size_t n = config.fft_size;
+	const size_t bins = NumBins();
+
+	if (UsesBank()) {
+		// Newest `block` samples through their window, then each band's
+		// value into all of its bins
+		size_t start = (ring_pos + n - block) & (n - 1);
+		size_t first = n - start < block ? n - start : block;
+		kernels->window(ring + start, block_window, block_in, first);
+		kernels->window(ring, block_window + first, block_in + first, block - first);
+		bank.Run(block_in, block, band_re, band_im);
+
+		memset(work_re, 0, bins * sizeof(float));
+		memset(work_im, 0, bins * sizeof(float));
+		for (size_t b = 0; b < bank.Bands(); b++) {
+			size_t from = config.first_band_bin + b * config.band_bins;
+			for (size_t i = from; i < from + config.band_bins; i++) {
+				work_re[i] = band_re[b];
+				work_im[i] = band_im[b];
+			}
+		}
+	} else {
+		// Unroll the ring (oldest first) through the window
+		size_t tail = n - ring_pos;
+		kernels->window(ring + ring_pos, window, work_re, tail);
+		kernels->window(ring, window + tail, work_re + tail, ring_pos);
+		memset(work_im, 0, n * sizeof(float));
+
+		fft.Forward(work_re, work_im);
+	}
+
+	// One pass over the FFT output: magnitude, flux against the previous
+	// magnitude still in place, centroid sums, smoothing and peak hold
+	SpectrumPass pass = {work_re, work_im, magnitudes, smoothed, peaks, bins, attack_coeff, release_coeff,
+			     peak_coeff, primed};
+	SpectrumSums sums = kernels->spectrum(pass);
+	primed = true;
+
+	if (pitch_hops_left == 0) {
+		pitch.Estimate(features);
+		pitch_hops_left = pitch_hops;
+	}
+	pitch_hops_left--;
+	FinishFeatures(sums.flux, sums.weighted, sums.total);
+	PublishSmoothed(timestamp);
+}
+
+// Levels since the last spectrum plus the spectral sums, then onset/beat tracking
+void SpectrumAnalyzer::FinishFeatures(float flux, float weighted, float total)
+{
+	if (level_count > 0) {
+		for (uint32_t c = 0; c < features.channels; c++) {
+			features.rms[c] = sqrtf(level_sum_sq[c] / (float)level_count);
+			features.peak[c] = level_peak[c];
+			level_sum_sq[c] = 0.0f;
+			level_peak[c] = 0.0f;
+		}
+		level_count = 0;
+	}
+
+	float bin_hz = config.sample_rate / (float)config.decimation / (float)config.fft_size;
+	features.centroid_hz = total > 0.0f ? weighted / total * bin_hz : 0.0f;
+	features.flux = total > 0.0f ? flux / total : 0.0f;
+	beats.Process(features.flux, features);
+}
+
+void SpectrumAnalyzer::Publish(const float *bands, size_t count, uint64_t timestamp)
+{
+	if (!smoothed)
+		return;
+
+	const size_t bins = NumBins();
+	if (count > bins)
+		count = bins;
+	// The bands stand in for the magnitudes; there are no samples to meter
+	float flux = 0.0f;
+	float weighted = 0.0f;
+	float sum = 0.0f;
+	for (size_t i = 0; i < count; i++) {
+		float m = bands[i];
+		float rise = m - magnitudes[i];
+		flux += rise > 0.0f ? rise : 0.0f;
+		magnitudes[i] = m;
+		smoothed[i] = m;
+		peaks[i] = m > peaks[i] * peak_coeff ? m : peaks[i] * peak_coeff;
+		weighted += m * (float)i;
+		sum += m;
+	}
+	memset(smoothed + count, 0, (bins - count) * sizeof(float));
+	memset(magnitudes + count, 0, (bins - count) * sizeof(float));
+	memset(peaks + count, 0, (bins - count) * sizeof(float));
+	primed = true;
+
+	features.channels = 0;
+	features.pitch_hz = 0.0f;
+	features.pitch_confidence = 0.0f;
+	FinishFeatures(flux, weighted, sum);
+	PublishSmoothed(timestamp);
+}
+
+void SpectrumAnalyzer::PublishSmoothed(uint64_t timestamp)
+{
+	size_t slot = (size_t)(published % config.history);
+	memcpy(history + slot * NumBins(), smoothed, NumBins() * sizeof(float));
+	history_time[slot] = timestamp;
+	history_features[slot] = features;
+	published++;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "arena.hpp"
+#include "audio-features.hpp"
+#include "decimator.hpp"
+#include "fft-utils.hpp"
+#include "goertzel-bank.hpp"
+#include "pitch-tracker.hpp"
+#include "spectrum-kernels.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Mono spectrum analysis: decimation, input ring, Hann window, FFT,
+// magnitude and temporal smoothing. Has no OBS dependencies so it can be
+// driven outside the plugin as well.
+//
+// A spectrum is computed every `hop` analysis-rate samples, regardless of
+// how the input is split into blocks, and smoothed with attack/release time
+// constants so the decay doesn't depend on block size or sample rate. Each
+// result is published with the timestamp of its newest sample into a short
+// history that the renderer interpolates between.
+//
+// Scalar features (per-channel levels, centroid, flux, onsets, beats and
+// tempo, see audio-features.hpp) are published with every spectrum. The
+// spectral ones come from the same pass over the FFT output as the
+// magnitudes and smoothing. That pass, and the windowing before the FFT,
+// run through the SIMD kernels in spectrum-kernels.hpp. With
+// AnalyzerConfig::pitch set, the pitch of the analysed channel and how sure
+// the tracker is of it go out with each spectrum too (pitch-tracker.hpp),
+// estimated every PITCH_INTERVAL_SECONDS worth of spectra and held between.
+//
+// When only a few bands are shown (AnalyzerConfig::bands), a Goertzel bank
+// evaluates each at its centre instead, if that is cheaper than the FFT.
+// Each band's value then fills all of its bins and the bins outside the
+// bands stay at zero, so the published spectra keep the FFT's layout. The
+// bank's window is two bands' width of samples long, which makes a tone at
+// a band centre read the same as the mean of the FFT bins it covers. Noise
+// reads lower, by about the square root of half the bins in a band.
+//
+// All working storage is carved from one arena in Configure(); Process()
+// never allocates. Nothing points into the object itself, so an analyzer can
+// be configured aside and moved into place without allocating.
+
+struct AnalyzerConfig {
+	size_t fft_size = 2048;
+	int decimation = 1;           // 1, 2, 4 or 8
+	size_t max_block = 4096;      // Largest input chunk decimated at once
+	float sample_rate = 48000.0f; // Input rate, before decimation
+	size_t hop = 512;             // Analysis-rate samples between spectra
+	size_t history = 16;          // Published spectra kept for interpolation
+	size_t channels = 1;          // Channels metered, up to FEATURE_MAX_CHANNELS
+	bool reference_kernels = false; // Scalar kernels only, for comparison
+	bool pitch = false;             // Track the fundamental
+
+	// Shown bands, if few: `bands` runs of `band_bins` FFT bins from `first_band_bin`
+	size_t bands = 0;
+	size_t first_band_bin = 1;
+	size_t band_bins = 0;
+
+	// Splits the bins from 1 up to `top_hz` into `count` equal bands, the
+	// way the bar modes do, leaving over any remainder
+	void SetBands(size_t count, float top_hz);
+};
+
+class SpectrumAnalyzer {
+public:
+	// Allocates; call from a non-realtime thread
+	bool Configure(const AnalyzerConfig &config);
+
+	// Clears history without touching the layout
+	void Reset();
+
+	// Smoothing per direction, 0 ms follows the input directly
+	void SetTimeConstants(float attack_ms, float release_ms);
+
+	// Feeds planar samples, `timestamp` (ns) being the time of the first
+	// frame. The first plane is analysed, all of them are metered. Returns
+	// true when at least one new spectrum was published.
+	bool Process(const float *const *planes, size_t channels, size_t frames, uint64_t timestamp);
+	bool Process(const float *samples, size_t frames, uint64_t timestamp)
+	{
+		return Process(&samples, 1, frames, timestamp);
+	}
+
+	// Publishes an externally produced spectrum (e.g. a recording) as is
+	void Publish(const float *bands, size_t count, uint64_t timestamp);
+
+	const AnalyzerConfig &Config() const { return config; }
+	size_t NumBins() const { return config.fft_size / 2; }
+
+	// Latest raw and smoothed magnitudes (NumBins() entries)
+	ArenaSpan<float> Magnitudes() const { return {magnitudes, NumBins()}; }
+	ArenaSpan<float> Smoothed() const { return {smoothed, NumBins()}; }
+	// Peak hold of the smoothed magnitudes, falling off over PEAK_FALL_MS
+	ArenaSpan<float> Peaks() const { return {peaks, NumBins()}; }
+	const SpectrumKernels &Kernels() const { return *kernels; }
+	// Whether the Goertzel bank stands in for the FFT, and the samples each
+	// spectrum is taken over
+	bool UsesBank() const { return bank.Bands() > 0; }
+	size_t WindowSize() const { return UsesBank() ? block : config.fft_size; }
+
+	// Published spectra are numbered from 0; the last config.history of
+	// them, [OldestFrame(), Published()), can still be read.
+	uint64_t Published() const { return published; }
+	uint64_t OldestFrame() const { return published > config.history ? published - config.history : 0; }
+	ArenaSpan<float> Frame(uint64_t index) const
+	{
+		return {history + (size_t)(index % config.history) * NumBins(), NumBins()};
+	}
+	uint64_t FrameTime(uint64_t index) const { return history_time[index % config.history]; }
+	const AudioFeatures &Features(uint64_t index) const { return history_features[index % config.history]; }
+
+	size_t ArenaBytes() const { return arena.Capacity(); }
+
+private:
+	void Analyze(uint64_t timestamp);
+	void Meter(const float *const *planes, size_t channels, size_t from, size_t to);
+	void FinishFeatures(float flux, float weighted, float total);
+	void PublishSmoothed(uint64_t timestamp);
+
+	AnalyzerConfig config;
+	Arena arena;
+	PolyphaseDecimator decimator;
+	SimpleFFT fft;
+	GoertzelBank bank;
+	PitchTracker pitch;
+	size_t block = 0;              // Bank input length
+	float *block_window = nullptr; // Hann window over it
+	float *block_in = nullptr;
+	float *band_re = nullptr;
+	float *band_im = nullptr;
+
+	float *ring = nullptr; // Last fft_size input samples
+	size_t ring_pos = 0;   // Next write position (oldest sample)
+	size_t ring_fill = 0;
+	size_t hop_left = 0;     // Samples until the next spectrum is due
+	float *window = nullptr; // Hann window, computed once
+	float *work_re = nullptr;
+	float *work_im = nullptr;
+	float *magnitudes = nullptr;
+	float *smoothed = nullptr;
+	float *peaks = nullptr;
+	float *scratch = nullptr; // Decimator input, max_block samples
+	bool primed = false;      // smoothed holds a real spectrum
+
+	// Per-hop smoothing coefficients (weight kept from the previous spectrum)
+	float attack_coeff = 0.0f;
+	float release_coeff = 0.0f;
+	float peak_coeff = 0.0f;
+	const SpectrumKernels *kernels = &spectrum_kernels_reference();
+
+	// Levels since the last spectrum, per channel
+	float level_sum_sq[FEATURE_MAX_CHANNELS] = {};
+	float level_peak[FEATURE_MAX_CHANNELS] = {};
+	size_t level_count = 0;
+	BeatTracker beats;
+	size_t pitch_hops = 1;       // Spectra per pitch estimate
+	size_t pitch_hops_left = 0;  // Until the next one
+	AudioFeatures features = {}; // Of the spectrum being published
+
+	float *history = nullptr;         // config.history x NumBins()
+	uint64_t *history_time = nullptr; // Timestamp of each published spectrum
+	AudioFeatures *history_features = nullptr;
+	uint64_t published = 0;
+};
@@ -0,0 +1,519 @@
+#include "spectrum-kernels.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define KERNELS_X86 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KERNELS_SSE 1
+#endif
+#define KERNELS_AVX2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define KERNELS_NEON 1
+#endif
+
+// 10 log10(2): dB per octave of power
+#define DB_PER_LOG2 3.0102999566f
+// Power floor so log never sees zero (-300 dB)
+#define MIN_POWER 1e-30f
+
+// Self-check tolerances
+#define CHECK_BINS 1027 // Odd, so every tail path runs
+#define CHECK_RELATIVE 1e-5f
+#define CHECK_SUM_RELATIVE 1e-4f
+#define CHECK_DB 1e-3f
+
+// Scalar reference
+
+static void window_scalar(const float *in, const float *window, float *out, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		out[i] = in[i] * window[i];
+}
+
+// One bin of the spectrum pass; also finishes the vector versions' tails
+static inline void spectrum_bin(const SpectrumPass &p, size_t i, SpectrumSums &sums)
+{
+	float m = sqrtf(p.re[i] * p.re[i] + p.im[i] * p.im[i]);
+	float rise = m - p.magnitudes[i];
+	sums.flux += rise > 0.0f ? rise : 0.0f;
+	p.magnitudes[i] = m;
+	sums.weighted += m * (float)i;
+	sums.total += m;
+
+	// Attack while a bin rises, release while it falls
+	float s = p.primed ? p.smoothed[i] : m;
+	float coeff = m > s ? p.attack_coeff : p.release_coeff;
+	float smoothed = m + (s - m) * coeff;
+	p.smoothed[i] = smoothed;
+
+	if (p.peaks) {
+		float held = p.peaks[i] * p.peak_decay;
+		p.peaks[i] = smoothed > held ? smoothed : held;
+	}
+}
+
+static SpectrumSums spectrum_scalar(const SpectrumPass &p)
+{
+	SpectrumSums sums = {0.0f, 0.0f, 0.0f};
+	for (size_t i = 0; i < p.bins; i++)
+		spectrum_bin(p, i, sums);
+	return sums;
+}
+
+static void to_db_scalar(const float *magnitude, float *db, size_t n, float floor_db)
+{
+	for (size_t i = 0; i < n; i++) {
+		float power = magnitude[i] * magnitude[i];
+		float value = 10.0f * log10f(power > MIN_POWER ? power : MIN_POWER);
+		db[i] = value > floor_db ? value : floor_db;
+	}
+}
+
+static const SpectrumKernels reference_kernels = {"scalar", window_scalar, spectrum_scalar, to_db_scalar};
+
+// log2 for the vector versions: exponent plus a series for the mantissa.
+// With m in [1, 2), t = (m - 1) / (m + 1) is below 1/3 and
+// ln m = 2 (t + t^3/3 + t^5/5 + t^7/7 + t^9/9) is good to ~1e-6.
+#define LOG_C3 (1.0f / 3.0f)
+#define LOG_C5 (1.0f / 5.0f)
+#define LOG_C7 (1.0f / 7.0f)
+#define LOG_C9 (1.0f / 9.0f)
+#define TWO_OVER_LN2 2.8853900818f
+
+#if defined(KERNELS_SSE)
+
+static inline float hsum_sse(__m128 v)
+{
+	__m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 sums = _mm_add_ps(v, shuf);
+	shuf = _mm_movehl_ps(shuf, sums);
+	return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+}
+
+static void window_sse(const float *in, const float *window, float *out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(in + i), _mm_loadu_ps(window + i)));
+	for (; i < n; i++)
+		out[i] = in[i] * window[i];
+}
+
+static SpectrumSums spectrum_sse(const SpectrumPass &p)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 four = _mm_set1_ps(4.0f);
+	const __m128 attack = _mm_set1_ps(p.attack_coeff);
+	const __m128 release = _mm_set1_ps(p.release_coeff);
+	const __m128 decay = _mm_set1_ps(p.peak_decay);
+	__m128 flux = zero, weighted = zero, total = zero;
+	__m128 index = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+	size_t i = 0;
+	for (; i + 4 <= p.bins; i += 4) {
+		__m128 re = _mm_loadu_ps(p.re + i);
+		__m128 im = _mm_loadu_ps(p.im + i);
+		__m128 m = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im)));
+
+		flux = _mm_add_ps(flux, _mm_max_ps(_mm_sub_ps(m, _mm_loadu_ps(p.magnitudes + i)), zero));
+		_mm_storeu_ps(p.magnitudes + i, m);
+		weighted = _mm_add_ps(weighted, _mm_mul_ps(m, index));
+		total = _mm_add_ps(total, m);
+		index = _mm_add_ps(index, four);
+
+		__m128 s = p.primed ? _mm_loadu_ps(p.smoothed + i) : m;
+		__m128 rising = _mm_cmpgt_ps(m, s);
+		__m128 coeff = _mm_or_ps(_mm_and_ps(rising, attack), _mm_andnot_ps(rising, release));
+		__m128 smoothed = _mm_add_ps(m, _mm_mul_ps(_mm_sub_ps(s, m), coeff));
+		_mm_storeu_ps(p.smoothed + i, smoothed);
+
+		if (p.peaks)
+			_mm_storeu_ps(p.peaks + i, _mm_max_ps(smoothed, _mm_mul_ps(_mm_loadu_ps(p.peaks + i), decay)));
+	}
+
+	SpectrumSums sums = {hsum_sse(flux), hsum_sse(weighted), hsum_sse(total)};
+	for (; i < p.bins; i++)
+		spectrum_bin(p, i, sums);
+	return sums;
+}
+
+static inline __m128 log2_sse(__m128 x)
+{
+	__m128i bits = _mm_castps_si128(x);
+	__m128 exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+	__m128 mantissa = _mm_castsi128_ps(
+		_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+	const __m128 one = _mm_set1_ps(1.0f);
+	__m128 t = _mm_div_ps(_mm_sub_ps(mantissa, one), _mm_add_ps(mantissa, one));
+	__m128 t2 = _mm_mul_ps(t, t);
+	__m128 series = _mm_add_ps(_mm_mul_ps(t2, _mm_set1_ps(LOG_C9)), _mm_set1_ps(LOG_C7));
+	series = _mm_add_ps(_mm_mul_ps(t2, series), _mm_set1_ps(LOG_C5));
+	series = _mm_add_ps(_mm_mul_ps(t2, series), _mm_set1_ps(LOG_C3));
+	series = _mm_add_ps(_mm_mul_ps(t2, series), one);
+	return _mm_add_ps(exponent, _mm_mul_ps(_mm_mul_ps(t, series), _mm_set1_ps(TWO_OVER_LN2)));
+}
+
+static void to_db_sse(const float *magnitude, float *db, size_t n, float floor_db)
+{
+	const __m128 min_power = _mm_set1_ps(MIN_POWER);
+	const __m128 scale = _mm_set1_ps(DB_PER_LOG2);
+	const __m128 floor = _mm_set1_ps(floor_db);
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 m = _mm_loadu_ps(magnitude + i);
+		__m128 power = _mm_max_ps(_mm_mul_ps(m, m), min_power);
+		_mm_storeu_ps(db + i, _mm_max_ps(_mm_mul_ps(log2_sse(power), scale), floor));
+	}
+	to_db_scalar(magnitude + i, db + i, n - i, floor_db);
+}
+
+static const SpectrumKernels sse_kernels = {"sse2", window_sse, spectrum_sse, to_db_sse};
+
+#endif
+
+#if defined(KERNELS_AVX2)
+
+AVX2_TARGET static inline float hsum_avx(__m256 v)
+{
+	__m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	__m128 shuf = _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(2, 3, 0, 1));
+	sum = _mm_add_ps(sum, shuf);
+	shuf = _mm_movehl_ps(shuf, sum);
+	return _mm_cvtss_f32(_mm_add_ss(sum, shuf));
+}
+
+AVX2_TARGET static void window_avx2(const float *in, const float *window, float *out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+		_mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(in + i), _mm256_loadu_ps(window + i)));
+	for (; i < n; i++)
+		out[i] = in[i] * window[i];
+}
+
+AVX2_TARGET static SpectrumSums spectrum_avx2(const SpectrumPass &p)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 eight = _mm256_set1_ps(8.0f);
+	const __m256 attack = _mm256_set1_ps(p.attack_coeff);
+	const __m256 release = _mm256_set1_ps(p.release_coeff);
+	const __m256 decay = _mm256_set1_ps(p.peak_decay);
+	__m256 flux = zero, weighted = zero, total = zero;
+	__m256 index = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+
+	size_t i = 0;
+	for (; i + 8 <= p.bins; i += 8) {
+		__m256 re = _mm256_loadu_ps(p.re + i);
+		__m256 im = _mm256_loadu_ps(p.im + i);
+		__m256 m = _mm256_sqrt_ps(_mm256_fmadd_ps(re, re, _mm256_mul_ps(im, im)));
+
+		flux = _mm256_add_ps(flux, _mm256_max_ps(_mm256_sub_ps(m, _mm256_loadu_ps(p.magnitudes + i)), zero));
+		_mm256_storeu_ps(p.magnitudes + i, m);
+		weighted = _mm256_fmadd_ps(m, index, weighted);
+		total = _mm256_add_ps(total, m);
+		index = _mm256_add_ps(index, eight);
+
+		__m256 s = p.primed ? _mm256_loadu_ps(p.smoothed + i) : m;
+		__m256 coeff = _mm256_blendv_ps(release, attack, _mm256_cmp_ps(m, s, _CMP_GT_OQ));
+		__m256 smoothed = _mm256_fmadd_ps(_mm256_sub_ps(s, m), coeff, m);
+		_mm256_storeu_ps(p.smoothed + i, smoothed);
+
+		if (p.peaks)
+			_mm256_storeu_ps(p.peaks + i,
+					 _mm256_max_ps(smoothed, _mm256_mul_ps(_mm256_loadu_ps(p.peaks + i), decay)));
+	}
+
+	SpectrumSums sums = {hsum_avx(flux), hsum_avx(weighted), hsum_avx(total)};
+	for (; i < p.bins; i++)
+		spectrum_bin(p, i, sums);
+	return sums;
+}
+
+AVX2_TARGET static inline __m256 log2_avx2(__m256 x)
+{
+	__m256i bits = _mm256_castps_si256(x);
+	__m256 exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+	__m256 mantissa = _mm256_castsi256_ps(
+		_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F800000)));
+	const __m256 one = _mm256_set1_ps(1.0f);
+	__m256 t = _mm256_div_ps(_mm256_sub_ps(mantissa, one), _mm256_add_ps(mantissa, one));
+	__m256 t2 = _mm256_mul_ps(t, t);
+	__m256 series = _mm256_fmadd_ps(t2, _mm256_set1_ps(LOG_C9), _mm256_set1_ps(LOG_C7));
+	series = _mm256_fmadd_ps(t2, series, _mm256_set1_ps(LOG_C5));
+	series = _mm256_fmadd_ps(t2, series, _mm256_set1_ps(LOG_C3));
+	series = _mm256_fmadd_ps(t2, series, one);
+	return _mm256_fmadd_ps(_mm256_mul_ps(t, series), _mm256_set1_ps(TWO_OVER_LN2), exponent);
+}
+
+AVX2_TARGET static void to_db_avx2(const float *magnitude, float *db, size_t n, float floor_db)
+{
+	const __m256 min_power = _mm256_set1_ps(MIN_POWER);
+	const __m256 scale = _mm256_set1_ps(DB_PER_LOG2);
+	const __m256 floor = _mm256_set1_ps(floor_db);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 m = _mm256_loadu_ps(magnitude + i);
+		__m256 power = _mm256_max_ps(_mm256_mul_ps(m, m), min_power);
+		_mm256_storeu_ps(db + i, _mm256_max_ps(_mm256_mul_ps(log2_avx2(power), scale), floor));
+	}
+	to_db_scalar(magnitude + i, db + i, n - i, floor_db);
+}
+
+static const SpectrumKernels avx2_kernels = {"avx2", window_avx2, spectrum_avx2, to_db_avx2};
+
+static bool cpu_has_avx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuid(info, 1);
+	bool fma = (info[2] & (1 << 12)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	if (!fma || !osxsave || (_xgetbv(0) & 6) != 6) // OS saves the YMM state
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+#endif
+
+#if defined(KERNELS_NEON)
+
+static void window_neon(const float *in, const float *window, float *out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		vst1q_f32(out + i, vmulq_f32(vld1q_f32(in + i), vld1q_f32(window + i)));
+	for (; i < n; i++)
+		out[i] = in[i] * window[i];
+}
+
+static SpectrumSums spectrum_neon(const SpectrumPass &p)
+{
+	const float32x4_t zero = vdupq_n_f32(0.0f);
+	const float32x4_t four = vdupq_n_f32(4.0f);
+	const float32x4_t attack = vdupq_n_f32(p.attack_coeff);
+	const float32x4_t release = vdupq_n_f32(p.release_coeff);
+	const float32x4_t decay = vdupq_n_f32(p.peak_decay);
+	float32x4_t flux = zero, weighted = zero, total = zero;
+	const float start[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+	float32x4_t index = vld1q_f32(start);
+
+	size_t i = 0;
+	for (; i + 4 <= p.bins; i += 4) {
+		float32x4_t re = vld1q_f32(p.re + i);
+		float32x4_t im = vld1q_f32(p.im + i);
+		float32x4_t m = vsqrtq_f32(vmlaq_f32(vmulq_f32(im, im), re, re));
+
+		flux = vaddq_f32(flux, vmaxq_f32(vsubq_f32(m, vld1q_f32(p.magnitudes + i)), zero));
+		vst1q_f32(p.magnitudes + i, m);
+		weighted = vmlaq_f32(weighted, m, index);
+		total = vaddq_f32(total, m);
+		index = vaddq_f32(index, four);
+
+		float32x4_t s = p.primed ? vld1q_f32(p.smoothed + i) : m;
+		float32x4_t coeff = vbslq_f32(vcgtq_f32(m, s), attack, release);
+		float32x4_t smoothed = vmlaq_f32(m, vsubq_f32(s, m), coeff);
+		vst1q_f32(p.smoothed + i, smoothed);
+
+		if (p.peaks)
+			vst1q_f32(p.peaks + i, vmaxq_f32(smoothed, vmulq_f32(vld1q_f32(p.peaks + i), decay)));
+	}
+
+	SpectrumSums sums = {vaddvq_f32(flux), vaddvq_f32(weighted), vaddvq_f32(total)};
+	for (; i < p.bins; i++)
+		spectrum_bin(p, i, sums);
+	return sums;
+}
+
+static inline float32x4_t log2_neon(float32x4_t x)
+{
+	uint32x4_t bits = vreinterpretq_u32_f32(x);
+	float32x4_t exponent =
+		vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(127)));
+	float32x4_t mantissa = vreinterpretq_f32_u32(
+		vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x007FFFFF)), vdupq_n_u32(0x3F800000)));
+	const float32x4_t one = vdupq_n_f32(1.0f);
+	float32x4_t t = vdivq_f32(vsubq_f32(mantissa, one), vaddq_f32(mantissa, one));
+	float32x4_t t2 = vmulq_f32(t, t);
+	float32x4_t series = vmlaq_f32(vdupq_n_f32(LOG_C7), t2, vdupq_n_f32(LOG_C9));
+	series = vmlaq_f32(vdupq_n_f32(LOG_C5), t2, series);
+	series = vmlaq_f32(vdupq_n_f32(LOG_C3), t2, series);
+	series = vmlaq_f32(one, t2, series);
+	return vmlaq_f32(exponent, vmulq_f32(t, series), vdupq_n_f32(TWO_OVER_LN2));
+}
+
+static void to_db_neon(const float *magnitude, float *db, size_t n, float floor_db)
+{
+	const float32x4_t min_power = vdupq_n_f32(MIN_POWER);
+	const float32x4_t scale = vdupq_n_f32(DB_PER_LOG2);
+	const float32x4_t floor = vdupq_n_f32(floor_db);
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		float32x4_t m = vld1q_f32(magnitude + i);
+		float32x4_t power = vmaxq_f32(vmulq_f32(m, m), min_power);
+		vst1q_f32(db + i, vmaxq_f32(vmulq_f32(log2_neon(power), scale), floor));
+	}
+	to_db_scalar(magnitude + i, db + i, n - i, floor_db);
+}
+
+static const SpectrumKernels neon_kernels = {"neon", window_neon, spectrum_neon, to_db_neon};
+
+#endif
+
+// Self-check
+
+static bool close_enough(float a, float b, float relative)
+{
+	float scale = fabsf(a) > fabsf(b) ? fabsf(a) : fabsf(b);
+	return fabsf(a - b) <= relative * (scale > 1.0f ? scale : 1.0f);
+}
+
+bool spectrum_kernels_check(const SpectrumKernels &kernels, char *error, size_t size)
+{
+	const size_t n = CHECK_BINS;
+	std::vector<float> re(n), im(n), window(n), prev(n), smooth(n), peaks(n);
+
+	// Deterministic pseudo-random spectrum with silent bins and a wide range
+	uint32_t seed = 0x9E3779B9u;
+	auto next = [&]() {
+		seed = seed * 1664525u + 1013904223u;
+		return (float)(seed >> 8) / (float)(1u << 24) * 2.0f - 1.0f;
+	};
+	for (size_t i = 0; i < n; i++) {
+		float scale = powf(10.0f, 3.0f * next());
+		re[i] = i % 17 == 0 ? 0.0f : next() * scale;
+		im[i] = i % 17 == 0 ? 0.0f : next() * scale;
+		window[i] = 0.5f + 0.5f * next();
+		prev[i] = fabsf(next()) * scale;
+		smooth[i] = fabsf(next()) * scale;
+		peaks[i] = fabsf(next()) * scale * 2.0f;
+	}
+
+	auto fail = [&](const char *what, size_t i, float got, float want) {
+		if (error && size)
+			snprintf(error, size, "%s: %s[%zu] is %g, reference %g", kernels.name, what, i, got, want);
+		return false;
+	};
+
+	const SpectrumKernels &ref = reference_kernels;
+	std::vector<float> out(n), expected(n);
+
+	kernels.window(re.data(), window.data(), out.data(), n);
+	ref.window(re.data(), window.data(), expected.data(), n);
+	for (size_t i = 0; i < n; i++) {
+		if (!close_enough(out[i], expected[i], CHECK_RELATIVE))
+			return fail("window", i, out[i], expected[i]);
+	}
+
+	for (int primed = 0; primed < 2; primed++) {
+		std::vector<float> mag_a = prev, mag_b = prev, smooth_a = smooth, smooth_b = smooth;
+		std::vector<float> peaks_a = peaks, peaks_b = peaks;
+		SpectrumPass pass = {re.data(), im.data(), mag_a.data(), smooth_a.data(), peaks_a.data(), n, 0.7f, 0.95f,
+				     0.98f, primed != 0};
+		SpectrumSums got = kernels.spectrum(pass);
+		pass.magnitudes = mag_b.data();
+		pass.smoothed = smooth_b.data();
+		pass.peaks = peaks_b.data();
+		SpectrumSums want = ref.spectrum(pass);
+
+		for (size_t i = 0; i < n; i++) {
+			if (!close_enough(mag_a[i], mag_b[i], CHECK_RELATIVE))
+				return fail("magnitude", i, mag_a[i], mag_b[i]);
+			if (!close_enough(smooth_a[i], smooth_b[i], CHECK_RELATIVE))
+				return fail("smoothed", i, smooth_a[i], smooth_b[i]);
+			if (!close_enough(peaks_a[i], peaks_b[i], CHECK_RELATIVE))
+				return fail("peak", i, peaks_a[i], peaks_b[i]);
+		}
+		if (!close_enough(got.flux, want.flux, CHECK_SUM_RELATIVE))
+			return fail("flux", 0, got.flux, want.flux);
+		if (!close_enough(got.weighted, want.weighted, CHECK_SUM_RELATIVE))
+			return fail("weighted", 0, got.weighted, want.weighted);
+		if (!close_enough(got.total, want.total, CHECK_SUM_RELATIVE))
+			return fail("total", 0, got.total, want.total);
+	}
+
+	kernels.to_db(re.data(), out.data(), n, -200.0f);
+	ref.to_db(re.data(), expected.data(), n, -200.0f);
+	for (size_t i = 0; i < n; i++) {
+		if (fabsf(out[i] - expected[i]) > CHECK_DB)
+			return fail("dB", i, out[i], expected[i]);
+	}
+	return true;
+}
+
+// Selection
+
+#define MAX_CANDIDATES 3
+
+size_t spectrum_kernels_candidates(const SpectrumKernels **out, size_t max)
+{
+	const SpectrumKernels *candidates[MAX_CANDIDATES] = {};
+	size_t count = 0;
+#if defined(KERNELS_AVX2)
+	if (cpu_has_avx2())
+		candidates[count++] = &avx2_kernels;
+#endif
+#if defined(KERNELS_SSE)
+	candidates[count++] = &sse_kernels;
+#endif
+#if defined(KERNELS_NEON)
+	candidates[count++] = &neon_kernels;
+#endif
+	for (size_t i = 0; i < count && i < max; i++)
+		out[i] = candidates[i];
+	return count;
+}
+
+// Reasons for the candidates select_kernels() passed over, written once
+// before spectrum_kernels() returns for the first time
+static char rejections[MAX_CANDIDATES][256];
+static size_t rejection_count = 0;
+
+static const SpectrumKernels *select_kernels()
+{
+	const SpectrumKernels *candidates[MAX_CANDIDATES];
+	size_t count = spectrum_kernels_candidates(candidates, MAX_CANDIDATES);
+	for (size_t i = 0; i < count; i++) {
+		char *error = rejections[rejection_count];
+		if (spectrum_kernels_check(*candidates[i], error, sizeof(rejections[0])))
+			return candidates[i];
+		rejection_count++;
+	}
+	return &reference_kernels;
+}
+
+const char *spectrum_kernels_rejected(size_t index)
+{
+	spectrum_kernels();
+	return index < rejection_count ? rejections[index] : nullptr;
+}
+
+const SpectrumKernels &spectrum_kernels()
+{
+	static const SpectrumKernels *selected = select_kernels();
+	return *selected;
+}
+
+const SpectrumKernels &spectrum_kernels_reference()
+{
+	return reference_kernels;
+}
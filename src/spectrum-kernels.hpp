@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+
+// Post-FFT kernels
+// Windowing, the fused magnitude / flux / centroid / smoothing / peak-hold
+// pass, and magnitude to dB. Each has a scalar reference and SSE, AVX2 and
+// NEON versions. The fastest one the CPU supports is picked once, and only
+// after it has matched the reference on synthetic data.
+
+struct SpectrumPass {
+	const float *re;
+	const float *im;
+	float *magnitudes; // In: previous magnitudes (for flux); out: new ones
+	float *smoothed;
+	float *peaks; // Peak hold of the smoothed spectrum, may be null
+	size_t bins;
+	float attack_coeff; // Weight kept from the previous value while rising
+	float release_coeff;
+	float peak_decay; // Per-spectrum factor on the held peak
+	bool primed;      // smoothed holds a previous spectrum
+};
+
+struct SpectrumSums {
+	float flux;     // Sum of magnitude rises
+	float weighted; // Sum of magnitude * bin index
+	float total;    // Sum of magnitudes
+};
+
+struct SpectrumKernels {
+	const char *name;
+	// out[i] = in[i] * window[i]
+	void (*window)(const float *in, const float *window, float *out, size_t n);
+	SpectrumSums (*spectrum)(const SpectrumPass &pass);
+	// 20 log10(magnitude), computed as 10 log10 of its square; never below floor_db
+	void (*to_db)(const float *magnitude, float *db, size_t n, float floor_db);
+};
+
+// Fastest verified implementation for this CPU. Selection, including the
+// self-check, happens on the first call; make that from a non-realtime thread.
+const SpectrumKernels &spectrum_kernels();
+
+// Scalar reference
+const SpectrumKernels &spectrum_kernels_reference();
+
+// Runs `kernels` against the reference on synthetic data. On a mismatch,
+// returns false and describes it in `error` (may be null).
+bool spectrum_kernels_check(const SpectrumKernels &kernels, char *error, size_t size);
+
+// The SIMD implementations compiled in that this CPU can run, fastest first
+// and unchecked. Fills up to `max` of `out` and returns how many there are.
+size_t spectrum_kernels_candidates(const SpectrumKernels **out, size_t max);
+
+// Why the `index`th candidate passed over by spectrum_kernels() failed its
+// check, or null past the last one
+const char *spectrum_kernels_rejected(size_t index);
@@ -0,0 +1,83 @@
+#include "stereo-scope.hpp"
+#include <cmath>
+#include <cstring>
+
+#define CORRELATION_SECONDS 0.3 // Averaging time of the correlation
+#define CORRELATION_SILENCE 1e-9 // Mean square (both channels) below which it reads 0
+
+void StereoScope::Configure(float sample_rate)
+{
+	rate = sample_rate;
+	Reset();
+}
+
+void StereoScope::Reset()
+{
+	ClearHits();
+	sum_lr = 0.0;
+	sum_ll = 0.0;
+	sum_rr = 0.0;
+	correlation = 0.0f;
+}
+
+void StereoScope::ClearHits()
+{
+	if (dirty_first < dirty_end)
+		memset(hits + dirty_first * SCOPE_SIZE, 0, (dirty_end - dirty_first) * SCOPE_SIZE * sizeof(float));
+	points = 0;
+	dirty_first = SCOPE_SIZE;
+	dirty_end = 0;
+}
+
+void StereoScope::Process(const float *const *planes, size_t channels, size_t frames)
+{
+	if (rate <= 0.0f || channels == 0 || frames == 0)
+		return;
+	const float *left = planes[0];
+	const float *right = channels > 1 ? planes[1] : planes[0];
+
+	// Mid up and side across, each -1..1 over the grid: full-scale mono
+	// reaches the top edge, and a full-scale single channel lands halfway
+	// from the centre to a top corner, on the 45-degree diagonal
+	const float scale = 0.5f * (float)(SCOPE_SIZE - 1);
+	const float limit = (float)(SCOPE_SIZE - 1);
+	float lr = 0.0f, ll = 0.0f, rr = 0.0f;
+	size_t first = dirty_first, end = dirty_end;
+	for (size_t i = 0; i < frames; i++) {
+		float l = left[i], r = right[i];
+		lr += l * r;
+		ll += l * l;
+		rr += r * r;
+
+		float x = scale + (r - l) * 0.5f * scale;
+		float y = scale - (l + r) * 0.5f * scale;
+		if (!(x >= 0.0f && x < limit && y >= 0.0f && y < limit))
+			continue; // Off the grid, or NaN
+		size_t cx = (size_t)x, cy = (size_t)y;
+		float fx = x - (float)cx, fy = y - (float)cy;
+		float *cell = hits + cy * SCOPE_SIZE + cx;
+		cell[0] += (1.0f - fx) * (1.0f - fy);
+		cell[1] += fx * (1.0f - fy);
+		cell[SCOPE_SIZE] += (1.0f - fx) * fy;
+		cell[SCOPE_SIZE + 1] += fx * fy;
+		first = cy < first ? cy : first;
+		end = cy + 2 > end ? cy + 2 : end;
+	}
+	points += frames;
+	dirty_first = first;
+	dirty_end = end;
+
+	double keep = exp(-(double)frames / ((double)rate * CORRELATION_SECONDS));
+	sum_lr = sum_lr * keep + lr;
+	sum_ll = sum_ll * keep + ll;
+	sum_rr = sum_rr * keep + rr;
+
+	double window = (double)rate * CORRELATION_SECONDS;
+	double silence = CORRELATION_SILENCE * window;
+	if (sum_ll < silence || sum_rr < silence) {
+		correlation = 0.0f;
+		return;
+	}
+	double c = sum_lr / sqrt(sum_ll * sum_rr);
+	correlation = (float)(c > 1.0 ? 1.0 : c < -1.0 ? -1.0 : c);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Stereo vectorscope (goniometer) and phase correlation
+// Every left/right sample pair is rotated into mid/side, so a mono signal is
+// a vertical line and one channel alone a diagonal, and splatted bilinearly
+// into a density grid. The renderer takes the grid once a video frame and
+// adds it to a decaying trace on the GPU, so drawing costs the same however
+// many samples arrived. The correlation (the normalised sum of L x R, +1 for
+// mono, -1 for one channel inverted) is summed in the same pass and averaged
+// over about 300 ms, as on a hardware meter.
+//
+// Holds no heap memory and never allocates. No OBS dependencies.
+
+#define SCOPE_SIZE 256 // Density grid cells per side
+
+class StereoScope {
+public:
+	void Configure(float sample_rate);
+	void Reset();
+
+	// Planar samples; channels 0 and 1 are left and right, a mono source is both
+	void Process(const float *const *planes, size_t channels, size_t frames);
+
+	float SampleRate() const { return rate; }
+
+	// Hits since the last ClearHits(), SCOPE_SIZE rows of SCOPE_SIZE, the top
+	// row (full-scale mid) first. Only rows DirtyFirst() up to DirtyEnd()
+	// can be non-zero (none when first >= end), and only those are cleared.
+	const float *Hits() const { return hits; }
+	uint64_t Points() const { return points; }
+	size_t DirtyFirst() const { return dirty_first; }
+	size_t DirtyEnd() const { return dirty_end; }
+	void ClearHits();
+
+	// -1 to +1, 0 in silence
+	float Correlation() const { return correlation; }
+
+private:
+	float rate = 0.0f;
+	float hits[SCOPE_SIZE * SCOPE_SIZE] = {};
+	uint64_t points = 0;
+	size_t dirty_first = SCOPE_SIZE; // Rows touched since ClearHits()
+	size_t dirty_end = 0;
+
+	// Smoothed sums of L x R, L^2 and R^2
+	double sum_lr = 0.0;
+	double sum_ll = 0.0;
+	double sum_rr = 0.0;
+	float correlation = 0.0f;
+};
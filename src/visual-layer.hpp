@@ -0,0 +1,72 @@
+#pragma once
+
+#include "gradient.hpp"
+#include <cmath>
+#include <cstdint>
+
+// One visual of a GlassLine source: a render mode with its own style, placed
+// by a transform around the source centre and combined with the layers below
+// it by a blend mode. All layers of a source draw from the same spectrum and
+// waveform snapshot, in order, bottom first.
+
+#define MAX_LAYERS 8
+
+enum LayerBlend {
+	LAYER_BLEND_NORMAL = 0,
+	LAYER_BLEND_ADD = 1,
+	LAYER_BLEND_SCREEN = 2,
+	LAYER_BLEND_MULTIPLY = 3,
+};
+
+struct VisualLayer {
+	// 0: Centered Waveform, 1: Symmetric Waveform, 2: Mirrored Bars, 3: Filled Mirror, 4: Centered Dots,
+	// 5: Multi-Wave, 6: Symetric Dots, 7: DNA Wave, 8: Pixel Bars, 9: Circular Dots, 10: Spectrum Bars,
+	// 11: Waveform, 12: Oscilloscope, 13: Spectrogram, 14: Loudness Meter, 15: Loudness History,
+	// 16: Vectorscope
+	int mode = 0;
+	uint32_t start_abgr = 0;
+	uint32_t end_abgr = 0;
+	uint32_t glow_abgr = 0;
+	GradientLUT gradient; // Start to end colour, or all start colour
+	int gradient_mode = GRADIENT_SOLID;
+	float glow_strength = 0.5f;
+	float thickness = 2.0f;
+	float line_width = 4.0f;
+	int line_join = 0; // PolylineJoin
+	float amp_scale = 1.0f;
+	float beat_pulse = 0.0f;
+	bool peak_hold = false;
+	float window_ms = 50.0f;
+	bool trigger = true;
+
+	// Placement: scaled and rotated (degrees, clockwise) around the source
+	// centre, then moved by fractions of the source size
+	float offset_x = 0.0f;
+	float offset_y = 0.0f;
+	float scale = 1.0f;
+	float rotation = 0.0f;
+	float opacity = 1.0f;
+	int blend = LAYER_BLEND_NORMAL;
+
+	bool Placed() const
+	{
+		return offset_x != 0.0f || offset_y != 0.0f || scale != 1.0f || rotation != 0.0f || opacity < 1.0f;
+	}
+
+	// Row-major 2x3 matrix from layer to source coordinates:
+	// x' = m[0] x + m[1] y + m[2], y' = m[3] x + m[4] y + m[5]
+	void Transform(float width, float height, float m[6]) const
+	{
+		float radians = rotation * (float)M_PI / 180.0f;
+		float c = cosf(radians) * scale;
+		float s = sinf(radians) * scale;
+		float cx = width * 0.5f;
+		float cy = height * 0.5f;
+		m[0] = c;
+		m[1] = -s;
+		m[2] = cx + offset_x * width - (c * cx - s * cy);
+		m[3] = s;
+		m[4] = c;
+		m[5] = cy + offset_y * height - (s * cx + c * cy);
+	}
+};
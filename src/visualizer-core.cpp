@@ -0,0 +1,537 @@
+#include "visualizer-core.hpp"
+#include "alloc-check.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+// Input stats thresholds for the flight recorder
+#define CLIP_LEVEL 0.999f
+#define SILENCE_LEVEL 0.00003f // About -90 dBFS RMS
+#define MAX_TIMESTAMP_JITTER_NS 2000000ull
+
+// Latency records kept for export, about 2.5 minutes at the default interval
+#define LATENCY_RECORDS 16384
+
+CoreMutex::Observer *CoreMutex::observer = nullptr;
+
+void CoreMutex::ObservedLock()
+{
+	observer->Locking(rank);
+	if (mutex.try_lock()) {
+		observer->Locked(rank, 0, false);
+		return;
+	}
+	auto start = std::chrono::steady_clock::now();
+	mutex.lock();
+	auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+	observer->Locked(rank, (uint64_t)wait.count(), true);
+}
+
+// Analysis-rate samples in an interval
+static size_t hop_samples(float ms, float rate, int factor)
+{
+	size_t samples = (size_t)(ms * rate / (float)factor / 1000.0f);
+	return samples < 1 ? 1 : samples;
+}
+
+// Largest of each group of input values, for `count` outputs
+static void resample_bins(const float *in, size_t in_count, float *out, size_t count, float scale)
+{
+	for (size_t i = 0; i < count; i++) {
+		size_t lo = i * in_count / count;
+		size_t hi = (i + 1) * in_count / count;
+		float value = in[lo];
+		for (size_t j = lo + 1; j < hi; j++)
+			value = in[j] > value ? in[j] : value;
+		out[i] = value * scale;
+	}
+}
+
+VisualizerCore::VisualizerCore()
+{
+	latency.Configure(LATENCY_RECORDS);
+}
+
+uint64_t VisualizerCore::Now() const
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		       std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+void VisualizerCore::ApplySettings(const CoreSettings &settings, std::vector<VisualLayer> &new_layers)
+{
+	// Pick the decimation factor from the highest frequency we need to show
+	float rate = settings.sample_rate;
+	int factor = settings.decimate ? PolyphaseDecimator::ChooseFactor(rate, settings.top_freq) : 1;
+	size_t new_channels = settings.channels < FEATURE_MAX_CHANNELS ? settings.channels : FEATURE_MAX_CHANNELS;
+
+	std::lock_guard<CoreMutex> guard(flight_mutex);
+
+	// Turning the governor off restores full quality at once
+	size_t new_fft = fft_size;
+	float new_hop_scale = hop_scale;
+	if (!settings.governor) {
+		new_fft = QualityGovernor::Level(0).fft_size;
+		new_hop_scale = QualityGovernor::Level(0).hop_scale;
+	}
+	size_t new_hop = hop_samples(settings.hop_ms * new_hop_scale, rate, factor);
+
+	// Old samples were taken at a different rate, start over
+	AnalysisLayout layout;
+	bool reconfigure = factor != decimation || rate != sample_rate || new_hop != hop || new_fft != fft_size ||
+			   new_channels != channels || settings.bands != analysis_bands ||
+			   (settings.bands && settings.top_freq != bands_top) || settings.pitch != track_pitch ||
+			   display_magnitudes.empty();
+	if (reconfigure) {
+		LayoutParams(layout);
+		layout.sample_rate = rate;
+		layout.fft_size = new_fft;
+		layout.decimation = factor;
+		layout.hop = new_hop;
+		layout.channels = new_channels;
+		layout.bands = settings.bands;
+		layout.top_freq = settings.top_freq;
+		layout.pitch = settings.pitch;
+		BuildLayout(layout);
+	}
+	MinMaxPyramid new_waveform;
+	bool rewave = waveform.Capacity() == 0 || rate != sample_rate;
+	if (rewave)
+		new_waveform.Configure((size_t)(rate * MAX_WINDOW_SECONDS));
+
+	std::lock_guard<CoreMutex> lock(audio_mutex);
+	attack_ms = settings.attack_ms;
+	release_ms = settings.release_ms;
+	hop_ms = settings.hop_ms;
+	governor_enabled = settings.governor;
+	decimate = settings.decimate;
+	top_freq = settings.top_freq;
+
+	if (!governor_enabled && governor.Current() != 0)
+		governor.Reset();
+	hop_scale = new_hop_scale;
+	if (rewave)
+		std::swap(waveform, new_waveform);
+	if (reconfigure)
+		InstallLayout(layout);
+	analyzer.SetTimeConstants(attack_ms, release_ms);
+
+	// Metering starts over when a loudness layer appears, so the
+	// integrated loudness covers only the time it was on screen
+	if (settings.loudness && (!any_loudness || loudness.SampleRate() != rate || loudness.Channels() != channels))
+		loudness.Configure(rate, channels);
+	any_loudness = settings.loudness;
+
+	// Likewise the vectorscope trace starts empty
+	if (settings.scope && (!any_scope || scope.SampleRate() != rate)) {
+		scope.Configure(rate);
+		scope_starts++;
+	}
+	any_scope = settings.scope;
+
+	layers.swap(new_layers);
+	any_peak_hold = settings.peak_hold;
+}
+
+void VisualizerCore::LayoutParams(AnalysisLayout &layout) const
+{
+	layout.sample_rate = sample_rate;
+	layout.fft_size = fft_size;
+	layout.decimation = decimation;
+	layout.hop = hop;
+	layout.channels = channels;
+	layout.bands = analysis_bands;
+	layout.top_freq = top_freq;
+	layout.pitch = track_pitch;
+	layout.replay = replaying;
+}
+
+// Lays out the analysis arena and the display buffers for `layout`'s
+// parameters (or the replay file's)
+void VisualizerCore::BuildLayout(AnalysisLayout &layout)
+{
+	AnalyzerConfig config;
+	config.sample_rate = layout.sample_rate;
+	config.hop = layout.hop;
+	config.history = PUBLISHED_FRAMES;
+	config.channels = layout.channels;
+	config.pitch = layout.pitch;
+	if (layout.replay) {
+		config.fft_size = replay.Header().fft_size;
+		layout.analysis_rate = replay.Header().analysis_rate;
+	} else {
+		config.fft_size = layout.fft_size;
+		config.decimation = layout.decimation;
+		layout.analysis_rate = layout.sample_rate / (float)layout.decimation;
+		if (layout.bands > 0)
+			config.SetBands(layout.bands, layout.top_freq);
+	}
+
+	if (!layout.analyzer.Configure(config))
+		AnalysisFailed(config.fft_size);
+
+	// Unnormalised magnitudes grow with the FFT size; scale smaller ones up so
+	// the governor's steps don't change the picture's level
+	layout.fft_gain = 1.0f;
+	if (!layout.replay)
+		layout.fft_gain = (float)QualityGovernor::Level(0).fft_size / (float)layout.analyzer.Config().fft_size;
+
+	size_t bins = layout.analyzer.NumBins();
+	layout.display_magnitudes.assign(bins, 0.0f);
+	layout.display_peaks.assign(bins, 0.0f);
+	layout.held_magnitudes.assign(bins, 0.0f);
+	layout.pending.assign(layout.analyzer.Config().history, LatencyRecord{});
+}
+
+void VisualizerCore::InstallLayout(AnalysisLayout &layout)
+{
+	// Keep drawing the last spectrum, resampled to the new bins, until the new
+	// layout publishes one, so a reconfigure never blanks the output
+	ArenaSpan<float> last;
+	if (analyzer.Published() > 0)
+		last = analyzer.Frame(analyzer.Published() - 1);
+	size_t bins = layout.held_magnitudes.size();
+	if (!last.empty() && !layout.replay && layout.analysis_rate == analysis_rate && bins > 0) {
+		resample_bins(last.data(), last.size(), layout.held_magnitudes.data(), bins,
+			      (float)layout.analyzer.Config().fft_size / (float)analyzer.Config().fft_size);
+	} else {
+		layout.held_magnitudes.clear();
+	}
+
+	sample_rate = layout.sample_rate;
+	fft_size = layout.fft_size;
+	decimation = layout.decimation;
+	hop = layout.hop;
+	channels = layout.channels;
+	analysis_bands = layout.bands;
+	bands_top = layout.top_freq;
+	track_pitch = layout.pitch;
+	replaying = layout.replay;
+	analysis_rate = layout.analysis_rate;
+	fft_gain = layout.fft_gain;
+
+	std::swap(analyzer, layout.analyzer);
+	display_magnitudes.swap(layout.display_magnitudes);
+	display_peaks.swap(layout.display_peaks);
+	held_magnitudes.swap(layout.held_magnitudes);
+	pending.swap(layout.pending);
+	analyzer.SetTimeConstants(attack_ms, release_ms);
+	layouts++;
+
+	// Latency depends on the layout; start the distribution over
+	playout_delay = 0;
+	latency_scan = 0;
+	latency.Reset();
+}
+
+void VisualizerCore::AudioCallback(const float *const *planes, size_t frames, uint64_t timestamp)
+{
+	AllocCheckScope alloc_scope("audio callback");
+	uint64_t arrival = Now(); // Before the lock, so contention counts as analysis
+	std::lock_guard<CoreMutex> lock(audio_mutex);
+
+	if (frames == 0)
+		return;
+
+	// Raw blocks for offline replay, before anything else touches them
+	if (capture)
+		capture->Append(planes, (uint32_t)frames, timestamp);
+
+	// Just take the first channel (mono)
+	const float *samples = planes[0];
+
+	// Time-domain modes read the raw (undecimated) stream
+	waveform.Push(samples, frames);
+	if (any_scope) {
+		uint64_t scope_start = Now();
+		scope.Process(planes, channels, frames);
+		analysis_cost_ns += Now() - scope_start;
+	}
+
+	// Recorded bands come from the replay file instead
+	if (replaying)
+		return;
+
+	if (any_loudness) {
+		uint64_t metering_start = Now();
+		loudness.Process(planes, channels, frames);
+		analysis_cost_ns += Now() - metering_start;
+	}
+
+	// Input stats for the flight recorder
+	if (recorder) {
+		for (size_t i = 0; i < frames; i++) {
+			float a = fabsf(samples[i]);
+			if (a > block_peak)
+				block_peak = a;
+			block_sum_sq += (double)samples[i] * samples[i];
+		}
+		block_count += frames;
+
+		int64_t drift = last_block_end ? (int64_t)(timestamp - last_block_end) : 0;
+		if (drift > (int64_t)MAX_TIMESTAMP_JITTER_NS || drift < -(int64_t)MAX_TIMESTAMP_JITTER_NS)
+			block_flags |= FLIGHT_FLAG_DISCONTINUITY;
+	}
+	last_block_end = timestamp + (uint64_t)((double)frames * 1e9 / sample_rate);
+
+	uint64_t first_new = analyzer.Published();
+	uint64_t analysis_start = Now();
+	bool produced = analyzer.Process(planes, channels, frames, timestamp);
+	uint64_t analyzed = Now();
+	analysis_cost_ns += analyzed - analysis_start;
+
+	if (produced) {
+		NoteSpectra(first_new, arrival, analyzed);
+		PublishSpectra(first_new);
+
+		if (recorder) {
+			FlightFrameStats stats;
+			stats.peak = block_peak;
+			stats.rms = block_count ? (float)sqrt(block_sum_sq / (double)block_count) : 0.0f;
+			stats.flags = block_flags;
+			if (stats.peak >= CLIP_LEVEL)
+				stats.flags |= FLIGHT_FLAG_CLIPPED;
+			if (stats.rms < SILENCE_LEVEL)
+				stats.flags |= FLIGHT_FLAG_SILENT;
+
+			// Every spectrum this block completed, each at its own time
+			if (first_new < analyzer.OldestFrame())
+				first_new = analyzer.OldestFrame();
+			for (uint64_t i = first_new; i < analyzer.Published(); i++) {
+				ArenaSpan<float> frame = analyzer.Frame(i);
+				stats.timestamp = analyzer.FrameTime(i);
+				recorder->Append(stats, frame.data(), frame.size());
+			}
+
+			block_peak = 0.0f;
+			block_sum_sq = 0.0;
+			block_count = 0;
+			block_flags = 0;
+		}
+	}
+}
+
+// Remembers when the spectra [first, Published()) arrived and were analysed,
+// until they are drawn. An arrival of 0 leaves them out of the stats.
+void VisualizerCore::NoteSpectra(uint64_t first, uint64_t arrival, uint64_t analyzed)
+{
+	if (pending.empty())
+		return;
+	if (first < analyzer.OldestFrame())
+		first = analyzer.OldestFrame();
+	for (uint64_t i = first; i < analyzer.Published(); i++)
+		pending[(size_t)(i % pending.size())] = {analyzer.FrameTime(i), arrival, analyzed, 0};
+}
+
+// Hands the spectra [first, Published()) to the shared-memory feed. Call with
+// audio_mutex held.
+void VisualizerCore::PublishSpectra(uint64_t first)
+{
+	if (!publisher)
+		return;
+	if (first < analyzer.OldestFrame())
+		first = analyzer.OldestFrame();
+	float bin_hz = analysis_rate / (float)analyzer.Config().fft_size;
+	uint64_t now = Now();
+	for (uint64_t i = first; i < analyzer.Published(); i++) {
+		ArenaSpan<float> frame = analyzer.Frame(i);
+		publisher->Publish(analyzer.FrameTime(i), now, frame.data(), frame.size(), bin_hz,
+				   analyzer.Features(i));
+	}
+}
+
+// Fills display_magnitudes for this video frame by interpolating between the
+// two published spectra around it. Rendering runs playout_delay behind the
+// newest spectrum so callbacks arriving in bursts still leave a later frame
+// to move towards. Call with audio_mutex held.
+bool VisualizerCore::UpdateDisplaySpectrum(uint64_t video_time)
+{
+	uint64_t published = analyzer.Published();
+	if (display_magnitudes.size() != analyzer.NumBins())
+		return false;
+	if (published == 0) {
+		// Just reconfigured: the previous layout's last spectrum stands in
+		if (held_magnitudes.size() != display_magnitudes.size())
+			return false;
+		memcpy(display_magnitudes.data(), held_magnitudes.data(), held_magnitudes.size() * sizeof(float));
+		std::fill(display_peaks.begin(), display_peaks.end(), 0.0f);
+		return true;
+	}
+
+	// The delay follows the largest recent lag of the newest spectrum behind
+	// the video clock: it jumps up at once and creeps back down
+	uint64_t newest = published - 1;
+	int64_t lag = (int64_t)(video_time - analyzer.FrameTime(newest));
+	if (lag > playout_delay)
+		playout_delay = lag;
+	else
+		playout_delay += (lag - playout_delay) / 256;
+
+	uint64_t t = video_time - (uint64_t)playout_delay;
+
+	// Newest published spectrum at or before t
+	uint64_t oldest = analyzer.OldestFrame();
+	uint64_t a = newest;
+	while (a > oldest && (int64_t)(analyzer.FrameTime(a) - t) > 0)
+		a--;
+
+	// Latency of each spectrum the first time it's the one on screen; those
+	// replaced before a frame got to them are only counted
+	if (latency_scan < oldest) {
+		latency.AddSkipped(oldest - latency_scan);
+		latency_scan = oldest;
+	}
+	if (a >= latency_scan && !pending.empty()) {
+		latency.AddSkipped(a - latency_scan);
+		LatencyRecord record = pending[(size_t)(a % pending.size())];
+		if (record.arrival) {
+			record.rendered = video_time;
+			latency.Add(record);
+		}
+		latency_scan = a + 1;
+	}
+
+	// Features of the spectrum on screen; beats are caught even when frames are skipped
+	display_features = analyzer.Features(a);
+	if (beat_scan < oldest || beat_scan > a + 1)
+		beat_scan = oldest;
+	for (; beat_scan <= a; beat_scan++) {
+		if (analyzer.Features(beat_scan).beat)
+			last_beat_time = analyzer.FrameTime(beat_scan);
+	}
+
+	// Held peaks only exist for the newest spectrum; they lead by the playout delay
+	if (any_peak_hold) {
+		ArenaSpan<float> peaks = analyzer.Peaks();
+		memcpy(display_peaks.data(), peaks.data(), peaks.size() * sizeof(float));
+	}
+
+	ArenaSpan<float> from = analyzer.Frame(a);
+	if (a == newest || (int64_t)(analyzer.FrameTime(a) - t) > 0) {
+		memcpy(display_magnitudes.data(), from.data(), from.size() * sizeof(float));
+		return true;
+	}
+
+	ArenaSpan<float> to = analyzer.Frame(a + 1);
+	double span = (double)(int64_t)(analyzer.FrameTime(a + 1) - analyzer.FrameTime(a));
+	float alpha = span > 0.0 ? (float)((double)(int64_t)(t - analyzer.FrameTime(a)) / span) : 1.0f;
+	if (alpha > 1.0f)
+		alpha = 1.0f;
+
+	for (size_t i = 0; i < display_magnitudes.size(); i++)
+		display_magnitudes[i] = from[i] + (to[i] - from[i]) * alpha;
+	return true;
+}
+
+// Feeds the governor this frame's costs and applies a level change. The
+// analysis layout stays put while a recording, capture or replay is tied to
+// it; the render-side steps still apply. Call with flight_mutex held.
+bool VisualizerCore::Govern(uint64_t obs_frame_ns, uint64_t interval_ns, GovernorStep &step)
+{
+	step.pinned = recorder || capture || replaying;
+	AnalysisLayout layout;
+	{
+		std::lock_guard<CoreMutex> lock(audio_mutex);
+		if (!governor_enabled) // Set by ApplySettings() under audio_mutex
+			return false;
+
+		uint64_t own = analysis_cost_ns + render_cost_ns;
+		analysis_cost_ns = 0;
+		render_cost_ns = 0;
+
+		step.previous = governor.Current();
+		if (!governor.Update(own, obs_frame_ns, interval_ns))
+			return false;
+	}
+
+	const QualityLevel &quality = governor.Settings();
+	if (!step.pinned && (quality.fft_size != fft_size || quality.hop_scale != hop_scale)) {
+		LayoutParams(layout);
+		layout.fft_size = quality.fft_size;
+		layout.hop = hop_samples(hop_ms * quality.hop_scale, sample_rate, decimation);
+		BuildLayout(layout);
+
+		std::lock_guard<CoreMutex> lock(audio_mutex);
+		hop_scale = quality.hop_scale;
+		InstallLayout(layout);
+	}
+	step.fft_size = fft_size;
+	step.hop_scale = hop_scale;
+	return true;
+}
+
+// Call with flight_mutex held
+void VisualizerCore::Maintain(float seconds, uint64_t video_time)
+{
+	// Chunk mapping happens here so the audio thread never makes a syscall
+	if (recorder)
+		recorder->Maintain();
+	if (capture)
+		capture->Maintain();
+
+	if (!replaying)
+		return;
+
+	uint64_t first = replay.FirstTimestamp();
+	double length = (double)(replay.LastTimestamp() - first) / 1e9;
+	replay_position += seconds;
+	if (replay_position > length || replay_position < 0.0)
+		replay_position = replay_start >= 0.0 && replay_start < length ? replay_start : 0.0;
+
+	size_t index = replay.Seek(first + (uint64_t)(replay_position * 1e9));
+	if (index == replay_index || index >= replay.FrameCount())
+		return;
+	replay_index = index;
+	replay.ReadFrame(index, replay_frame);
+
+	// Feed the recorded bands to the renderer as if they were live, on the video clock
+	std::lock_guard<CoreMutex> lock(audio_mutex);
+	uint64_t published = analyzer.Published();
+	analyzer.Publish(replay_frame.bands.data(), replay_frame.bands.size(), video_time);
+	NoteSpectra(published, 0, 0); // No audio behind these, so no latency
+	PublishSpectra(published);
+}
+
+// Call with flight_mutex held
+bool VisualizerCore::SetReplay(const std::string &path)
+{
+	replay.Close();
+
+	const FlightFileHeader &header = replay.Header();
+	bool ok = !path.empty() && replay.Open(path.c_str()) && replay.FrameCount() > 0 && header.fft_size >= 2 &&
+		  (header.fft_size & (header.fft_size - 1)) == 0;
+
+	replay_position = replay_start;
+	replay_index = (size_t)-1;
+
+	AnalysisLayout layout;
+	LayoutParams(layout);
+	layout.replay = ok;
+	BuildLayout(layout);
+
+	std::lock_guard<CoreMutex> lock(audio_mutex);
+	InstallLayout(layout);
+	return ok || path.empty();
+}
+
+std::unique_ptr<FlightRecorder> VisualizerCore::SwapRecorder(std::unique_ptr<FlightRecorder> next)
+{
+	std::lock_guard<CoreMutex> lock(audio_mutex);
+	recorder.swap(next);
+	return next;
+}
+
+std::unique_ptr<CaptureWriter> VisualizerCore::SwapCapture(std::unique_ptr<CaptureWriter> next)
+{
+	std::lock_guard<CoreMutex> lock(audio_mutex);
+	capture.swap(next);
+	return next;
+}
+
+std::unique_ptr<ShmPublisher> VisualizerCore::SwapPublisher(std::unique_ptr<ShmPublisher> next)
+{
+	std::lock_guard<CoreMutex> lock(audio_mutex);
+	publisher.swap(next);
+	return next;
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+#include "spectrum-analyzer.hpp"
+#include "minmax-pyramid.hpp"
+#include "visual-layer.hpp"
+#include "flight-recorder.hpp"
+#include "callback-capture.hpp"
+#include "latency-stats.hpp"
+#include "quality-governor.hpp"
+#include "shm-publisher.hpp"
+#include "loudness-meter.hpp"
+#include "stereo-scope.hpp"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// The state a visualizer shares between the threads OBS drives it on, and
+// the locking around it. GlassLineSource adds the OBS side (reading
+// settings, binding to an audio source, drawing); glassline-stress drives
+// this same class from threads of its own. No OBS dependencies.
+//
+//   audio   AudioCallback()
+//   render  UpdateDisplaySpectrum() and reads of everything below, all
+//           under audio_mutex for the whole frame
+//   tick    Govern() and Maintain(), under flight_mutex
+//   update  ApplySettings(), then SetReplay() and the Swap*() calls, all
+//           under flight_mutex
+//
+// flight_mutex is taken before audio_mutex, never the other way round. A new
+// analysis layout is built under flight_mutex alone, so the allocating is
+// done without holding up the audio thread, and only swapped in under
+// audio_mutex.
+
+// Longest window the time-domain modes can show
+#define MAX_WINDOW_SECONDS 10
+
+// Published spectra the renderer can interpolate between; covers every hop
+// of one audio callback at the shortest interval
+#define PUBLISHED_FRAMES 32
+#define MIN_HOP_MS 2.0
+
+// std::mutex that can report its waits. glassline-stress sets the observer
+// to time every acquisition and check the lock order; it stays null in the
+// plugin, where locking costs the same as a plain mutex.
+class CoreMutex {
+public:
+	struct Observer {
+		virtual void Locking(int rank) = 0; // Before any wait
+		virtual void Locked(int rank, uint64_t wait_ns, bool contended) = 0;
+		virtual void Unlocked(int rank) = 0;
+
+	protected:
+		~Observer() = default;
+	};
+	static Observer *observer; // Set before any locking starts
+
+	explicit CoreMutex(int rank) : rank(rank) {}
+
+	void lock()
+	{
+		if (observer)
+			ObservedLock();
+		else
+			mutex.lock();
+	}
+
+	void unlock()
+	{
+		if (observer)
+			observer->Unlocked(rank);
+		mutex.unlock();
+	}
+
+private:
+	void ObservedLock();
+
+	std::mutex mutex;
+	int rank; // flight_mutex 0, audio_mutex 1
+};
+
+// What a settings change asks of the shared state
+struct CoreSettings {
+	float attack_ms = 20.0f;      // Spectrum rise time constant
+	float release_ms = 150.0f;    // Spectrum fall time constant
+	float hop_ms = 10.0f;         // Time between analysed spectra
+	bool governor = false;        // Step quality down under load
+	bool decimate = false;        // Decimate before the FFT for finer low-frequency resolution
+	float top_freq = 12000.0f;    // Highest frequency shown (Hz)
+	float sample_rate = 48000.0f; // Of the audio output
+	size_t channels = 2;          // Metered, up to FEATURE_MAX_CHANNELS
+
+	// What the layers need
+	bool peak_hold = false;
+	bool loudness = false;
+	bool scope = false;
+	bool pitch = false;
+	size_t bands = 0; // Bars shown when every layer is a bar mode with one count, else 0
+};
+
+// An analysis layout: what it is laid out for, and the storage built for it
+struct AnalysisLayout {
+	float sample_rate = 48000.0f;
+	size_t fft_size = 2048;
+	int decimation = 1;
+	size_t hop = 512;
+	size_t channels = 2;
+	size_t bands = 0;
+	float top_freq = 12000.0f;
+	bool pitch = false;
+	bool replay = false; // Laid out for the replay file's bands instead
+
+	SpectrumAnalyzer analyzer;
+	float analysis_rate = 48000.0f;
+	float fft_gain = 1.0f;
+	std::vector<float> display_magnitudes;
+	std::vector<float> display_peaks;
+	std::vector<float> held_magnitudes;
+	std::vector<LatencyRecord> pending;
+};
+
+// What a governor step changed, for the log
+struct GovernorStep {
+	int previous;     // Quality level before the step
+	size_t fft_size;  // Now analysed
+	float hop_scale;
+	bool pinned;      // Analysis layout held by a recording, capture or replay
+};
+
+struct VisualizerCore {
+	VisualizerCore();
+	virtual ~VisualizerCore() = default;
+
+	// Settings (under audio_mutex, from ApplySettings())
+	float attack_ms = 20.0f;
+	float release_ms = 150.0f;
+	float hop_ms = 10.0f;
+	bool governor_enabled = false;
+	bool decimate = false;
+	float top_freq = 12000.0f;
+
+	// Layers, bottom first, swapped in under audio_mutex
+	std::vector<VisualLayer> layers;
+	bool any_peak_hold = false; // Some layer draws peak caps
+
+	// Audio Data
+	CoreMutex audio_mutex{1};
+	MinMaxPyramid waveform;  // Raw samples for the time-domain modes
+	LoudnessMeter loudness;  // Fed only while some layer shows it
+	bool any_loudness = false;
+	StereoScope scope;       // Likewise for the vectorscope
+	bool any_scope = false;
+	uint64_t scope_starts = 0; // Times the scope started over, so the trace does too
+
+	// FFT State
+	size_t fft_size = 2048;                // Set by the governor
+	float hop_scale = 1.0f;                // Governor's stretch of the analysis interval
+	float fft_gain = 1.0f;                 // Evens out magnitude levels across FFT sizes
+	int decimation = 1;
+	size_t hop = 512;                      // Analysis-rate samples between spectra
+	size_t channels = 2;                   // Channels metered by the analyzer
+	size_t analysis_bands = 0;             // Bars shown when every layer is a bar mode with one count, else 0
+	float bands_top = 0.0f;                // top_freq the bands were laid out for
+	bool track_pitch = false;              // Some layer follows the pitch
+	SpectrumAnalyzer analyzer;             // Owns all analysis working storage
+	uint64_t layouts = 0;                  // Analysis layouts configured so far
+	std::vector<float> display_magnitudes; // Published spectra interpolated to the video frame time
+	std::vector<float> display_peaks;      // Held peaks, when peak_hold is on
+	std::vector<float> held_magnitudes;    // Shown after a reconfigure until a new spectrum arrives
+	int64_t playout_delay = 0;             // How far (ns) rendering trails the newest spectrum
+	AudioFeatures display_features = {};   // Features of the spectrum on screen
+	uint64_t beat_scan = 0;                // Next published spectrum to check for a beat
+	uint64_t last_beat_time = 0;           // Frame time of the latest beat shown
+	LatencyStats latency;                  // Audio-to-screen latency of drawn spectra
+	std::vector<LatencyRecord> pending;    // Times of each published spectrum, by history slot
+	uint64_t latency_scan = 0;             // Next published spectrum not yet drawn
+	float sample_rate = 48000.0f;          // Audio output rate
+	float analysis_rate = 48000.0f;        // Rate the FFT actually sees (after decimation)
+
+	// Adaptive quality (costs accumulate under audio_mutex between video ticks)
+	QualityGovernor governor;
+	uint64_t analysis_cost_ns = 0;
+	uint64_t render_cost_ns = 0;
+
+	// Flight recorder / replay
+	CoreMutex flight_mutex{0};
+	std::unique_ptr<FlightRecorder> recorder; // Swapped under both mutexes
+	uint64_t last_block_end = 0;              // Expected timestamp of the next audio block
+	float block_peak = 0.0f;                  // Input stats since the last band frame
+	double block_sum_sq = 0.0;
+	size_t block_count = 0;
+	uint32_t block_flags = 0;
+
+	FlightReader replay;
+	bool replaying = false; // Read by the audio thread under audio_mutex
+	double replay_start = 0.0;
+	double replay_position = 0.0;
+	size_t replay_index = (size_t)-1;
+	FlightFrame replay_frame;
+
+	std::unique_ptr<CaptureWriter> capture;  // Swapped under both mutexes
+	std::unique_ptr<ShmPublisher> publisher; // Swapped under both mutexes
+
+	// Clock of the audio and video timestamps (ns)
+	virtual uint64_t Now() const;
+	// The analysis buffers for `fft_size` couldn't be allocated
+	virtual void AnalysisFailed(size_t fft_size) { (void)fft_size; }
+
+	// Takes the layers (leaving the old ones in `new_layers`, to be freed
+	// outside the lock) and reconfigures whatever the settings changed
+	void ApplySettings(const CoreSettings &settings, std::vector<VisualLayer> &new_layers);
+
+	// The current layout's parameters, to build a changed one from. Call
+	// with flight_mutex held.
+	void LayoutParams(AnalysisLayout &layout) const;
+	// Allocates; call with flight_mutex held and audio_mutex not
+	void BuildLayout(AnalysisLayout &layout);
+	// Swaps a built layout in, leaving the old storage in `layout` to be
+	// freed after unlocking. Call with both mutexes held.
+	void InstallLayout(AnalysisLayout &layout);
+
+	// One block of planar audio, `timestamp` (ns) being its first frame
+	void AudioCallback(const float *const *planes, size_t frames, uint64_t timestamp);
+	void NoteSpectra(uint64_t first, uint64_t arrival, uint64_t analyzed);
+	void PublishSpectra(uint64_t first);
+	bool UpdateDisplaySpectrum(uint64_t video_time);
+
+	// Video tick: a governor step given OBS's frame time and the frame
+	// interval, true when the quality changed; then the files' upkeep and
+	// replay, `seconds` on
+	bool Govern(uint64_t obs_frame_ns, uint64_t interval_ns, GovernorStep &step);
+	void Maintain(float seconds, uint64_t video_time);
+
+	// Replays `path` from replay_start (nothing for an empty path); false
+	// when the file can't be replayed
+	bool SetReplay(const std::string &path);
+
+	// Put the new object in place and hand back the old one, to be closed
+	// outside the lock
+	std::unique_ptr<FlightRecorder> SwapRecorder(std::unique_ptr<FlightRecorder> next);
+	std::unique_ptr<CaptureWriter> SwapCapture(std::unique_ptr<CaptureWriter> next);
+	std::unique_ptr<ShmPublisher> SwapPublisher(std::unique_ptr<ShmPublisher> next);
+};
@@ -0,0 +1,194 @@
+// glassline-flight: inspect, scan and export GlassLine flight recordings (.glfr)
+
+#include "flight-recorder.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+static void usage()
+{
+	fprintf(stderr, "usage: glassline-flight info <file.glfr>\n"
+			"       glassline-flight scan <file.glfr>\n"
+			"       glassline-flight dump <file.glfr> [--from SEC] [--to SEC]\n"
+			"       glassline-flight export <file.glfr> <out.csv> [--from SEC] [--to SEC]\n"
+			"\n"
+			"SEC is measured from the first recorded frame.\n");
+}
+
+static double to_db(float value)
+{
+	return value > 0.0f ? 20.0 * log10(value) : -INFINITY;
+}
+
+static void print_info(const FlightReader &reader)
+{
+	const FlightFileHeader &h = reader.Header();
+	time_t created = (time_t)(h.created_ns / 1000000000ull);
+	char date[64];
+	strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&created));
+
+	double duration = (double)(reader.LastTimestamp() - reader.FirstTimestamp()) / 1e9;
+
+	printf("created:       %s\n", date);
+	printf("encoding:      %s\n", h.encoding == FLIGHT_ENCODING_FLOAT16 ? "float16" : "log8");
+	printf("bands:         %u (FFT %u @ %.0f Hz, %.2f Hz per band)\n", h.band_count, h.fft_size,
+	       h.analysis_rate, h.fft_size ? h.analysis_rate / h.fft_size : 0.0f);
+	printf("frames:        %zu\n", reader.FrameCount());
+	printf("duration:      %.3f s\n", duration);
+	if (duration > 0.0)
+		printf("frame rate:    %.2f fps\n", (double)(reader.FrameCount() - 1) / duration);
+}
+
+// Reports clipping, dead input and timestamp discontinuities as time ranges
+static void scan(const FlightReader &reader)
+{
+	uint64_t first = reader.FirstTimestamp();
+	size_t count = reader.FrameCount();
+
+	struct Run {
+		const char *name;
+		uint32_t flag;
+		bool active;
+		uint64_t start;
+		size_t frames;
+		size_t runs;
+	} runs[] = {
+		{"clipping", FLIGHT_FLAG_CLIPPED, false, 0, 0, 0},
+		{"silence", FLIGHT_FLAG_SILENT, false, 0, 0, 0},
+	};
+
+	size_t discontinuities = 0;
+	float max_peak = 0.0f;
+	FlightFrameStats stats;
+	uint64_t last_ts = first;
+
+	for (size_t i = 0; i <= count; i++) {
+		bool valid = i < count && reader.ReadStats(i, stats);
+		for (Run &run : runs) {
+			bool on = valid && (stats.flags & run.flag);
+			if (on && !run.active) {
+				run.active = true;
+				run.start = stats.timestamp;
+				run.frames = 0;
+			}
+			if (on)
+				run.frames++;
+			if (!on && run.active) {
+				run.active = false;
+				run.runs++;
+				printf("%-9s %10.3f s .. %10.3f s (%zu frames)\n", run.name,
+				       (double)(run.start - first) / 1e9, (double)(last_ts - first) / 1e9, run.frames);
+			}
+		}
+		if (!valid)
+			break;
+
+		if (stats.flags & FLIGHT_FLAG_DISCONTINUITY) {
+			discontinuities++;
+			printf("%-9s %10.3f s (gap after previous frame: %.3f ms)\n", "sync", (double)(stats.timestamp - first) / 1e9,
+			       (double)(stats.timestamp - last_ts) / 1e6);
+		}
+		if (stats.peak > max_peak)
+			max_peak = stats.peak;
+		last_ts = stats.timestamp;
+	}
+
+	printf("\n%zu clipping run(s), %zu silent run(s), %zu timestamp discontinuities, max peak %.2f dBFS\n",
+	       runs[0].runs, runs[1].runs, discontinuities, to_db(max_peak));
+}
+
+static bool parse_range(int argc, char **argv, int start, double &from, double &to)
+{
+	for (int i = start; i < argc; i++) {
+		if (strcmp(argv[i], "--from") == 0 && i + 1 < argc)
+			from = atof(argv[++i]);
+		else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc)
+			to = atof(argv[++i]);
+		else
+			return false;
+	}
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 3) {
+		usage();
+		return 1;
+	}
+
+	const char *command = argv[1];
+	FlightReader reader;
+	if (!reader.Open(argv[2])) {
+		fprintf(stderr, "Failed to open flight recording '%s'\n", argv[2]);
+		return 1;
+	}
+
+	if (strcmp(command, "info") == 0) {
+		print_info(reader);
+		return 0;
+	}
+	if (strcmp(command, "scan") == 0) {
+		scan(reader);
+		return 0;
+	}
+
+	bool is_export = strcmp(command, "export") == 0;
+	if (!is_export && strcmp(command, "dump") != 0) {
+		usage();
+		return 1;
+	}
+	if (is_export && argc < 4) {
+		usage();
+		return 1;
+	}
+
+	double from = 0.0, to = INFINITY;
+	if (!parse_range(argc, argv, is_export ? 4 : 3, from, to)) {
+		usage();
+		return 1;
+	}
+
+	uint64_t first = reader.FirstTimestamp();
+	size_t begin = reader.Seek(first + (uint64_t)(from * 1e9));
+
+	FILE *out = stdout;
+	if (is_export) {
+		out = fopen(argv[3], "w");
+		if (!out) {
+			fprintf(stderr, "Failed to create '%s'\n", argv[3]);
+			return 1;
+		}
+		fprintf(out, "time,peak_db,rms_db,flags");
+		for (uint32_t b = 0; b < reader.Header().band_count; b++)
+			fprintf(out, ",band%u", b);
+		fprintf(out, "\n");
+	}
+
+	FlightFrame frame;
+	for (size_t i = begin; i < reader.FrameCount(); i++) {
+		reader.ReadFrame(i, frame);
+		double t = (double)(frame.stats.timestamp - first) / 1e9;
+		if (t > to)
+			break;
+
+		if (is_export) {
+			fprintf(out, "%.6f,%.2f,%.2f,%u", t, to_db(frame.stats.peak), to_db(frame.stats.rms),
+				frame.stats.flags);
+			for (float band : frame.bands)
+				fprintf(out, ",%g", band);
+			fprintf(out, "\n");
+		} else {
+			fprintf(out, "%10.3f s  peak %7.2f dBFS  rms %7.2f dBFS %s%s%s\n", t, to_db(frame.stats.peak),
+				to_db(frame.stats.rms), (frame.stats.flags & FLIGHT_FLAG_CLIPPED) ? " CLIP" : "",
+				(frame.stats.flags & FLIGHT_FLAG_SILENT) ? " SILENT" : "",
+				(frame.stats.flags & FLIGHT_FLAG_DISCONTINUITY) ? " GAP" : "");
+		}
+	}
+
+	if (is_export)
+		fclose(out);
+	return 0;
+}
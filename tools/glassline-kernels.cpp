@@ -0,0 +1,40 @@
+// glassline-kernels: check every SIMD post-FFT kernel set this build and CPU
+// can run against the scalar reference, the same check the plugin makes
+// before picking one. Exits with status 2 when any of them fails, so a
+// broken kernel fails a CI run instead of quietly leaving the plugin on the
+// scalar path.
+
+#include "spectrum-kernels.hpp"
+#include <cstdio>
+
+int main(int argc, char **argv)
+{
+	(void)argv;
+	if (argc > 1) {
+		fprintf(stderr, "usage: glassline-kernels\n");
+		return 1;
+	}
+
+	const SpectrumKernels *candidates[8];
+	size_t count = spectrum_kernels_candidates(candidates, sizeof(candidates) / sizeof(candidates[0]));
+	if (count == 0)
+		printf("no SIMD kernels for this build and CPU, only %s\n", spectrum_kernels_reference().name);
+
+	size_t failed = 0;
+	for (size_t i = 0; i < count; i++) {
+		char error[256];
+		if (spectrum_kernels_check(*candidates[i], error, sizeof(error))) {
+			printf("%-8s matches the reference\n", candidates[i]->name);
+		} else {
+			printf("%-8s FAILED: %s\n", candidates[i]->name, error);
+			failed++;
+		}
+	}
+	printf("selected: %s\n", spectrum_kernels().name);
+
+	if (failed) {
+		printf("\n%zu of %zu kernel sets failed\n", failed, count);
+		return 2;
+	}
+	return 0;
+}
@@ -0,0 +1,394 @@
+// glassline-replay: feed captured audio callbacks (.glcap) through the
+// analysis pipeline at full speed, check the spectra against a golden file
+// and report throughput
+
+#include "alloc-check.hpp"
+#include "callback-capture.hpp"
+#include "flight-recorder.hpp"
+#include "loudness-meter.hpp"
+#include "stereo-scope.hpp"
+#include "spectrum-analyzer.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Magnitudes below this are compared as equal
+#define GOLDEN_FLOOR_DB -100.0
+
+static void usage()
+{
+	fprintf(stderr, "usage: glassline-replay <file.glcap> [options]\n"
+			"\n"
+			"  --fft N             FFT size (default: as captured)\n"
+			"  --decimate N        decimation factor 1, 2, 4 or 8 (default: as captured)\n"
+			"  --hop MS            time between spectra (default: as captured)\n"
+			"  --attack MS         rise time constant (default: as captured)\n"
+			"  --release MS        fall time constant (default: as captured)\n"
+			"  --channel C         channel to analyse (default: 0)\n"
+			"  --repeat N          timed passes over the capture (default: 5)\n"
+			"  --kernels K         post-FFT kernels, auto or scalar (default: auto)\n"
+			"  --bands N           only N bands are shown, as by the bar modes; a Goertzel\n"
+			"                      bank replaces the FFT when that is cheaper (default: all bins)\n"
+			"  --top HZ            top of the shown range for --bands (default: 12000)\n"
+			"  --pitch on|off      track the pitch of the analysed channel (default: off)\n"
+			"  --write-golden F    store the spectra as a float16 flight recording\n"
+			"  --golden F          compare the spectra against a golden recording\n"
+			"  --tolerance DB      largest allowed difference per bin (default: 0.1)\n"
+			"\n"
+			"Exits with status 2 when the spectra don't match the golden file.\n");
+}
+
+static double to_db(float value)
+{
+	double db = value > 0.0f ? 20.0 * log10(value) : GOLDEN_FLOOR_DB;
+	return db < GOLDEN_FLOOR_DB ? GOLDEN_FLOOR_DB : db;
+}
+
+struct Options {
+	AnalyzerConfig config;
+	double hop_ms = 0.0; // 0 keeps the captured hop
+	float attack_ms = 0.0f;
+	float release_ms = 0.0f;
+	uint32_t channel = 0;
+	size_t bands = 0;
+	float top_hz = 12000.0f;
+	int repeat = 5;
+	const char *write_golden = nullptr;
+	const char *golden = nullptr;
+	double tolerance = 0.1;
+};
+
+static bool parse_options(int argc, char **argv, Options &opt)
+{
+	for (int i = 2; i < argc; i++) {
+		if (i + 1 >= argc)
+			return false;
+		const char *value = argv[++i];
+		const char *name = argv[i - 1];
+
+		if (strcmp(name, "--fft") == 0)
+			opt.config.fft_size = (size_t)strtoul(value, nullptr, 10);
+		else if (strcmp(name, "--decimate") == 0)
+			opt.config.decimation = atoi(value);
+		else if (strcmp(name, "--hop") == 0)
+			opt.hop_ms = atof(value);
+		else if (strcmp(name, "--attack") == 0)
+			opt.attack_ms = (float)atof(value);
+		else if (strcmp(name, "--release") == 0)
+			opt.release_ms = (float)atof(value);
+		else if (strcmp(name, "--channel") == 0)
+			opt.channel = (uint32_t)atoi(value);
+		else if (strcmp(name, "--repeat") == 0)
+			opt.repeat = atoi(value);
+		else if (strcmp(name, "--kernels") == 0 && (strcmp(value, "auto") == 0 || strcmp(value, "scalar") == 0))
+			opt.config.reference_kernels = strcmp(value, "scalar") == 0;
+		else if (strcmp(name, "--bands") == 0)
+			opt.bands = (size_t)strtoul(value, nullptr, 10);
+		else if (strcmp(name, "--top") == 0)
+			opt.top_hz = (float)atof(value);
+		else if (strcmp(name, "--pitch") == 0 && (strcmp(value, "on") == 0 || strcmp(value, "off") == 0))
+			opt.config.pitch = strcmp(value, "on") == 0;
+		else if (strcmp(name, "--write-golden") == 0)
+			opt.write_golden = value;
+		else if (strcmp(name, "--golden") == 0)
+			opt.golden = value;
+		else if (strcmp(name, "--tolerance") == 0)
+			opt.tolerance = atof(value);
+		else
+			return false;
+	}
+
+	size_t n = opt.config.fft_size;
+	int d = opt.config.decimation;
+	if (opt.hop_ms > 0.0)
+		opt.config.hop = (size_t)(opt.hop_ms * opt.config.sample_rate / d / 1000.0);
+	if (opt.bands > 0 && n >= 2)
+		opt.config.SetBands(opt.bands, opt.top_hz);
+	return opt.config.hop > 0 && n >= 2 && (n & (n - 1)) == 0 && (d == 1 || d == 2 || d == 4 || d == 8) &&
+	       opt.repeat >= 0;
+}
+
+// Untimed pass that writes and/or checks the golden spectra. Returns the
+// number of mismatching frames, or -1 if a file couldn't be used.
+static long verify(const CaptureReader &capture, SpectrumAnalyzer &analyzer, const Options &opt)
+{
+	uint32_t bins = (uint32_t)analyzer.NumBins();
+	float analysis_rate = opt.config.sample_rate / (float)opt.config.decimation;
+
+	FlightRecorder writer;
+	if (opt.write_golden && !writer.Start(opt.write_golden, bins, FLIGHT_ENCODING_FLOAT16,
+					      (uint32_t)opt.config.fft_size, analysis_rate)) {
+		fprintf(stderr, "Failed to create '%s'\n", opt.write_golden);
+		return -1;
+	}
+
+	FlightReader golden;
+	if (opt.golden) {
+		if (!golden.Open(opt.golden)) {
+			fprintf(stderr, "Failed to open golden file '%s'\n", opt.golden);
+			return -1;
+		}
+		if (golden.Header().band_count != bins || golden.Header().fft_size != opt.config.fft_size) {
+			fprintf(stderr, "Golden file has %u bands of a %u-point FFT, expected %u of %zu\n",
+				golden.Header().band_count, golden.Header().fft_size, bins, opt.config.fft_size);
+			return -1;
+		}
+	}
+
+	analyzer.Reset();
+	size_t frame_index = 0;
+	long mismatches = 0;
+	double worst = 0.0;
+	FlightFrame expected;
+
+	for (size_t i = 0; i < capture.BlockCount(); i++) {
+		const CaptureBlock &block = capture.Block(i);
+		uint64_t first_new = analyzer.Published();
+		analyzer.Process(block.data[opt.channel], block.frames, block.timestamp);
+		if (first_new < analyzer.OldestFrame()) {
+			fprintf(stderr, "block %zu completed more spectra than the history holds\n", i);
+			return -1;
+		}
+
+		for (uint64_t f = first_new; f < analyzer.Published(); f++) {
+			ArenaSpan<float> spectrum = analyzer.Frame(f);
+			uint64_t timestamp = analyzer.FrameTime(f);
+
+			if (opt.write_golden) {
+				FlightFrameStats stats = {timestamp, 0.0f, 0.0f, 0};
+				writer.Append(stats, spectrum.data(), spectrum.size());
+				writer.Maintain();
+			}
+
+			if (opt.golden) {
+				if (frame_index >= golden.FrameCount() || !golden.ReadFrame(frame_index, expected) ||
+				    expected.stats.timestamp != timestamp) {
+					if (mismatches++ < 10)
+						fprintf(stderr, "frame %zu: missing or out of step in the golden file\n",
+							frame_index);
+				} else {
+					double frame_worst = 0.0;
+					size_t worst_bin = 0;
+					for (size_t b = 0; b < spectrum.size(); b++) {
+						double diff = fabs(to_db(spectrum[b]) - to_db(expected.bands[b]));
+						if (diff > frame_worst) {
+							frame_worst = diff;
+							worst_bin = b;
+						}
+					}
+					if (frame_worst > worst)
+						worst = frame_worst;
+					if (frame_worst > opt.tolerance && mismatches++ < 10)
+						fprintf(stderr, "frame %zu: bin %zu differs by %.3f dB\n", frame_index,
+							worst_bin, frame_worst);
+				}
+			}
+			frame_index++;
+		}
+	}
+
+	if (opt.write_golden) {
+		printf("golden:        wrote %zu spectra to %s\n", frame_index, opt.write_golden);
+		writer.Stop();
+	}
+	if (opt.golden) {
+		if (frame_index != golden.FrameCount()) {
+			fprintf(stderr, "golden file has %zu spectra, replay produced %zu\n", golden.FrameCount(),
+				frame_index);
+			mismatches++;
+		}
+		printf("golden:        %s (%zu spectra, worst bin %.4f dB, tolerance %.4f dB)\n",
+		       mismatches ? "MISMATCH" : "match", frame_index, worst, opt.tolerance);
+	}
+	return mismatches;
+}
+
+static void benchmark(const CaptureReader &capture, SpectrumAnalyzer &analyzer, const Options &opt)
+{
+	using clock = std::chrono::steady_clock;
+	const CaptureFileHeader &h = capture.Header();
+
+	uint64_t samples = 0;
+	for (size_t i = 0; i < capture.BlockCount(); i++)
+		samples += capture.Block(i).frames;
+
+	double total_seconds = 0.0;
+	double worst_callback = 0.0;
+	uint64_t spectra = 0;
+	uint64_t onsets = 0; // First pass only
+	uint64_t beats = 0;
+	float tempo = 0.0f;
+	uint64_t pitched = 0; // Spectra with a confident pitch
+	float pitch = 0.0f;   // The last one
+
+	for (int pass = 0; pass < opt.repeat; pass++) {
+		analyzer.Reset();
+		for (size_t i = 0; i < capture.BlockCount(); i++) {
+			const CaptureBlock &block = capture.Block(i);
+			auto start = clock::now();
+			uint64_t before = analyzer.Published();
+			{
+				AllocCheckScope alloc_scope("audio callback");
+				analyzer.Process(block.data[opt.channel], block.frames, block.timestamp);
+			}
+			spectra += analyzer.Published() - before;
+			double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+			total_seconds += elapsed;
+			if (elapsed > worst_callback)
+				worst_callback = elapsed;
+
+			for (uint64_t f = before; pass == 0 && f < analyzer.Published(); f++) {
+				const AudioFeatures &features = analyzer.Features(f);
+				onsets += features.onset > 0.0f;
+				beats += features.beat;
+				tempo = features.tempo_bpm;
+				if (features.pitch_confidence >= 0.9f) {
+					pitched++;
+					pitch = features.pitch_hz;
+				}
+			}
+		}
+	}
+
+	if (opt.repeat == 0 || total_seconds <= 0.0)
+		return;
+
+	double audio_seconds = (double)samples * opt.repeat / h.sample_rate;
+	double callbacks = (double)capture.BlockCount() * opt.repeat;
+	printf("passes:        %d\n", opt.repeat);
+	printf("spectra:       %llu\n", (unsigned long long)spectra);
+	printf("throughput:    %.2f Msamples/s (%.0fx realtime)\n", (double)samples * opt.repeat / total_seconds / 1e6,
+	       audio_seconds / total_seconds);
+	printf("callback:      %.2f us mean, %.2f us worst\n", total_seconds / callbacks * 1e6, worst_callback * 1e6);
+	printf("features:      %llu onsets, %llu beats, %.1f BPM at the end\n", (unsigned long long)onsets,
+	       (unsigned long long)beats, tempo);
+	if (opt.config.pitch)
+		printf("pitch:         confident on %.1f%% of spectra, last %.1f Hz\n",
+		       spectra ? 100.0 * (double)pitched * opt.repeat / (double)spectra : 0.0, pitch);
+}
+
+// Loudness of the whole capture over all its channels, as the loudness modes
+// would meter it, with the meter's own cost
+static void meter_loudness(const CaptureReader &capture)
+{
+	using clock = std::chrono::steady_clock;
+	const CaptureFileHeader &h = capture.Header();
+	size_t channels = h.channels < LOUDNESS_MAX_CHANNELS ? h.channels : LOUDNESS_MAX_CHANNELS;
+	LoudnessMeter meter;
+	meter.Configure((float)h.sample_rate, channels);
+
+	auto start = clock::now();
+	for (size_t i = 0; i < capture.BlockCount(); i++) {
+		const CaptureBlock &block = capture.Block(i);
+		AllocCheckScope alloc_scope("loudness meter");
+		meter.Process(block.data, channels, block.frames);
+	}
+	double seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+	printf("loudness:      %.1f LUFS integrated, %.1f short-term, %.1f dBTP, %.2f us per callback\n",
+	       meter.Integrated(), meter.ShortTerm(), meter.TruePeak(),
+	       capture.BlockCount() ? seconds / (double)capture.BlockCount() * 1e6 : 0.0);
+}
+
+// Stereo correlation of the capture's first two channels, as the vectorscope
+// mode measures it
+static void meter_stereo(const CaptureReader &capture)
+{
+	using clock = std::chrono::steady_clock;
+	const CaptureFileHeader &h = capture.Header();
+	StereoScope scope;
+	scope.Configure((float)h.sample_rate);
+
+	auto start = clock::now();
+	for (size_t i = 0; i < capture.BlockCount(); i++) {
+		const CaptureBlock &block = capture.Block(i);
+		AllocCheckScope alloc_scope("vectorscope");
+		scope.Process(block.data, h.channels, block.frames);
+	}
+	double seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+	printf("stereo:        %+.2f correlation at the end, %.2f us per callback\n", scope.Correlation(),
+	       capture.BlockCount() ? seconds / (double)capture.BlockCount() * 1e6 : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		usage();
+		return 1;
+	}
+
+	CaptureReader capture;
+	if (!capture.Open(argv[1])) {
+		fprintf(stderr, "Failed to open callback capture '%s'\n", argv[1]);
+		return 1;
+	}
+
+	// Defaults come from the analysis settings at capture time
+	const CaptureFileHeader &h = capture.Header();
+	Options opt;
+	opt.config.fft_size = h.fft_size;
+	opt.config.decimation = (int)h.decimation;
+	opt.config.sample_rate = (float)h.sample_rate;
+	opt.config.hop = h.hop;
+	opt.attack_ms = h.attack_ms;
+	opt.release_ms = h.release_ms;
+
+	if (!parse_options(argc, argv, opt) || opt.channel >= h.channels) {
+		usage();
+		return 1;
+	}
+
+	// OBS blocks are far smaller than this; keep the decimator in one chunk
+	uint32_t largest = 0;
+	for (size_t i = 0; i < capture.BlockCount(); i++) {
+		if (capture.Block(i).frames > largest)
+			largest = capture.Block(i).frames;
+	}
+	if (largest > opt.config.max_block)
+		opt.config.max_block = largest;
+
+	// Every spectrum a block completes has to stay readable until it's checked
+	size_t per_block = largest / opt.config.decimation / opt.config.hop + 2;
+	if (per_block > opt.config.history)
+		opt.config.history = per_block;
+
+	SpectrumAnalyzer analyzer;
+	if (!analyzer.Configure(opt.config)) {
+		fprintf(stderr, "Failed to allocate a %zu-point analyzer\n", opt.config.fft_size);
+		return 1;
+	}
+	analyzer.SetTimeConstants(opt.attack_ms, opt.release_ms);
+
+	uint64_t samples = 0;
+	for (size_t i = 0; i < capture.BlockCount(); i++)
+		samples += capture.Block(i).frames;
+
+	printf("capture:       %zu callbacks, %u channels @ %u Hz, %.3f s\n", capture.BlockCount(), h.channels,
+	       h.sample_rate, h.sample_rate ? (double)samples / h.sample_rate : 0.0);
+	printf("analysis:      FFT %zu, decimation %d, hop %zu, attack %.1f ms, release %.1f ms, channel %u\n",
+	       opt.config.fft_size, opt.config.decimation, opt.config.hop, opt.attack_ms, opt.release_ms, opt.channel);
+	printf("kernels:       %s\n", analyzer.Kernels().name);
+	if (opt.config.bands > 0)
+		printf("bands:         %zu of %zu bins each, %s\n", opt.config.bands, opt.config.band_bins,
+		       analyzer.UsesBank() ? "Goertzel bank" : "FFT (the bank would cost more)");
+
+	long mismatches = 0;
+	if (opt.write_golden || opt.golden) {
+		mismatches = verify(capture, analyzer, opt);
+		if (mismatches < 0)
+			return 1;
+	}
+
+	benchmark(capture, analyzer, opt);
+	meter_loudness(capture);
+	meter_stereo(capture);
+#ifdef GLASSLINE_ALLOC_CHECK
+	printf("allocations:   none in steady state (%llu during warm-up)\n",
+	       (unsigned long long)AllocCheckScope::Count());
+#endif
+	return mismatches ? 2 : 0;
+}
@@ -0,0 +1,133 @@
+/* glassline-shm-cat: print frames from GlassLine's shared-memory spectrum feed */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "glassline-shm-reader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_PRINTED_BANDS 64
+#define POLL_NS 2000000L /* 2 ms between polls, well above the feed rate */
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: glassline-shm-cat <name> [options]\n"
+			"\n"
+			"  --latest            only the newest frame at each poll, skipping the rest\n"
+			"  --count N           stop after N frames (default: until the feed closes)\n"
+			"  --bands N           bands printed per frame, pooled from all of them (default: 16)\n"
+			"\n"
+			"<name> is the Shared Memory Name set on the GlassLine source.\n");
+}
+
+static void print_frame(const struct glshm_frame *frame, const float *bands, int printed)
+{
+	printf("%8llu  %14.3f ms  rms", (unsigned long long)frame->index, (double)frame->timestamp_ns / 1e6);
+	for (uint32_t c = 0; c < frame->channels && c < GLSHM_MAX_CHANNELS; c++)
+		printf(" %.3f", frame->rms[c]);
+	printf("  centroid %6.0f Hz  tempo %5.1f  pitch %6.1f Hz (%.2f)  %c%c  |", frame->centroid_hz,
+	       frame->tempo_bpm, frame->pitch_hz, frame->pitch_confidence, (frame->flags & GLSHM_FLAG_ONSET) ? 'O' : '.',
+	       (frame->flags & GLSHM_FLAG_BEAT) ? 'B' : '.');
+
+	/* Loudest band of each group as a digit, relative to the loudest overall */
+	uint32_t count = frame->band_count;
+	float loudest = 0.0f;
+	for (uint32_t b = 0; b < count; b++)
+		loudest = bands[b] > loudest ? bands[b] : loudest;
+	for (int i = 0; i < printed && count > 0; i++) {
+		uint32_t lo = (uint32_t)((uint64_t)i * count / printed);
+		uint32_t hi = (uint32_t)((uint64_t)(i + 1) * count / printed);
+		float value = 0.0f;
+		for (uint32_t b = lo; b < hi; b++)
+			value = bands[b] > value ? bands[b] : value;
+		int digit = loudest > 0.0f ? (int)(value / loudest * 9.0f + 0.5f) : 0;
+		putchar('0' + digit);
+	}
+	printf("|\n");
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2 || argv[1][0] == '-') {
+		usage();
+		return 1;
+	}
+
+	int latest = 0;
+	long long limit = -1;
+	int printed = 16;
+	for (int i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "--latest") == 0) {
+			latest = 1;
+		} else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+			limit = atoll(argv[++i]);
+		} else if (strcmp(argv[i], "--bands") == 0 && i + 1 < argc) {
+			printed = atoi(argv[++i]);
+			if (printed < 1 || printed > MAX_PRINTED_BANDS)
+				printed = 16;
+		} else {
+			usage();
+			return 1;
+		}
+	}
+
+	glshm_reader *reader = glshm_open(argv[1]);
+	if (!reader) {
+		fprintf(stderr, "No GlassLine feed named '%s' (or it has an unknown layout)\n", argv[1]);
+		return 1;
+	}
+	const struct glshm_header *h = glshm_get_header(reader);
+	printf("feed:          %s, writer pid %u, %u slots of up to %u bands\n", argv[1], h->writer_pid,
+	       h->slot_count, h->max_bands);
+
+	float *bands = (float *)malloc(h->max_bands * sizeof(float));
+	if (!bands) {
+		glshm_close(reader);
+		return 1;
+	}
+
+	struct glshm_frame frame;
+	uint64_t next = glshm_written(reader); /* Start with what comes next */
+	unsigned long long shown = 0, lapped = 0;
+	struct timespec poll = {0, POLL_NS};
+
+	while (limit < 0 || (long long)shown < limit) {
+		int result;
+		if (latest) {
+			uint64_t written = glshm_written(reader);
+			result = written > next ? glshm_read_latest(reader, &frame, bands, h->max_bands) : GLSHM_NONE;
+			if (result == GLSHM_OK)
+				next = frame.index + 1;
+		} else {
+			result = glshm_read(reader, next, &frame, bands, h->max_bands);
+			if (result == GLSHM_OK) {
+				next++;
+			} else if (result == GLSHM_LAPPED) {
+				/* Too slow for the ring: skip to the oldest frame still in it */
+				uint64_t written = glshm_written(reader);
+				uint64_t oldest = written > h->slot_count ? written - h->slot_count + 1 : 0;
+				if (oldest > next) {
+					lapped += oldest - next;
+					next = oldest;
+				}
+			}
+		}
+
+		if (result == GLSHM_OK) {
+			print_frame(&frame, bands, printed);
+			shown++;
+		} else if (result == GLSHM_NONE) {
+			if (!glshm_live(reader))
+				break;
+			nanosleep(&poll, NULL);
+		}
+	}
+
+	fprintf(stderr, "%llu frames shown, %llu lost to overruns%s\n", shown, lapped,
+		glshm_live(reader) ? "" : " (feed closed)");
+	free(bands);
+	glshm_close(reader);
+	return 0;
+}
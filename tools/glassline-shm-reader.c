@@ -0,0 +1,123 @@
+#define _POSIX_C_SOURCE 200809L
+#include "glassline-shm-reader.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LATEST_ATTEMPTS 4
+
+struct glshm_reader {
+	const uint8_t *base;
+	size_t size;
+	const struct glshm_header *header;
+};
+
+glshm_reader *glshm_open(const char *name)
+{
+	if (!name || !*name || strlen(name) > 250)
+		return NULL;
+	char path[256];
+	path[0] = '/';
+	strcpy(path + 1, name);
+
+	int fd = shm_open(path, O_RDONLY, 0);
+	if (fd < 0)
+		return NULL;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct glshm_header)) {
+		close(fd);
+		return NULL;
+	}
+	size_t size = (size_t)st.st_size;
+	void *mapped = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED)
+		return NULL;
+
+	/* The layout has to be one we understand and fit the object */
+	const struct glshm_header *h = (const struct glshm_header *)mapped;
+	if (h->magic != GLSHM_MAGIC || h->version != GLSHM_VERSION || h->slot_count == 0 ||
+	    h->slot_size < glshm_slot_size(h->max_bands) ||
+	    (uint64_t)h->header_size + (uint64_t)h->slot_size * h->slot_count > size) {
+		munmap(mapped, size);
+		return NULL;
+	}
+
+	glshm_reader *reader = (glshm_reader *)calloc(1, sizeof(*reader));
+	if (!reader) {
+		munmap(mapped, size);
+		return NULL;
+	}
+	reader->base = (const uint8_t *)mapped;
+	reader->size = size;
+	reader->header = h;
+	return reader;
+}
+
+void glshm_close(glshm_reader *reader)
+{
+	if (!reader)
+		return;
+	munmap((void *)reader->base, reader->size);
+	free(reader);
+}
+
+const struct glshm_header *glshm_get_header(const glshm_reader *reader)
+{
+	return reader->header;
+}
+
+int glshm_live(const glshm_reader *reader)
+{
+	return __atomic_load_n(&reader->header->state, __ATOMIC_ACQUIRE) == GLSHM_STATE_LIVE;
+}
+
+uint64_t glshm_written(const glshm_reader *reader)
+{
+	return __atomic_load_n(&reader->header->write_index, __ATOMIC_ACQUIRE);
+}
+
+int glshm_read(const glshm_reader *reader, uint64_t index, struct glshm_frame *frame, float *bands,
+	       uint32_t max_bands)
+{
+	const struct glshm_header *h = reader->header;
+	const uint8_t *slot = reader->base + h->header_size + (size_t)(index % h->slot_count) * h->slot_size;
+	const struct glshm_frame *src = (const struct glshm_frame *)slot;
+	const uint64_t complete = 2 * index + 2;
+
+	/* Lower: an older lap, or this frame still being written */
+	uint64_t before = __atomic_load_n(&src->sequence, __ATOMIC_ACQUIRE);
+	if (before != complete)
+		return before < complete ? GLSHM_NONE : GLSHM_LAPPED;
+
+	memcpy(frame, src, sizeof(*frame));
+	uint32_t count = frame->band_count < h->max_bands ? frame->band_count : h->max_bands;
+	if (count > max_bands)
+		count = max_bands;
+	if (bands)
+		memcpy(bands, slot + sizeof(struct glshm_frame), count * sizeof(float));
+
+	/* The copy only counts if the writer didn't start on the slot meanwhile */
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&src->sequence, __ATOMIC_RELAXED) != complete)
+		return GLSHM_LAPPED;
+	frame->sequence = complete;
+	frame->band_count = count;
+	return GLSHM_OK;
+}
+
+int glshm_read_latest(const glshm_reader *reader, struct glshm_frame *frame, float *bands, uint32_t max_bands)
+{
+	for (int attempt = 0; attempt < LATEST_ATTEMPTS; attempt++) {
+		uint64_t written = glshm_written(reader);
+		if (written == 0)
+			return GLSHM_NONE;
+		int result = glshm_read(reader, written - 1, frame, bands, max_bands);
+		if (result != GLSHM_LAPPED)
+			return result;
+	}
+	return GLSHM_LAPPED;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+/*
+ * Reader for GlassLine's shared-memory spectrum feed
+ * Maps the feed read-only and copies frames out under the slot seqlocks
+ * (see glassline-shm.h). Plain C; link glassline-shm-reader.c, or the
+ * glassline-shm static library from the tools build.
+ */
+
+#include "glassline-shm.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct glshm_reader glshm_reader;
+
+/* Results of the read calls */
+#define GLSHM_OK 1
+#define GLSHM_NONE 0    /* Nothing new yet */
+#define GLSHM_LAPPED -1 /* The writer overwrote the frame while (or before) it was read */
+
+/* `name` as set on the source, without the leading slash. NULL if the feed
+ * doesn't exist or has an unknown layout. */
+glshm_reader *glshm_open(const char *name);
+void glshm_close(glshm_reader *reader);
+
+const struct glshm_header *glshm_get_header(const glshm_reader *reader);
+
+/* False once the writer has closed the feed (the source stopped publishing) */
+int glshm_live(const glshm_reader *reader);
+
+/* Frames published so far; the newest is glshm_written() - 1 */
+uint64_t glshm_written(const glshm_reader *reader);
+
+/* Copies frame `index` and up to `max_bands` of its bands; band_count in the
+ * copy is the number copied. GLSHM_NONE if it isn't published yet,
+ * GLSHM_LAPPED if it has already been overwritten. */
+int glshm_read(const glshm_reader *reader, uint64_t index, struct glshm_frame *frame, float *bands,
+	       uint32_t max_bands);
+
+/* Newest complete frame, retrying while the writer laps the reader */
+int glshm_read_latest(const glshm_reader *reader, struct glshm_frame *frame, float *bands, uint32_t max_bands);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,725 @@
+// glassline-stress: hammer the visualizer's locking from the threads OBS
+// drives it on, check that nothing breaks and report how long each lock
+// kept its callers waiting
+//
+// Each StressSource is a VisualizerCore, the shared state and locking
+// GlassLineSource is built on, driven through the same methods the plugin
+// calls. Only the OBS side is stood in for: the audio source's callback
+// list, the video clock and the GPU.
+//
+// Threads, each at its own rate:
+//   audio   a block through each input's callback list (AudioCallback)
+//   render  every live source reads what it would draw (Render)
+//   tick    governor step on a made-up OBS frame time, mapping ahead and
+//           replay under flight_mutex (Tick)
+//   update  new settings and layers (ApplySettings), then recorder, capture,
+//           publisher and replay changes under flight_mutex (UpdateFlight)
+//   rebind  moves a source to the other input (SetAudioSource), or drops it
+//           and creates a new one while audio is in flight (destroy/create)
+//
+// Checks: flight_mutex is never taken after audio_mutex, no callback reaches
+// a destroyed source, published spectra never go back within a layout, the
+// display matches the layout it is drawn with and holds finite values.
+// Configure the tools with -D GLASSLINE_TSAN=ON to have ThreadSanitizer look
+// for data races as well, or -D GLASSLINE_ALLOC_CHECK=ON to abort on heap
+// allocations in the audio callback and render path once they have warmed
+// up. Exits with status 2 when a check fails.
+
+#include "visualizer-core.hpp"
+#include "alloc-check.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#define STRESS_RATE 48000.0f
+#define STRESS_CHANNELS 2
+#define SOURCE_ALIVE 0x6C697665u
+#define SOURCE_DEAD 0xDEADDEADu
+#define WAIT_BUCKETS 40 // Powers of two from 1 ns
+#define MAX_REPORTED_FAILURES 8
+
+static void usage()
+{
+	fprintf(stderr, "usage: glassline-stress [options]\n"
+			"\n"
+			"  --seconds S         run time (default: 10)\n"
+			"  --sources N         visualizers sharing two inputs (default: 4)\n"
+			"  --block N           frames per audio block (default: 1024)\n"
+			"  --audio-rate HZ     audio blocks per second per input (default: 1000)\n"
+			"  --render-rate HZ    rendered frames per second (default: 240)\n"
+			"  --tick-rate HZ      video ticks per second (default: 240)\n"
+			"  --update-rate HZ    settings changes per second (default: 50)\n"
+			"  --rebind-rate HZ    rebinds or re-creations per second (default: 20)\n"
+			"  --min-rate PCT      share of its rate each thread must reach (default: 90)\n"
+			"  --no-files          leave out the recorder, capture and publisher\n"
+			"  --seed N            random seed (default: 1)\n"
+			"\n"
+			"A rate of 0 runs that thread flat out. Exits with status 2 when a check fails,\n"
+			"including a thread falling short of its rate: the load it was meant to test\n"
+			"wasn't applied.\n");
+}
+
+enum ThreadRole { ROLE_AUDIO, ROLE_RENDER, ROLE_TICK, ROLE_UPDATE, ROLE_REBIND, ROLE_COUNT };
+static const char *const role_names[ROLE_COUNT] = {"audio", "render", "tick", "update", "rebind"};
+static thread_local int thread_role = ROLE_REBIND;
+
+static std::atomic<uint64_t> failures{0};
+
+static void fail(const char *what)
+{
+	if (failures.fetch_add(1) < MAX_REPORTED_FAILURES)
+		fprintf(stderr, "FAILED (%s thread): %s\n", role_names[thread_role], what);
+}
+
+static uint64_t now_ns()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		       std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+// Waits of the contended acquisitions, in power-of-two nanosecond buckets
+struct WaitHistogram {
+	std::atomic<uint64_t> acquired{0};
+	std::atomic<uint64_t> contended{0};
+	std::atomic<uint64_t> total_wait{0};
+	std::atomic<uint64_t> max_wait{0};
+	std::atomic<uint64_t> counts[WAIT_BUCKETS] = {};
+
+	void Add(uint64_t wait, bool was_contended)
+	{
+		acquired.fetch_add(1, std::memory_order_relaxed);
+		if (!was_contended)
+			return;
+		contended.fetch_add(1, std::memory_order_relaxed);
+		total_wait.fetch_add(wait, std::memory_order_relaxed);
+		uint64_t seen = max_wait.load(std::memory_order_relaxed);
+		while (wait > seen && !max_wait.compare_exchange_weak(seen, wait, std::memory_order_relaxed)) {
+		}
+		int bucket = 0;
+		while (bucket < WAIT_BUCKETS - 1 && (wait >> (bucket + 1)) != 0)
+			bucket++;
+		counts[bucket].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Upper edge of the bucket holding the given fraction of contended waits
+	uint64_t Percentile(double fraction) const
+	{
+		uint64_t total = contended.load(std::memory_order_relaxed);
+		if (total == 0)
+			return 0;
+		uint64_t target = (uint64_t)ceil(fraction * (double)total), seen = 0;
+		for (int i = 0; i < WAIT_BUCKETS; i++) {
+			seen += counts[i].load(std::memory_order_relaxed);
+			if (seen >= target)
+				return std::min(2ull << i, (unsigned long long)max_wait.load(std::memory_order_relaxed));
+		}
+		return max_wait.load(std::memory_order_relaxed);
+	}
+};
+
+// One kind of lock across all sources, split by the thread taking it
+struct LockStats {
+	explicit LockStats(const char *name) : name(name) {}
+
+	const char *name;
+	WaitHistogram roles[ROLE_COUNT];
+};
+
+static LockStats input_stats("input callbacks");
+static LockStats flight_stats("flight_mutex");
+static LockStats audio_stats("audio_mutex");
+
+// Ranks the locks a thread holds (CoreMutex ranks: flight_mutex 0,
+// audio_mutex 1); a lock may only be taken while every held one ranks lower.
+// Callback lists and flight_mutex are never nested, so they share rank 0.
+static thread_local uint32_t held_ranks = 0;
+
+static void check_order(int rank)
+{
+	if (held_ranks >> rank)
+		fail("lock taken out of order (flight_mutex must come before audio_mutex)");
+}
+
+static void note_locked(LockStats *stats, int rank, uint64_t wait, bool contended)
+{
+	stats->roles[thread_role].Add(wait, contended);
+	held_ranks |= 1u << rank;
+}
+
+static void note_unlocked(int rank)
+{
+	held_ranks &= ~(1u << rank);
+}
+
+// Sees every flight_mutex and audio_mutex acquisition of every source
+struct LockObserver : CoreMutex::Observer {
+	void Locking(int rank) override { check_order(rank); }
+
+	void Locked(int rank, uint64_t wait_ns, bool contended) override
+	{
+		note_locked(rank == 0 ? &flight_stats : &audio_stats, rank, wait_ns, contended);
+	}
+
+	void Unlocked(int rank) override { note_unlocked(rank); }
+};
+
+static LockObserver lock_observer;
+
+// Stands in for the lock OBS holds over an audio source's callback list
+class InputMutex {
+public:
+	void lock()
+	{
+		check_order(0);
+		if (mutex.try_lock()) {
+			note_locked(&input_stats, 0, 0, false);
+		} else {
+			uint64_t start = now_ns();
+			mutex.lock();
+			note_locked(&input_stats, 0, now_ns() - start, true);
+		}
+	}
+
+	void unlock()
+	{
+		note_unlocked(0);
+		mutex.unlock();
+	}
+
+private:
+	std::mutex mutex;
+};
+
+struct StressSource;
+
+// An audio source's capture callback list (or an Audio Tap's listeners): the
+// list lock is held while a block is handed out, so once Remove() returns no
+// callback for that listener is still running
+struct StressInput {
+	InputMutex mutex;
+	std::vector<StressSource *> listeners;
+
+	void Add(StressSource *source)
+	{
+		std::lock_guard<InputMutex> lock(mutex);
+		listeners.push_back(source);
+	}
+
+	void Remove(StressSource *source)
+	{
+		std::lock_guard<InputMutex> lock(mutex);
+		listeners.erase(std::remove(listeners.begin(), listeners.end(), source), listeners.end());
+	}
+
+	void Deliver(const float *const *planes, uint32_t frames, uint64_t timestamp);
+};
+
+struct StressOptions {
+	double seconds = 10.0;
+	int sources = 4;
+	uint32_t block = 1024;
+	double rates[ROLE_COUNT] = {1000.0, 240.0, 240.0, 50.0, 20.0};
+	double min_rate = 0.9; // Share of the rate a thread has to reach
+	bool files = true;
+	uint32_t seed = 1;
+};
+
+static StressOptions options;
+static std::string file_dir;
+static std::atomic<uint32_t> next_source_id{0};
+static std::atomic<uint64_t> audio_clock{1000000000ull}; // Stands in for the video clock
+static std::atomic<uint64_t> layouts_total{0}, replays{0};
+
+// Random settings, as from the properties: everything the core reconfigures on
+static void random_settings(std::mt19937 &rng, CoreSettings &settings, std::vector<VisualLayer> &layers)
+{
+	static const float top_freqs[] = {4000.0f, 12000.0f, 20000.0f};
+	static const size_t bands[] = {0, 0, 32, 64};
+	settings.attack_ms = (float)(rng() % 100);
+	settings.release_ms = (float)(rng() % 500);
+	settings.hop_ms = (float)MIN_HOP_MS + (float)(rng() % 28);
+	settings.governor = rng() % 2 == 0;
+	settings.decimate = rng() % 2 == 0;
+	settings.top_freq = top_freqs[rng() % 3];
+	settings.sample_rate = STRESS_RATE;
+	settings.channels = STRESS_CHANNELS;
+	settings.peak_hold = rng() % 2 == 0;
+	settings.loudness = rng() % 2 == 0;
+	settings.scope = rng() % 2 == 0;
+	settings.pitch = rng() % 2 == 0;
+	settings.bands = bands[rng() % 4];
+	layers.resize(1 + rng() % MAX_LAYERS);
+}
+
+struct StressSource : VisualizerCore {
+	std::atomic<uint32_t> magic{SOURCE_ALIVE};
+	uint32_t id;
+	StressInput *input = nullptr; // Changed by the rebind thread only
+
+	// Render thread only
+	uint64_t seen_layouts = 0;
+	uint64_t seen_published = 0;
+	std::vector<float> wave_min, wave_max;
+
+	// Tick thread only
+	uint64_t last_tick = 0; // now_ns() of the previous tick, 0 before the first
+
+	// Update thread, under flight_mutex
+	std::string record_key;
+	std::string recording;   // Last finished recording, replayed now and then
+	uint32_t recordings = 0; // Numbers them, so the one replayed is never overwritten
+	bool capturing = false;
+	bool publishing = false;
+
+	StressSource() : id(next_source_id.fetch_add(1)), wave_min(256), wave_max(256)
+	{
+		CoreSettings settings;
+		settings.sample_rate = STRESS_RATE;
+		settings.channels = STRESS_CHANNELS;
+		std::vector<VisualLayer> new_layers(1);
+		ApplySettings(settings, new_layers);
+	}
+
+	~StressSource()
+	{
+		// As the real destructor: unbind first, audio may still be arriving
+		SetInput(nullptr);
+		magic.store(SOURCE_DEAD);
+		std::lock_guard<CoreMutex> guard(flight_mutex);
+		UpdateFlight(false, false, false, false);
+		if (!recording.empty())
+			std::remove(recording.c_str());
+		layouts_total.fetch_add(layouts, std::memory_order_relaxed);
+	}
+
+	void SetInput(StressInput *new_input)
+	{
+		if (input)
+			input->Remove(this);
+		input = new_input;
+		if (input)
+			input->Add(this);
+	}
+
+	void AnalysisFailed(size_t fft_size) override
+	{
+		(void)fft_size;
+		fail("analyzer configuration");
+	}
+
+	void AudioCallback(const float *const *planes, uint32_t frames, uint64_t timestamp)
+	{
+		if (magic.load(std::memory_order_relaxed) != SOURCE_ALIVE)
+			fail("audio callback reached a destroyed source");
+		VisualizerCore::AudioCallback(planes, frames, timestamp);
+	}
+
+	// What GlassLineSource::Render() reads, with the drawing left out
+	void Render()
+	{
+		AllocCheckScope alloc_scope("render");
+		uint64_t video_time = audio_clock.load(std::memory_order_relaxed);
+		std::lock_guard<CoreMutex> lock(audio_mutex);
+		uint64_t render_start = Now();
+		if (display_magnitudes.size() != analyzer.NumBins())
+			fail("display doesn't match the analysis layout");
+
+		uint64_t published = analyzer.Published();
+		if (layouts == seen_layouts && published < seen_published)
+			fail("published spectra went back without a reconfigure");
+		seen_layouts = layouts;
+		seen_published = published;
+
+		// Timestamps aren't checked: a source moved to the other input
+		// mid-block sees that block twice
+		if (UpdateDisplaySpectrum(video_time)) {
+			bool finite = true;
+			for (float value : display_magnitudes)
+				finite = finite && std::isfinite(value);
+			if (!finite)
+				fail("display spectrum holds a non-finite magnitude");
+		}
+
+		if (waveform.Total() > 0)
+			waveform.Query(waveform.Total(), waveform.Capacity() / 4, wave_min.size(), wave_min.data(),
+				       wave_max.data());
+		if (any_loudness && std::isnan(loudness.Momentary()))
+			fail("momentary loudness is NaN"); // -inf in silence
+		if (any_scope)
+			scope.ClearHits();
+		render_cost_ns += Now() - render_start;
+	}
+
+	void Tick(std::mt19937 &rng)
+	{
+		std::lock_guard<CoreMutex> guard(flight_mutex);
+
+		// OBS somewhere between idle and twice over its frame budget
+		const uint64_t interval = 1000000000ull / 60;
+		GovernorStep step;
+		Govern(rng() % (2 * interval), interval, step);
+		// The time since the last tick, as OBS passes it, rather than the
+		// configured interval: there's none when ticking flat out
+		uint64_t now = now_ns();
+		float seconds = last_tick ? (float)(now - last_tick) / 1e9f : 0.0f;
+		last_tick = now;
+		Maintain(seconds, audio_clock.load(std::memory_order_relaxed));
+	}
+
+	void Update(std::mt19937 &rng)
+	{
+		CoreSettings settings;
+		std::vector<VisualLayer> new_layers;
+		random_settings(rng, settings, new_layers);
+		ApplySettings(settings, new_layers);
+
+		std::lock_guard<CoreMutex> guard(flight_mutex);
+		bool files = options.files;
+		UpdateFlight(files && rng() % 3 == 0, files && rng() % 4 == 0, files && rng() % 2 == 0,
+			     files && rng() % 4 == 0);
+	}
+
+	// Call with flight_mutex held. As in GlassLineSource::UpdateFlight(), the
+	// old object is swapped out and stopped before its replacement starts,
+	// and both are built and torn down outside audio_mutex.
+	void UpdateFlight(bool record, bool new_capturing, bool new_publishing, bool replay_last)
+	{
+		std::string replay_path = replay_last ? recording : std::string();
+		if (replay_path != (replaying ? recording : std::string())) {
+			if (SetReplay(replay_path) && replaying)
+				replays.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		size_t bands, fft;
+		float rate;
+		{
+			std::lock_guard<CoreMutex> lock(audio_mutex);
+			bands = analyzer.NumBins();
+			fft = analyzer.Config().fft_size;
+			rate = analysis_rate;
+		}
+		std::string base = file_dir + "/stress-" + std::to_string(id);
+
+		std::string key;
+		if (record && !replaying)
+			key = std::to_string(fft) + "|" + std::to_string(rate) + "|" + std::to_string(bands);
+		if (key != record_key) {
+			record_key = key;
+			std::unique_ptr<FlightRecorder> rec = SwapRecorder(nullptr);
+			if (rec) {
+				// Kept for replay, unless a replay still has the last one open
+				std::string path = rec->Path();
+				rec.reset();
+				if (!recording.empty() && !replaying)
+					std::remove(recording.c_str());
+				if (replaying)
+					std::remove(path.c_str());
+				else
+					recording = path;
+			}
+			if (!key.empty()) {
+				rec.reset(new FlightRecorder());
+				std::string path = base + "-" + std::to_string(recordings++) + ".glfr";
+				if (!rec->Start(path.c_str(), (uint32_t)bands, FLIGHT_ENCODING_LOG8, (uint32_t)fft,
+						rate))
+					fail("flight recorder start");
+				SwapRecorder(std::move(rec));
+			}
+		}
+
+		if (new_capturing != capturing) {
+			capturing = new_capturing;
+			std::unique_ptr<CaptureWriter> writer = SwapCapture(nullptr);
+			if (writer) {
+				std::string path = writer->Path();
+				writer.reset();
+				std::remove(path.c_str());
+			}
+			if (capturing) {
+				writer.reset(new CaptureWriter());
+				if (!writer->Start((base + ".glcap").c_str(), (uint32_t)STRESS_RATE, STRESS_CHANNELS,
+						   (uint32_t)fft, 1, 480, 20.0f, 150.0f))
+					fail("callback capture start");
+				SwapCapture(std::move(writer));
+			}
+		}
+
+		if (new_publishing != publishing) {
+			publishing = new_publishing;
+			SwapPublisher(nullptr).reset();
+#ifndef _WIN32
+			if (publishing) {
+				std::string name = "glassline-stress-" + std::to_string(getpid()) + "-" + std::to_string(id);
+				std::unique_ptr<ShmPublisher> pub(new ShmPublisher());
+				if (!pub->Open(name.c_str(), 4096, 64))
+					fail("shared-memory publisher open");
+				SwapPublisher(std::move(pub));
+			}
+#endif
+		}
+	}
+};
+
+void StressInput::Deliver(const float *const *planes, uint32_t frames, uint64_t timestamp)
+{
+	std::lock_guard<InputMutex> lock(mutex);
+	for (StressSource *source : listeners)
+		source->AudioCallback(planes, frames, timestamp);
+}
+
+// Live sources; threads other than rebind hold a reference while they use
+// one, as OBS does, so the last of them runs the destructor
+static std::mutex sources_mutex;
+static std::vector<std::shared_ptr<StressSource>> sources;
+static StressInput inputs[2];
+static std::atomic<bool> running{true};
+static std::atomic<uint64_t> iterations[ROLE_COUNT];
+static std::atomic<uint64_t> rebinds{0}, recreations{0};
+
+static std::vector<std::shared_ptr<StressSource>> snapshot()
+{
+	std::lock_guard<std::mutex> lock(sources_mutex);
+	return sources;
+}
+
+// Runs `step` at `rate` per second (flat out at 0) until the run ends
+template<typename Step> static void run_thread(int role, Step step)
+{
+	thread_role = role;
+	double rate = options.rates[role];
+	auto start = std::chrono::steady_clock::now();
+	for (uint64_t n = 0; running.load(std::memory_order_relaxed); n++) {
+		step();
+		iterations[role].fetch_add(1, std::memory_order_relaxed);
+		if (rate > 0.0)
+			std::this_thread::sleep_until(start + std::chrono::duration<double>((double)(n + 1) / rate));
+	}
+}
+
+static void audio_thread()
+{
+	std::vector<float> left(options.block), right(options.block);
+	const float *planes[STRESS_CHANNELS] = {left.data(), right.data()};
+	std::mt19937 rng(options.seed);
+	std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+	uint64_t timestamp = 1000000000ull;
+	double phase = 0.0;
+
+	run_thread(ROLE_AUDIO, [&]() {
+		// A slowly sweeping tone, loud enough for onsets and beats to fire
+		double freq = 200.0 + 1800.0 * (0.5 + 0.5 * sin((double)timestamp * 1e-9));
+		for (uint32_t i = 0; i < options.block; i++) {
+			phase += 2.0 * M_PI * freq / STRESS_RATE;
+			left[i] = 0.5f * (float)sin(phase) + noise(rng);
+			right[i] = noise(rng);
+		}
+		for (StressInput &input : inputs)
+			input.Deliver(planes, options.block, timestamp);
+		timestamp += (uint64_t)((double)options.block * 1e9 / STRESS_RATE);
+		audio_clock.store(timestamp, std::memory_order_relaxed);
+	});
+}
+
+static void per_source_thread(int role)
+{
+	std::mt19937 rng(options.seed * 31 + (uint32_t)role);
+	run_thread(role, [&]() {
+		for (const std::shared_ptr<StressSource> &source : snapshot()) {
+			if (role == ROLE_RENDER)
+				source->Render();
+			else if (role == ROLE_TICK)
+				source->Tick(rng);
+			else
+				source->Update(rng);
+		}
+	});
+}
+
+static void rebind_thread()
+{
+	std::mt19937 rng(options.seed * 17);
+	run_thread(ROLE_REBIND, [&]() {
+		std::shared_ptr<StressSource> source;
+		size_t slot;
+		{
+			std::lock_guard<std::mutex> lock(sources_mutex);
+			slot = rng() % sources.size();
+			source = sources[slot];
+		}
+
+		if (rng() % 2 == 0) {
+			source->SetInput(source->input == &inputs[0] ? &inputs[1] : &inputs[0]);
+			rebinds.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		// Replace it; the old one goes when the last thread using it lets go
+		std::shared_ptr<StressSource> fresh = std::make_shared<StressSource>();
+		fresh->SetInput(&inputs[rng() % 2]);
+		{
+			std::lock_guard<std::mutex> lock(sources_mutex);
+			sources[slot] = fresh;
+		}
+		source.reset();
+		recreations.fetch_add(1, std::memory_order_relaxed);
+	});
+}
+
+static void print_us(uint64_t ns)
+{
+	printf(" %10.1f", (double)ns / 1000.0);
+}
+
+static void report(double elapsed)
+{
+	printf("run:           %.1f s, %d sources, %u-frame blocks\n", elapsed, options.sources, options.block);
+	for (int role = 0; role < ROLE_COUNT; role++) {
+		printf("%-14s %llu iterations (%.0f/s", (std::string(role_names[role]) + ":").c_str(),
+		       (unsigned long long)iterations[role].load(), (double)iterations[role].load() / elapsed);
+		if (options.rates[role] > 0.0)
+			printf(" of %.0f/s)\n", options.rates[role]);
+		else
+			printf(", flat out)\n");
+	}
+	printf("rebinds:       %llu moved, %llu re-created\n", (unsigned long long)rebinds.load(),
+	       (unsigned long long)recreations.load());
+	printf("layouts:       %llu analysis layouts, %llu replays\n\n", (unsigned long long)layouts_total.load(),
+	       (unsigned long long)replays.load());
+
+	printf("%-16s %-7s %12s %10s %10s %10s %10s %10s\n", "lock", "thread", "acquired", "contended", "mean us",
+	       "p50 us", "p99 us", "max us");
+	for (LockStats *stats : {&input_stats, &flight_stats, &audio_stats}) {
+		for (int role = 0; role < ROLE_COUNT; role++) {
+			const WaitHistogram &h = stats->roles[role];
+			uint64_t acquired = h.acquired.load(), contended = h.contended.load();
+			if (acquired == 0)
+				continue;
+			printf("%-16s %-7s %12llu %9.2f%%", stats->name, role_names[role], (unsigned long long)acquired,
+			       100.0 * (double)contended / (double)acquired);
+			print_us(contended ? h.total_wait.load() / contended : 0);
+			print_us(h.Percentile(0.5));
+			print_us(h.Percentile(0.99));
+			print_us(h.max_wait.load());
+			printf("\n");
+		}
+	}
+	printf("\nWaits are over contended acquisitions only, percentiles to the next power of two.\n");
+}
+
+// A thread that fell behind its rate didn't apply the load asked for, so the
+// run doesn't count as a pass
+static void check_rates(double elapsed)
+{
+	fflush(stdout); // After the report
+	for (int role = 0; role < ROLE_COUNT; role++) {
+		double rate = (double)iterations[role].load() / elapsed;
+		if (options.rates[role] <= 0.0 || rate >= options.min_rate * options.rates[role])
+			continue;
+		failures.fetch_add(1);
+		fprintf(stderr, "FAILED (%s thread): ran at %.0f/s, under %.0f%% of the %.0f/s asked for\n",
+			role_names[role], rate, 100.0 * options.min_rate, options.rates[role]);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		bool has_value = i + 1 < argc;
+		int role = -1;
+		if (strcmp(arg, "--audio-rate") == 0)
+			role = ROLE_AUDIO;
+		else if (strcmp(arg, "--render-rate") == 0)
+			role = ROLE_RENDER;
+		else if (strcmp(arg, "--tick-rate") == 0)
+			role = ROLE_TICK;
+		else if (strcmp(arg, "--update-rate") == 0)
+			role = ROLE_UPDATE;
+		else if (strcmp(arg, "--rebind-rate") == 0)
+			role = ROLE_REBIND;
+
+		if (role >= 0 && has_value) {
+			options.rates[role] = atof(argv[++i]);
+		} else if (strcmp(arg, "--seconds") == 0 && has_value) {
+			options.seconds = atof(argv[++i]);
+		} else if (strcmp(arg, "--sources") == 0 && has_value) {
+			options.sources = atoi(argv[++i]);
+		} else if (strcmp(arg, "--block") == 0 && has_value) {
+			options.block = (uint32_t)atoi(argv[++i]);
+		} else if (strcmp(arg, "--min-rate") == 0 && has_value) {
+			options.min_rate = atof(argv[++i]) / 100.0;
+		} else if (strcmp(arg, "--seed") == 0 && has_value) {
+			options.seed = (uint32_t)atoi(argv[++i]);
+		} else if (strcmp(arg, "--no-files") == 0) {
+			options.files = false;
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	if (options.sources < 1 || options.block < 1 || options.block > 4096 || options.seconds <= 0.0) {
+		usage();
+		return 1;
+	}
+
+	std::error_code error;
+	file_dir = std::filesystem::temp_directory_path(error).string();
+	if (error)
+		file_dir = ".";
+
+	CoreMutex::observer = &lock_observer;
+	for (int i = 0; i < options.sources; i++) {
+		std::shared_ptr<StressSource> source = std::make_shared<StressSource>();
+		source->SetInput(&inputs[i % 2]);
+		sources.push_back(source);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	threads.emplace_back(audio_thread);
+	threads.emplace_back(per_source_thread, (int)ROLE_RENDER);
+	threads.emplace_back(per_source_thread, (int)ROLE_TICK);
+	threads.emplace_back(per_source_thread, (int)ROLE_UPDATE);
+	threads.emplace_back(rebind_thread);
+
+	std::this_thread::sleep_for(std::chrono::duration<double>(options.seconds));
+	running = false;
+	for (std::thread &thread : threads)
+		thread.join();
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	{
+		std::lock_guard<std::mutex> lock(sources_mutex);
+		sources.clear();
+	}
+
+	report(elapsed);
+	check_rates(elapsed);
+	uint64_t failed = failures.load();
+	if (failed) {
+		printf("\n%llu checks failed\n", (unsigned long long)failed);
+		return 2;
+	}
+#ifdef GLASSLINE_ALLOC_CHECK
+	printf("allocations: none in steady state (%llu during warm-up)\n",
+	       (unsigned long long)AllocCheckScope::Count());
+#endif
+	printf("\nAll checks passed\n");
+	return 0;
+}